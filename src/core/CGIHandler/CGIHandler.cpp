@@ -11,23 +11,45 @@
 /* ************************************************************************** */
 
 #include "CGIHandler.hpp"
+#include "../FastCgi/FastCgi.hpp"
+#include <atomic>
+#include <cerrno>
+#include <spawn.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+
+/// Set once pidfd_open() turned out to be missing, so that is logged a single time.
+static std::atomic<bool> g_pidfdUnsupported(false);
 
 CGIHandler::CGIHandler(const Request &request, const Location &location, std::string cgiIndexFile) 
-    : _request(request), _interpreter(""), _cgiPath(""), _scriptPath(""), _queryString(""), _bodyInput(""), _cgiUploadPath(""), _timeout(0), _stdin_fd(0), _stdout_fd(0), _stderr_fd(0), _pid(0), _stdout_done(false), _stderr_done(false), _process_done(false), _envp(nullptr), _output(), _errorOutput() {
-    _scriptPath = resolveScriptPath(location.getLocationRoot(), request.getUri(), cgiIndexFile);
-    _cgiPath = getInterpreter(_scriptPath);
-    if (_cgiPath.empty()) {
-        throw CGIException("No interpreter found for script: " + _scriptPath, 500);
-    }
-    if (location.getLocationAllowedCgi().find(_interpreter) == location.getLocationAllowedCgi().end()) {
-        throw CGIException("Selected interpreter unavailable for this location: " + _scriptPath, 500);
+    : _request(request), _interpreter(""), _cgiPath(""), _scriptPath(""), _queryString(""), _bodyInput(""), _cgiUploadPath(""), _timeout(0), _stdin_fd(-1), _stdout_fd(-1), _stderr_fd(-1), _pid(0), _pid_fd(-1), _stdinPending(), _stdinUnframed(), _stdinFramed(false), _stdin_done(true), _stdout_done(false), _stderr_done(false), _process_done(false), _poolEnabled(false), _pool(nullptr), _worker(nullptr), _pooled(false), _requestEnded(false), _records(), _workerRequest(), _fastCgiPass(location.getLocationFastCgiPass()), _backend(nullptr), _requestId(0), _environment(), _envp(nullptr), _output(), _headerEnd(std::string::npos), _headerScanned(0), _headersTaken(false), _overflow(false), _errorOutput() {
+    if (!_fastCgiPass.empty()) {
+        // The application may run elsewhere and answers for missing scripts itself; it needs an absolute path.
+        _scriptPath = parsingUtils::joinPaths(location.getLocationRoot(), std::string(request.getUri()));
+        if (!cgiIndexFile.empty())
+            _scriptPath = parsingUtils::joinPaths(_scriptPath, cgiIndexFile);
+        char* cwd = getcwd(nullptr, 0);
+        if (_scriptPath[0] != '/' && cwd)
+            _scriptPath = parsingUtils::joinPaths(cwd, _scriptPath);
+        free(cwd);
+    } else {
+        _scriptPath = resolveScriptPath(location.getLocationRoot(), std::string(request.getUri()), cgiIndexFile);
+        _cgiPath = getInterpreter(_scriptPath);
+        if (_cgiPath.empty()) {
+            throw CGIException("No interpreter found for script: " + _scriptPath, 500);
+        }
+        if (location.getLocationAllowedCgi().find(_interpreter) == location.getLocationAllowedCgi().end()) {
+            throw CGIException("Selected interpreter unavailable for this location: " + _scriptPath, 500);
+        }
     }
     _queryString = request.getQuery();
+    // A view, not a copy: the Request owns the body and outlives this handler.
     _bodyInput = request.getBody();
 	_cgiUploadPath = location.getLocationUploadPath();
 	_timeout = request.getTimeout();
-	std::unordered_map<std::string, std::string> envVariables = initEnvironmentVars(request);
-    _envp = buildEnvironmentArray(envVariables);
+	_poolEnabled = location.getLocationCgiPool().enabled;
+	_environment = initEnvironmentVars(request);
+    _envp = buildEnvironmentArray(_environment);
 
 	_stderr_done = false;
 	_stdout_done = false;
@@ -36,6 +58,7 @@ CGIHandler::CGIHandler(const Request &request, const Location &location, std::st
 
 CGIHandler::~CGIHandler()
 {
+	terminate();
 	freeEnvironmentArray();
 }
 
@@ -57,96 +80,388 @@ std::string CGIHandler::resolveScriptPath(const std::string& rootPath, const std
     return scriptPath;
 }
 
-void CGIHandler::start() {
+void CGIHandler::start(ServerManager& manager, int clientFd) {
+    if (!_fastCgiPass.empty()) {
+        return startFastCgiPass(manager.getFastCgiUpstreams(), clientFd);
+    }
+    CgiPool* pool = _poolEnabled ? manager.getCgiPools().get(_cgiPath) : nullptr;
+
+    // Every worker busy, or the interpreter not pooled: fall back to a process of its own.
+    if (pool && startPooled(*pool)) {
+        return;
+    }
+    startProcess();
+}
+
+bool CGIHandler::startPooled(CgiPool& pool) {
+    int socketFd = -1;
+    CgiWorker* worker = pool.acquire(socketFd);
+    if (!worker) {
+        return false;
+    }
+    _workerRequest.clear();
+    FastCgi::appendBeginRequest(_workerRequest, 1, false);
+    FastCgi::appendParams(_workerRequest, 1, _environment);
+    ServerManager::setNonBlocking(socketFd);
+    // The body is framed a slice at a time as the worker takes it, never copied whole.
+    _stdinPending = _workerRequest;
+    _stdinUnframed = _request.getMethod() == "POST" ? _bodyInput : std::string_view();
+    _stdinFramed = true;
+    _stdin_done = false;
+    _stdin_fd = socketFd;
+    // A worker that died since it was last used cannot take the request: fork instead.
+    if (!writeInput()) {
+        close(socketFd);
+        pool.release(worker, false);
+        _stdin_fd = -1;
+        return false;
+    }
+    // The rest is written as the worker reads it, polled on a descriptor of its own so the
+    // output side keeps its own interest (and can be paused) on the original one.
+    _stdin_fd = _stdin_done ? -1 : fcntl(socketFd, F_DUPFD_CLOEXEC, 0);
+    if (!_stdin_done && _stdin_fd == -1) {
+        close(socketFd);
+        pool.release(worker, false);
+        return false;
+    }
+    _pool = &pool;
+    _worker = worker;
+    _pooled = true;
+    _stdout_fd = socketFd;
+    _stderr_fd = -1;
+    _stdout_done = false;
+    _stderr_done = true;
+    _process_done = true;
+    return true;
+}
+
+void CGIHandler::startFastCgiPass(FastCgiUpstreamSet& upstreams, int clientFd) {
+    FastCgiConnection* connection = upstreams.get(_fastCgiPass).dispatch();
+    if (!connection) {
+        throw CGIException("FastCGI application unreachable: " + _fastCgiPass, 502);
+    }
+    _requestId = connection->begin(*this, clientFd, _environment,
+        _request.getMethod() == "POST" ? std::string_view(_bodyInput) : std::string_view());
+    _backend = connection;
+    _stdin_fd = -1;
+    _stdin_done = true;
+    _stdout_fd = -1;
+    _stderr_fd = -1;
+    _stdout_done = false;
+    _stderr_done = true;
+    _process_done = true;
+}
+
+void CGIHandler::startProcess() {
     int stdin_pipe[2], stdout_pipe[2], stderr_pipe[2];
-    if (pipe(stdin_pipe) < 0 || pipe(stdout_pipe) < 0 || pipe(stderr_pipe) < 0)
+    // Close-on-exec: another script spawned meanwhile must not hold this one's stdin open. dup2() clears it on 0-2.
+    if (pipe2(stdin_pipe, O_CLOEXEC) < 0 || pipe2(stdout_pipe, O_CLOEXEC) < 0 || pipe2(stderr_pipe, O_CLOEXEC) < 0)
         throw CGIException("Failed to create pipes", 500);
 
-    _pid = fork();
-    if (_pid < 0) throw CGIException("Failed to fork", 500);
-
-    if (_pid == 0) {
-        std::string scriptName;
-        dup2(stdin_pipe[0], STDIN_FILENO);
-        dup2(stdout_pipe[1], STDOUT_FILENO);
-        dup2(stderr_pipe[1], STDERR_FILENO);
-        close(stdin_pipe[0]); 
-		close(stdin_pipe[1]);
-        close(stdout_pipe[0]); 
-		close(stdout_pipe[1]);
-        close(stderr_pipe[0]); 
-		close(stderr_pipe[1]);
-        size_t lastSlash = _scriptPath.find_last_of('/');
-        if (lastSlash != std::string::npos) {
-            std::string scriptDir = _scriptPath.substr(0, lastSlash);
-            if (chdir(scriptDir.c_str()) != 0) {
-                perror("CGI chdir failed");
-                exit(1);
-            }
-        }
-        if (lastSlash != std::string::npos)
-            scriptName = _scriptPath.substr(lastSlash + 1);
-        if (!_cgiPath.empty()) {
-            const char* args[] = {_cgiPath.c_str(), scriptName.c_str(), nullptr};
-            execve(_cgiPath.c_str(), const_cast<char* const*>(args), _envp);
-        } else {
-            const char* args[] = {scriptName.c_str(), nullptr};
-            execve(scriptName.c_str(), const_cast<char* const*>(args), _envp);
-        }
-        perror("CGI execve failed for script");
-        exit(1);
+    // The file actions run in the child before the exec, so a relative script path is found in its directory.
+    size_t lastSlash = _scriptPath.find_last_of('/');
+    std::string scriptDir = lastSlash != std::string::npos ? _scriptPath.substr(0, lastSlash) : std::string();
+    std::string scriptName = lastSlash != std::string::npos ? _scriptPath.substr(lastSlash + 1) : std::string();
+    const char* program = _cgiPath.empty() ? scriptName.c_str() : _cgiPath.c_str();
+    const char* interpreterArgs[] = {_cgiPath.c_str(), scriptName.c_str(), nullptr};
+    const char* scriptArgs[] = {scriptName.c_str(), nullptr};
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attributes;
+    sigset_t emptyMask, defaultSignals;
+    // SIGHUP is blocked in the server for its signalfd, SIGPIPE ignored: the script gets the defaults.
+    sigemptyset(&emptyMask);
+    sigemptyset(&defaultSignals);
+    sigaddset(&defaultSignals, SIGPIPE);
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, stdin_pipe[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, stdout_pipe[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, stderr_pipe[1], STDERR_FILENO);
+    if (!scriptDir.empty())
+        posix_spawn_file_actions_addchdir_np(&actions, scriptDir.c_str());
+    posix_spawnattr_init(&attributes);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+    posix_spawnattr_setsigmask(&attributes, &emptyMask);
+    posix_spawnattr_setsigdefault(&attributes, &defaultSignals);
+    int error = posix_spawn(&_pid, program, &actions, &attributes,
+        const_cast<char* const*>(_cgiPath.empty() ? scriptArgs : interpreterArgs), _envp);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attributes);
+    close(stdin_pipe[0]);
+    close(stdout_pipe[1]);
+    close(stderr_pipe[1]);
+    if (error != 0) {
+        _pid = 0;
+        close(stdin_pipe[1]);
+        close(stdout_pipe[0]);
+        close(stderr_pipe[0]);
+        throw CGIException("Failed to spawn " + std::string(program) + ": " + strerror(error), 500);
+    }
+    // Through syscall(): the libc wrapper is recent and its header lacks C linkage. Without
+    // pidfds (Linux < 5.3), the process is polled for its exit instead.
+    _pid_fd = syscall(SYS_pidfd_open, _pid, 0);
+    if (_pid_fd == -1) {
+        int err = errno;
+        // Lacking kernel support is said once; anything else (e.g. EMFILE) each time.
+        if (err != ENOSYS || !g_pidfdUnsupported.exchange(true))
+            std::cerr << "CGI: pidfd_open failed for pid " << _pid << ": " << strerror(err)
+                << ", the script's exit is polled for" << std::endl;
     }
 
     _stdin_fd = stdin_pipe[1];
     _stdout_fd = stdout_pipe[0];
     _stderr_fd = stderr_pipe[0];
-    close(stdin_pipe[0]);
-    close(stdout_pipe[1]);
-    close(stderr_pipe[1]);
+	ServerManager::setNonBlocking(_stdin_fd);
 	ServerManager::setNonBlocking(_stdout_fd);
-	ServerManager::setNonBlocking(_stderr_done);
+	ServerManager::setNonBlocking(_stderr_fd);
     _stdout_done = false;
     _stderr_done = false;
     _process_done = false;
-    if (_request.getMethod() == "POST" && !_bodyInput.empty()) {
-        write(_stdin_fd, _bodyInput.c_str(), _bodyInput.size());
+    // Whatever the pipe takes now saves a round through epoll; a larger body is fed on EPOLLOUT.
+    _stdinPending = _request.getMethod() == "POST" ? _bodyInput : std::string_view();
+    _stdin_done = false;
+    writeInput();
+    if (_stdin_done) {
+        close(_stdin_fd);
+        _stdin_fd = -1;
     }
-    close(_stdin_fd);
+}
+
+bool CGIHandler::writeInput() {
+    while (!_stdinPending.empty() || frameInput()) {
+        ssize_t bytesWritten = write(_stdin_fd, _stdinPending.data(), _stdinPending.size());
+        if (bytesWritten == -1 && errno == EINTR) {
+            continue;
+        }
+        if (bytesWritten == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return true;
+        }
+        if (bytesWritten <= 0) {
+            _stdinPending = std::string_view();
+            _stdinUnframed = std::string_view();
+            _stdinFramed = false;
+            _stdin_done = true;
+            return false;
+        }
+        _stdinPending.remove_prefix(bytesWritten);
+    }
+    _stdin_done = true;
+    return true;
+}
+
+bool CGIHandler::frameInput() {
+    if (!_stdinFramed) {
+        return false;
+    }
+    std::string_view slice = _stdinUnframed.substr(0, CGI_STDIN_BATCH);
+    _stdinUnframed.remove_prefix(slice.size());
+    _workerRequest.clear();
+    if (slice.empty()) {
+        FastCgi::appendRecord(_workerRequest, FCGI_STDIN, 1, std::string_view());
+        _stdinFramed = false;
+    } else {
+        FastCgi::appendRecord(_workerRequest, FCGI_STDIN, 1, slice);
+    }
+    _stdinPending = _workerRequest;
+    return true;
 }
 
 void CGIHandler::handleEvent(int fd) {
     char buffer[CHUNK_SIZE];
     ssize_t bytesRead;
+    if (fd == _stdin_fd) {
+        if (!_stdin_done) {
+            writeInput();
+        }
+        return;
+    }
+    if (fd == _pid_fd) {
+        // Readable once the process exited: it is a zombie now, reaped without waiting.
+        return reap();
+    }
+    if (_pooled) {
+        if (fd == _stdout_fd && !_stdout_done) {
+            readRecords();
+        }
+        return;
+    }
     if (fd == _stdout_fd && !_stdout_done) {
-        while ((bytesRead = read(_stdout_fd, buffer, sizeof(buffer))) > 0) {
-            _output.insert(_output.end(), buffer, buffer + bytesRead);
+        // Level-triggered: what is left in the pipe is reported again, once the client took this batch.
+        size_t total = 0;
+        while (total < CGI_READ_BATCH && (bytesRead = read(_stdout_fd, buffer, sizeof(buffer))) > 0) {
+            appendOutput(buffer, bytesRead);
+            total += bytesRead;
         }
-        if (bytesRead == 0) {
-            close(_stdout_fd);
+        if (total < CGI_READ_BATCH && bytesRead == 0) {
             _stdout_done = true;
         }
     }
     if (fd == _stderr_fd && !_stderr_done) {
         while ((bytesRead = read(_stderr_fd, buffer, sizeof(buffer))) > 0) {
-            _errorOutput.insert(_errorOutput.end(), buffer, buffer + bytesRead);
+            if (_errorOutput.size() < MAX_OUTPUT_SIZE)
+                _errorOutput.insert(_errorOutput.end(), buffer, buffer + bytesRead);
         }
         if (bytesRead == 0) {
-            close(_stderr_fd);
             _stderr_done = true;
         }
     }
-    int status;
-    if (!_process_done && (waitpid(_pid, &status, WNOHANG) > 0 || WIFEXITED(status))) {
+    // Without a pidfd, every pipe event polls for the exit; once both pipes are at EOF and the
+    // script still runs, the client polls it from the timer wheel (awaitsExit()).
+    if (_pid_fd == -1) {
+        reap();
+    }
+}
+
+void CGIHandler::reap() {
+    if (!_process_done && waitpid(_pid, nullptr, WNOHANG) > 0) {
         _process_done = true;
     }
 }
 
+bool CGIHandler::awaitsExit() const {
+    return _pid > 0 && _pid_fd == -1 && _stdout_done && _stderr_done && !_process_done;
+}
+
+void CGIHandler::readRecords() {
+    char buffer[CHUNK_SIZE];
+    ssize_t bytesRead = 1;
+    size_t total = 0;
+    while (total < CGI_READ_BATCH && (bytesRead = read(_stdout_fd, buffer, sizeof(buffer))) > 0) {
+        _records.append(buffer, bytesRead);
+        total += bytesRead;
+    }
+    bool closed = bytesRead == 0 || (bytesRead == -1 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR);
+    size_t offset = 0;
+    try {
+        FastCgiRecord record;
+        size_t length;
+        while (!_stdout_done && (length = FastCgi::parseRecord(_records.data() + offset, _records.size() - offset, record)) > 0) {
+            offset += length;
+            handleRecord(record);
+        }
+    } catch (const std::runtime_error& e) {
+        std::cerr << "CGI pool: " << e.what() << std::endl;
+        closed = true;
+    }
+    _records.erase(0, offset);
+    if (_stdout_done || closed) {
+        _stdout_done = true;
+        _pool->release(_worker, _requestEnded);
+        _worker = nullptr;
+    }
+}
+
+void CGIHandler::handleRecord(const FastCgiRecord& record) {
+    if (record.type == FCGI_STDOUT) {
+        appendOutput(record.content.data(), record.content.size());
+    } else if (record.type == FCGI_STDERR) {
+        if (_errorOutput.size() < MAX_OUTPUT_SIZE)
+            _errorOutput.insert(_errorOutput.end(), record.content.begin(), record.content.end());
+    } else if (record.type == FCGI_END_REQUEST) {
+        // An application that refuses the request (overloaded, cannot multiplex) ends it without completing it.
+        _requestEnded = FastCgi::endRequestStatus(record) != -1;
+        _stdout_done = true;
+        _backend = nullptr;
+    }
+}
+
+void CGIHandler::handleBackendError() {
+    _stdout_done = true;
+    _backend = nullptr;
+}
+
 bool CGIHandler::isDone() const {
-    return _stdout_done && _stderr_done && _process_done;
+    return _stdin_done && _stdout_done && _stderr_done && _process_done;
+}
+
+void CGIHandler::terminate() {
+    if (_backend) {
+        _backend->abort(_requestId);
+        _backend = nullptr;
+        return;
+    }
+    if (_worker) {
+        _pool->discard(_worker);
+        _worker = nullptr;
+        return;
+    }
+    if (_pid <= 0 || _process_done) {
+        return;
+    }
+    // SIGKILL cannot be caught: the process is gone right away, the wait is not left to the script.
+    kill(_pid, SIGKILL);
+    waitpid(_pid, nullptr, 0);
+    _process_done = true;
+}
+
+void CGIHandler::releaseFd(int fd) {
+    for (int* member : {&_stdin_fd, &_stdout_fd, &_stderr_fd, &_pid_fd}) {
+        if (*member == fd) {
+            *member = -1;
+        }
+    }
 }
 
-std::string CGIHandler::finalize() {
-    return parseOutput(_output);
+bool CGIHandler::isPipeDone(int fd) const {
+    return (fd == _stdin_fd && _stdin_done) || (fd == _stdout_fd && _stdout_done) || (fd == _stderr_fd && _stderr_done)
+        || (fd == _pid_fd && _process_done);
+}
+
+bool CGIHandler::hasFailed() const {
+    return _overflow || ((_pooled || !_fastCgiPass.empty()) && !_requestEnded);
+}
+
+void CGIHandler::appendOutput(const char* data, size_t size) {
+    if (_overflow) {
+        return;
+    }
+    if (_output.size() + size > MAX_OUTPUT_SIZE) {
+        std::cerr << "CGI output exceeds " << MAX_OUTPUT_SIZE << " bytes not yet sent: " << _scriptPath << std::endl;
+        _overflow = true;
+        return;
+    }
+    _output.append(data, size);
+    if (_headersTaken || _headerEnd != std::string::npos || _headerScanned > CGI_HEADER_MAX_SIZE) {
+        return;
+    }
+    // The blank line may straddle two reads: look again at the last 3 bytes already searched.
+    _headerEnd = _output.find("\r\n\r\n", _headerScanned > 3 ? _headerScanned - 3 : 0);
+    _headerScanned = _output.size();
+    // Too far in to end header fields: the output has none.
+    if (_headerEnd != std::string::npos && _headerEnd > CGI_HEADER_MAX_SIZE) {
+        _headerEnd = std::string::npos;
+    }
+}
+
+std::string CGIHandler::takeHeaders() {
+    std::string fields = "Content-Type: text/html\r\n";
+
+    if (_headerEnd != std::string::npos) {
+        fields.assign(_output, 0, _headerEnd + 2);
+        _output.erase(0, _headerEnd + 4);
+    }
+    _headersTaken = true;
+    return fields;
+}
+
+void CGIHandler::takeOutput(std::string& body) {
+    if (body.empty()) {
+        body.swap(_output);
+    } else {
+        body += _output;
+    }
+    _output.clear();
+}
+
+std::string CGIHandler::finalize(std::string& body) {
+    if (hasFailed()) {
+        return "";
+    }
+    std::string fields = takeHeaders();
+
+    // The output buffer itself becomes the body segment, nothing is copied.
+    body.clear();
+    takeOutput(body);
+    return fields + "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n";
 }
 
 std::unordered_map<std::string, std::string> CGIHandler::initEnvironmentVars(const Request& request) {
@@ -154,11 +469,13 @@ std::unordered_map<std::string, std::string> CGIHandler::initEnvironmentVars(con
     std::unordered_map<std::string, std::string> envVariables;
     envVariables["REQUEST_METHOD"] = request.getMethod();
     envVariables["SCRIPT_NAME"] = _scriptPath;
+    envVariables["SCRIPT_FILENAME"] = _scriptPath;
+    envVariables["REDIRECT_STATUS"] = "200";
     envVariables["QUERY_STRING"] = _queryString;
-	auto it = request.getHeaders().find("Content-Type");
-	envVariables["CONTENT_TYPE"] = (it != request.getHeaders().end()) ? it->second : Response::getMimeType(_scriptPath);
+	std::string_view contentType = request.getHeader("Content-Type");
+	envVariables["CONTENT_TYPE"] = !contentType.empty() ? std::string(contentType) : Response::getMimeType(_scriptPath);
     envVariables["CONTENT_LENGTH"] = std::to_string(request.getBodySize());
-    envVariables["SERVER_NAME"] = request.getHeaders().at("Host");
+    envVariables["SERVER_NAME"] = request.getHeader("Host");
     envVariables["SERVER_PROTOCOL"] = request.getHttpVersion();
     envVariables["GATEWAY_INTERFACE"] = "CGI/1.1";
 	envVariables["UPLOAD_DIR"] = _cgiUploadPath;
@@ -204,6 +521,10 @@ std::string CGIHandler::getInterpreter(const std::string& scriptPath) {
     if (dot == std::string::npos) return "";
     std::string extension = scriptPath.substr(dot);
     _interpreter = extension;
+    return interpreterFor(extension);
+}
+
+std::string CGIHandler::interpreterFor(const std::string& extension) {
     if (extension == ".py") return "/usr/bin/python3";
     if (extension == ".pl") return "/usr/bin/perl";
     if (extension == ".rb") return "/usr/bin/ruby";
@@ -212,34 +533,3 @@ std::string CGIHandler::getInterpreter(const std::string& scriptPath) {
     if (extension == ".php") return "/usr/bin/php";
     return "";
 }
-
-std::string CGIHandler::parseOutput(const std::vector<char>& output) {
-    std::string rawResponse;
-    std::string startLine = "HTTP/1.1 200 OK\r\n";
-    rawResponse += startLine;
-
-    std::string outputStr(output.begin(), output.end());
-    std::string headers;
-    size_t headerEnd = outputStr.find("\r\n\r\n");
-    if (headerEnd == std::string::npos) {
-       headers += "Content-Type: text/html\r\n";
-       headers += "Content-Length: " + std::to_string(output.size()) + "\r\n";
-       rawResponse += headers + "\r\n";
-       rawResponse += outputStr;
-       return rawResponse;
-    }
-    headers = outputStr.substr(0, headerEnd);
-    std::string body = outputStr.substr(headerEnd + 4);
-    if (body.empty()) {
-        rawResponse += headers + "\r\n";
-        rawResponse += "Content-Length: 0\r\n\r\n";
-        return rawResponse;
-    }
-    headers += "\r\nContent-Length: " + std::to_string(body.size()) + "\r\n";
-    rawResponse += headers + "\r\n";
-	rawResponse += body;
-
-    return rawResponse;
-}
-
-
@@ -24,12 +24,18 @@
 #include <cstring>
 #include <cstdio>
 #include "../Response/Response.hpp"
+#include "../CgiPool/CgiPool.hpp"
+#include "../FastCgi/FastCgiUpstream.hpp"
 
 
 
 
-#define MAX_OUTPUT_SIZE 10 * 1024 * 1024 // 10 MB maximum output size
+#define MAX_OUTPUT_SIZE 10 * 1024 * 1024 // 10 MB of output held at most before the client takes it
 #define CHUNK_SIZE 8192 // 8 KB chunk size for reading/writing
+#define CGI_HEADER_MAX_SIZE 65536 // Output without a blank line within this many bytes has no header fields
+#define CGI_READ_BATCH 65536 // Bytes read from a pipe per event, so a fast script cannot outrun the client
+#define CGI_STDIN_BATCH (16 * FCGI_MAX_CONTENT_LEN) // Body bytes framed as FCGI_STDIN records at a time
+#define CGI_EXIT_POLL_MS 100 // Interval at which a script that closed its pipes is polled for its exit, without a pidfd
 
 
 
@@ -52,47 +58,184 @@ class CGIHandler {
          * @param request The HTTP request object containing method, URI, headers, and body
          * @param location The location configuration containing root path, allowed CGI types, and upload path
          * @param cgiIndexFile Optional CGI index file to append to the script path
-         * @note Automatically resolves script path, finds interpreter, and sets up environment variables
+         * @note Automatically resolves script path, finds interpreter, and sets up environment variables.
+         *       With fastcgi_pass the script is the application's business: it is neither checked nor interpreted here
          */
         CGIHandler(const Request &request, const Location &location, std::string cgiIndexFile);
 
         /**
          * @brief Destroys the CGI handler and frees allocated memory
          * @return None
-         * @note Automatically cleans up environment variables array
+         * @note Automatically cleans up environment variables array and kills a still running script
          */
         ~CGIHandler();
 
         // Core execution methods
         /**
-         * @brief Starts the CGI process by forking, setting up pipes, and executing the script
+         * @brief Starts the CGI script: on the location's FastCGI application, on a pooled worker
+         *        when the location allows it, else in a process of its own
+         * @param manager Reactor whose worker pools and FastCGI upstreams are used
+         * @param clientFd Client the response goes to
          * @return None
-         * @note Uses 3 pipes to handle stdin, stdout, and stderr
-         * @throws CGIException if pipe creation or forking fails
+         * @note A spawned script uses 3 pipes for stdin, stdout, and stderr, and a pidfd for its exit; a pooled one a single
+         *       FastCGI connection, reported as the stdout fd (the stderr fd is then -1). A request
+         *       passed to a FastCGI application has no fd of its own: both are -1, the upstream
+         *       connection reports the records. The body is written as far as the pipe or socket
+         *       takes it; if some is left, the stdin fd is kept open to be polled for writing, else it is -1
+         * @throws CGIException if pipe creation or spawning fails, or the FastCGI application is unreachable (502)
          */
-        void start();
+        void start(ServerManager& manager, int clientFd);
 
         /**
-         * @brief Handles I/O events for stdout and stderr pipes, reading output and checking process status
-         * @param fd The file descriptor that triggered the event (stdout or stderr pipe)
+         * @brief Gets the interpreter that runs scripts with a given extension
+         * @param extension File extension, dot included
+         * @return The path to the interpreter executable, empty if the extension is unknown
+         * @note Check OS specific path for exec (e.g. python3 - macOS: /opt/homebrew/bin/python3; linux: /usr/bin/python3
+         */
+        static std::string interpreterFor(const std::string& extension);
+
+        /**
+         * @brief Handles I/O events for the pipes, feeding stdin, reading output and checking process status
+         * @param fd The file descriptor that triggered the event (stdin, stdout or stderr pipe)
          * @return None
-         * @note Reads data in chunks and updates completion flags when pipes close
+         * @note Reads at most CGI_READ_BATCH bytes of stdout and updates completion flags on EOF; the pipes are
+         *       closed by the ServerManager. A pooled worker's records are decoded, and the worker goes back to
+         *       its pool at END_REQUEST
          */
         void handleEvent(int fd);
 
+        /**
+         * @brief Handles one FastCGI record of the request
+         * @param record STDOUT, STDERR or END_REQUEST record
+         * @return None
+         * @note Used for pooled workers and FastCGI applications alike
+         */
+        void handleRecord(const FastCgiRecord& record);
+
+        /**
+         * @brief Ends a request whose FastCGI connection broke before END_REQUEST
+         * @return None
+         * @note The response becomes a 502
+         */
+        void handleBackendError();
+
+        /**
+         * @brief Tells whether the request is passed to a FastCGI application (fastcgi_pass)
+         * @return true if it is, false if the script runs on this machine
+         */
+        bool isFastCgiPass() const { return !_fastCgiPass.empty(); }
+
+        /**
+         * @brief Gets the FastCGI connection the request is on
+         * @return The connection, nullptr unless a fastcgi_pass request is still running
+         */
+        FastCgiConnection* getBackend() const { return _backend; }
+
+        /**
+         * @brief Checks if the script's header fields are known
+         * @return true once a blank line (CRLF CRLF) arrived, CGI_HEADER_MAX_SIZE bytes came without one, or stdout ended
+         */
+        bool hasHeaders() const { return _headerEnd != std::string::npos || _output.size() > CGI_HEADER_MAX_SIZE || _stdout_done; }
+
+        /**
+         * @brief Takes the script's header fields out of the output
+         * @return The fields, each ending in CRLF, without the blank line; Content-Type: text/html if the script sent none
+         * @note Call once, after hasHeaders(); whatever is left of the output is body
+         */
+        std::string takeHeaders();
+
+        /**
+         * @brief Moves the body bytes received so far to the caller
+         * @param body The bytes are appended to it
+         * @return None
+         */
+        void takeOutput(std::string& body);
+
+        /**
+         * @brief Checks if body bytes wait to be taken
+         * @return true if takeOutput() would add something
+         */
+        bool hasOutput() const { return !_output.empty(); }
+
+        /**
+         * @brief Checks if the script's stdout reached its end (EOF or END_REQUEST)
+         * @return true if no more output will come
+         */
+        bool isOutputDone() const { return _stdout_done; }
+
+        /**
+         * @brief Checks if the output exceeded MAX_OUTPUT_SIZE before the client took it
+         * @return true if output was dropped; the script has to be stopped
+         */
+        bool hasOverflowed() const { return _overflow; }
+
+        /**
+         * @brief Checks if the script's output cannot be trusted to be complete
+         * @return true if the output overflowed, or a pooled worker or the FastCGI application broke off without ending the request
+         * @note Only meaningful once isDone()
+         */
+        bool hasFailed() const;
+
         /**
          * @brief Checks if the CGI process has completed all I/O operations
          * @return true if all operations are complete, false otherwise
-         * @note Checks stdout, stderr, and process completion flags
+         * @note Checks stdin, stdout, stderr, and process completion flags
          */
         bool isDone() const;
 
         /**
-         * @brief Finalizes the CGI execution by parsing the output and returning the formatted response
-         * @return The formatted HTTP response string
-         * @note Calls parseOutput to convert raw output to proper HTTP response format
+         * @brief Reaps the CGI process if it exited, without waiting for it
+         * @return None
+         */
+        void reap();
+
+        /**
+         * @brief Checks if the script closed both output pipes but was not reaped yet, without a pidfd
+         * @return true if nothing but a poll of reap() will tell when it exits
+         * @note The script may keep running long after (exec >&-, a daemonized child): the
+         *       reactor must not wait for it
+         */
+        bool awaitsExit() const;
+
+        /**
+         * @brief Checks if the given pipe has reached EOF
+         * @param fd The stdin, stdout or stderr pipe file descriptor, or the pidfd
+         * @return true if the pipe has been fully read, the whole body written to it, or the process reaped, false otherwise
+         */
+        bool isPipeDone(int fd) const;
+
+        /**
+         * @brief Forgets a descriptor the reactor just closed
+         * @param fd The stdin, stdout or stderr pipe, or the pidfd, that was closed
+         * @return None
+         * @note Its getter returns -1 from then on, so the number cannot be mistaken for a
+         *       descriptor another client opened since
+         */
+        void releaseFd(int fd);
+
+        /**
+         * @brief Kills the CGI process if it is still running and reaps it
+         * @return None
+         * @note A pooled worker still running the script is killed and replaced; a request on a
+         *       FastCGI application is aborted
+         * @note Used when the script exceeds its timeout or the client goes away
          */
-        std::string finalize();
+        void terminate();
+
+        /**
+         * @brief Gets the execution timeout of the CGI script
+         * @return The timeout in seconds
+         */
+        time_t getTimeout() const { return _timeout; }
+
+        /**
+         * @brief Finalizes the CGI execution by splitting the output into header fields and body
+         * @param body Filled with the body the script produced
+         * @return The header fields, Content-Length included, ending with the blank line
+         * @note For a script that finished before any of its output was sent; the Response adds
+         *       the start line. Empty if hasFailed()
+         */
+        std::string finalize(std::string& body);
 
         // File descriptor getters
         /**
@@ -113,6 +256,12 @@ class CGIHandler {
          */
         int getStdinFd() const { return _stdin_fd; }
 
+        /**
+         * @brief Gets the pidfd of the CGI process, readable once it exited
+         * @return The pidfd, -1 for a pooled or FastCGI request, or if the kernel has no pidfd_open
+         */
+        int getPidFd() const { return _pid_fd; }
+
         // Exception class for CGI errors
         /**
          * @brief Exception class for CGI-specific errors with HTTP status codes
@@ -170,17 +319,65 @@ class CGIHandler {
          * @brief Determines the appropriate interpreter path based on script file extension
          * @param scriptPath The full path to the script file
          * @return The path to the interpreter executable
-         * @note Check OS specific path for exec (e.g. python3 - macOS: /opt/homebrew/bin/python3; linux: /usr/bin/python3
+         * @note Calls interpreterFor
          */
         std::string getInterpreter(const std::string& scriptPath);
 
         /**
-         * @brief Parses CGI script output and formats it into a proper HTTP response
-         * @param output Vector containing the raw output from the CGI script
-         * @return The formatted HTTP response string
-         * @note Handles both cases: output with headers and output without headers
+         * @brief Spawns the interpreter with the script, connected through pipes
+         * @return None
+         * @throws CGIException if pipe creation or spawning fails, a missing interpreter included
+         * @note posix_spawn() runs the child in the server's address space until it execs (vfork
+         *       style), so the cost does not grow with the server's memory, and nothing is
+         *       allocated in the child while other reactors may hold the allocator lock
          */
-        std::string parseOutput(const std::vector<char>& output);
+        void startProcess();
+
+
+        /**
+         * @brief Sends the request to an idle worker of a pool as a FastCGI request
+         * @param pool Pool of the script's interpreter
+         * @return true if a worker took the request, false if the script has to be forked
+         */
+        bool startPooled(CgiPool& pool);
+
+        /**
+         * @brief Sends the request to the location's FastCGI application
+         * @param upstreams FastCGI upstreams of the reactor
+         * @param clientFd Client the response goes to
+         * @return None
+         * @throws CGIException (502) if the application cannot be reached
+         */
+        void startFastCgiPass(FastCgiUpstreamSet& upstreams, int clientFd);
+
+        /**
+         * @brief Writes as much of the pending stdin bytes as the pipe or socket accepts
+         * @return false if the reader is gone or the write failed; stdin counts as done then too
+         * @note A script that stops reading early gets no more: its output is still its answer
+         */
+        bool writeInput();
+
+        /**
+         * @brief Frames the next slice of the body for a pooled worker, then the empty record ending it
+         * @return false once there is nothing left to frame, or for a forked script
+         */
+        bool frameInput();
+
+        /**
+         * @brief Reads a pooled worker's connection and decodes the complete records
+         * @return None
+         * @note STDOUT and STDERR records fill the outputs; END_REQUEST or a closed connection ends the request
+         */
+        void readRecords();
+
+        /**
+         * @brief Appends stdout bytes and looks for the end of the header fields
+         * @param data Bytes the script wrote
+         * @param size Number of bytes
+         * @return None
+         * @note Beyond MAX_OUTPUT_SIZE the bytes are dropped and the output marked as overflowed
+         */
+        void appendOutput(const char* data, size_t size);
 
         // Path and file handling methods
         /**
@@ -200,7 +397,7 @@ class CGIHandler {
         std::string _cgiPath; // Path to the CGI script interpreter
         std::string _scriptPath; // Full path to the CGI script file
         std::string _queryString; // Query string for the CGI script
-        std::string _bodyInput; // Body input for the CGI script, if applicable
+        std::string_view _bodyInput; // Body input for the CGI script, viewing the request's body
         std::string _cgiUploadPath; // Upload directory path for CGI scripts
         time_t _timeout; // Timeout for the CGI script execution
 
@@ -209,14 +406,38 @@ class CGIHandler {
         int _stdout_fd; // File descriptor for the CGI script's stdout
         int _stderr_fd; // File descriptor for the CGI script's stderr
         pid_t _pid; // Process ID of the CGI script
+        int _pid_fd; // pidfd of the CGI script, polled for its exit
 
         // Execution state attributes
+        std::string_view _stdinPending; // Bytes of the body (or a pooled worker's records) not written yet
+        std::string_view _stdinUnframed; // Body bytes a pooled worker still has to get as FCGI_STDIN records
+        bool _stdinFramed; // Flag to indicate if stdin is a FastCGI stream, still to be ended
+        bool _stdin_done; // Flag to indicate if stdin got everything and is closed
         bool _stdout_done; // Flag to indicate if stdout is done reading
         bool _stderr_done; // Flag to indicate if stderr is done reading
         bool _process_done; // Flag to indicate if the CGI process has finished
 
+        // Worker pool attributes
+        bool _poolEnabled; // The location runs its scripts on pooled workers (cgi_pool)
+        CgiPool* _pool; // Pool the worker belongs to, while one runs the script
+        CgiWorker* _worker; // Worker running the script, nullptr once released
+        bool _pooled; // The script ran on a pooled worker
+        bool _requestEnded; // The worker sent END_REQUEST
+        std::string _records; // FastCGI bytes received but not decoded yet
+        std::string _workerRequest; // Records framed for the worker, as long as stdin writes them
+
+        // FastCGI application attributes
+        std::string _fastCgiPass; // Address of the location's FastCGI application, empty to run the script here
+        FastCgiConnection* _backend; // Connection the request is on, nullptr once it ended
+        uint16_t _requestId; // Id of the request on that connection
+
         // Output storage attributes
+        std::unordered_map<std::string, std::string> _environment; // Environment of the script, sent as FastCGI params to a worker
         char** _envp; // Environment variables array for execve
-        std::vector<char> _output; // Output from the CGI script
-        std::vector<char> _errorOutput; // Error output from the CGI script
+        std::string _output; // Output from the CGI script not taken by the Response yet
+        size_t _headerEnd; // Offset of the CRLF CRLF ending the header fields in _output, npos while unknown
+        size_t _headerScanned; // Bytes of _output already searched for it
+        bool _headersTaken; // takeHeaders() was called, _output only holds body bytes
+        bool _overflow; // Output was dropped because the client did not take it fast enough
+        std::vector<char> _errorOutput; // Error output from the CGI script, up to MAX_OUTPUT_SIZE
 };
\ No newline at end of file
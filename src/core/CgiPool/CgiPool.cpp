@@ -0,0 +1,390 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   CgiPool.cpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/27 11:05:48 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/27 11:05:48 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "CgiPool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <climits>
+#include <fcntl.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+
+
+
+/// Makes socket names unique across the pools of every reactor thread.
+static std::atomic<unsigned long>	g_workerSequence(0);
+
+static socklen_t	fillAddress(struct sockaddr_un& addr, const std::string& address) {
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	std::memcpy(addr.sun_path, address.data(), address.size());
+	return (static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + address.size()));
+}
+
+/**
+ * @brief Locate the python worker script, wherever the server was started from.
+ * @return Path of CGI_POOL_PYTHON_WORKER under the binary's directory, else under the
+ *         working directory, empty if neither has it.
+ */
+static std::string	pythonWorkerPath(void) {
+	char	exe[PATH_MAX];
+	ssize_t	length = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+
+	if (length > 0) {
+		std::string	path(exe, length);
+
+		path = path.substr(0, path.find_last_of('/') + 1) + CGI_POOL_PYTHON_WORKER;
+		if (access(path.c_str(), R_OK) == 0) {
+			return (path);
+		}
+	}
+	return (access(CGI_POOL_PYTHON_WORKER, R_OK) == 0 ? CGI_POOL_PYTHON_WORKER : "");
+}
+
+/**
+ * @brief Say once per interpreter that cgi_pool has no effect for it.
+ * @details Every reactor applies the configuration, and again on each reload.
+ */
+static void	warnUnpooled(const std::string& interpreter) {
+	static std::mutex				mutex;
+	static std::set<std::string>	warned;
+	std::lock_guard<std::mutex>		lock(mutex);
+
+	if (warned.insert(interpreter).second) {
+		std::cerr << "CGI pool: warning: no FastCGI worker available for " << interpreter
+			<< ", cgi_pool is ignored and scripts get a process per request" << std::endl;
+	}
+}
+
+
+
+
+CgiPool::CgiPool(const std::vector<std::string>& command)
+	: _command(command), _config(), _spawnBlockedUntil(0) {
+}
+
+
+
+
+CgiPool::~CgiPool() {
+	for (const std::unique_ptr<CgiWorker>& worker : _workers) {
+		kill(worker->pid, SIGKILL);
+		waitpid(worker->pid, nullptr, 0);
+	}
+	for (pid_t pid : _killed) {
+		waitpid(pid, nullptr, 0);
+	}
+}
+
+
+
+
+void	CgiPool::setConfig(const CgiPoolConfig& config) {
+	_config = config;
+	if (!_config.enabled) {
+		_config.minWorkers = 0;
+		_config.maxWorkers = 0;
+	}
+	for (size_t i = _workers.size(); i-- > 0 && _workers.size() > _config.maxWorkers;) {
+		if (!_workers[i]->busy) {
+			retire(i);
+		}
+	}
+	reap();
+	fill();
+}
+
+
+
+
+void	CgiPool::fill(void) {
+	while (_workers.size() < _config.minWorkers && spawn()) {
+	}
+}
+
+
+
+
+CgiWorker*	CgiPool::acquire(int& socketFd) {
+	reap();
+	for (size_t i = 0; i < _workers.size();) {
+		CgiWorker&	worker = *_workers[i];
+
+		if (worker.busy) {
+			i++;
+			continue;
+		}
+		// An idle worker may have died on its own; it is the only time one is waited for.
+		if (waitpid(worker.pid, nullptr, WNOHANG) == worker.pid) {
+			if (worker.served == 0) {
+				blockSpawning();
+			}
+			_workers.erase(_workers.begin() + i);
+			continue;
+		}
+		socketFd = connectTo(worker);
+		if (socketFd == -1) {
+			retire(i);
+			continue;
+		}
+		worker.busy = true;
+		return (&worker);
+	}
+	if (_workers.size() >= _config.maxWorkers) {
+		return (nullptr);
+	}
+	CgiWorker*	worker = spawn();
+
+	if (!worker || (socketFd = connectTo(*worker)) == -1) {
+		return (nullptr);
+	}
+	worker->busy = true;
+	return (worker);
+}
+
+
+
+
+void	CgiPool::release(CgiWorker* worker, bool completed) {
+	size_t	index = indexOf(worker);
+
+	worker->busy = false;
+	if (!completed && worker->served == 0) {
+		blockSpawning();
+	}
+	if (completed) {
+		worker->served++;
+	}
+	if (!completed || (_config.maxRequests && worker->served >= _config.maxRequests) || _workers.size() > _config.maxWorkers) {
+		retire(index);
+	}
+	reap();
+	fill();
+}
+
+
+
+
+void	CgiPool::discard(CgiWorker* worker) {
+	retire(indexOf(worker));
+	fill();
+}
+
+
+
+
+CgiWorker*	CgiPool::spawn(void) {
+	if (_workers.size() >= _config.maxWorkers || time(nullptr) < _spawnBlockedUntil) {
+		return (nullptr);
+	}
+	std::unique_ptr<CgiWorker>	worker = std::make_unique<CgiWorker>();
+	struct sockaddr_un			addr;
+
+	worker->address = std::string(1, '\0') + "webserv-cgi-" + std::to_string(getpid()) + "-" + std::to_string(++g_workerSequence);
+	worker->served = 0;
+	worker->busy = false;
+	int	listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+	if (listenFd == -1) {
+		return (nullptr);
+	}
+	if (bind(listenFd, reinterpret_cast<struct sockaddr*>(&addr), fillAddress(addr, worker->address)) == -1
+		|| listen(listenFd, CGI_POOL_LISTEN_BACKLOG) == -1) {
+		close(listenFd);
+		return (nullptr);
+	}
+	// posix_spawn() copies no page tables, so replacing workers stays cheap however large the server grows.
+	std::vector<char*>			argv;
+	std::string					parent = std::string(CGI_POOL_PARENT_VARIABLE "=") + std::to_string(getpid());
+	char*						envp[] = {const_cast<char*>(CGI_POOL_WORKER_PATH), &parent[0], nullptr};
+	posix_spawn_file_actions_t	actions;
+	posix_spawnattr_t			attributes;
+	sigset_t					emptyMask;
+
+	for (const std::string& arg : _command) {
+		argv.push_back(const_cast<char*>(arg.c_str()));
+	}
+	argv.push_back(nullptr);
+	sigemptyset(&emptyMask);
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_adddup2(&actions, listenFd, STDIN_FILENO);
+	// Client sockets are not close-on-exec; a long-lived worker holding one would keep the connection open.
+	posix_spawn_file_actions_addclosefrom_np(&actions, 3);
+	posix_spawnattr_init(&attributes);
+	posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGMASK);
+	posix_spawnattr_setsigmask(&attributes, &emptyMask);
+	int	error = posix_spawn(&worker->pid, argv[0], &actions, &attributes, argv.data(), envp);
+
+	posix_spawn_file_actions_destroy(&actions);
+	posix_spawnattr_destroy(&attributes);
+	close(listenFd);
+	if (error != 0) {
+		std::cerr << "CGI pool: cannot spawn " << argv[0] << ": " << strerror(error) << std::endl;
+		return (nullptr);
+	}
+	_workers.push_back(std::move(worker));
+	return (_workers.back().get());
+}
+
+
+
+
+int	CgiPool::connectTo(const CgiWorker& worker) const {
+	struct sockaddr_un	addr;
+	int					fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+	if (fd == -1) {
+		return (-1);
+	}
+	if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), fillAddress(addr, worker.address)) == -1) {
+		close(fd);
+		return (-1);
+	}
+	return (fd);
+}
+
+
+
+
+void	CgiPool::retire(size_t index) {
+	kill(_workers[index]->pid, SIGKILL);
+	_killed.push_back(_workers[index]->pid);
+	_workers.erase(_workers.begin() + index);
+}
+
+
+
+
+void	CgiPool::reap(void) {
+	for (size_t i = 0; i < _killed.size();) {
+		if (waitpid(_killed[i], nullptr, WNOHANG) != 0) {
+			_killed[i] = _killed.back();
+			_killed.pop_back();
+		} else {
+			i++;
+		}
+	}
+}
+
+
+
+
+void	CgiPool::blockSpawning(void) {
+	std::cerr << "CGI pool: " << _command.front() << " worker exited before serving a request, "
+		<< "forking per request for " << CGI_POOL_RESPAWN_DELAY << "s" << std::endl;
+	_spawnBlockedUntil = time(nullptr) + CGI_POOL_RESPAWN_DELAY;
+}
+
+
+
+
+size_t	CgiPool::indexOf(const CgiWorker* worker) const {
+	for (size_t i = 0; i < _workers.size(); i++) {
+		if (_workers[i].get() == worker) {
+			return (i);
+		}
+	}
+	return (_workers.size());
+}
+
+
+
+
+CgiPoolSet::CgiPoolSet() {
+}
+
+
+
+
+void	CgiPoolSet::configure(const std::unordered_map<std::string, CgiPoolConfig>& limits) {
+	for (auto& pool : _pools) {
+		if (!limits.count(pool.first)) {
+			pool.second->setConfig(CgiPoolConfig());
+		}
+	}
+	for (const auto& limit : limits) {
+		std::unique_ptr<CgiPool>&	pool = _pools[limit.first];
+
+		if (!pool) {
+			std::vector<std::string>	command = workerCommand(limit.first);
+
+			if (command.empty()) {
+				warnUnpooled(limit.first);
+				_pools.erase(limit.first);
+				continue;
+			}
+			pool = std::make_unique<CgiPool>(command);
+		}
+		pool->setConfig(limit.second);
+	}
+}
+
+
+
+
+CgiPool*	CgiPoolSet::get(const std::string& interpreter) {
+	auto	it = _pools.find(interpreter);
+
+	return (it != _pools.end() && it->second->isEnabled() ? it->second.get() : nullptr);
+}
+
+
+
+
+std::vector<std::string>	CgiPoolSet::workerCommand(const std::string& interpreter) {
+	size_t		slash = interpreter.find_last_of('/');
+	std::string	name = interpreter.substr(slash == std::string::npos ? 0 : slash + 1);
+
+	if (name.compare(0, 6, "python") == 0) {
+		std::string	worker = pythonWorkerPath();
+
+		if (!worker.empty()) {
+			return {interpreter, worker};
+		}
+	}
+	if (name == "php" || name == "php-cgi") {
+		// php-cgi speaks FastCGI itself when its stdin is a listening socket.
+		std::string	phpCgi = interpreter.substr(0, slash + 1) + "php-cgi";
+
+		if (access(phpCgi.c_str(), X_OK) == 0) {
+			return {phpCgi};
+		}
+	}
+	return {};
+}
+
+
+
+
+void	CgiPoolSet::merge(CgiPoolConfig& merged, const CgiPoolConfig& config) {
+	if (!merged.enabled) {
+		merged = config;
+		return;
+	}
+	merged.minWorkers = std::max(merged.minWorkers, config.minWorkers);
+	merged.maxWorkers = std::max(merged.maxWorkers, config.maxWorkers);
+	// The strictest recycling wins: it bounds what a leaking script can accumulate.
+	if (config.maxRequests && (!merged.maxRequests || config.maxRequests < merged.maxRequests)) {
+		merged.maxRequests = config.maxRequests;
+	}
+}
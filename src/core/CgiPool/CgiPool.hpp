@@ -0,0 +1,198 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   CgiPool.hpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/27 11:05:48 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/27 11:05:48 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef CGIPOOL_HPP
+#define CGIPOOL_HPP
+
+
+
+
+#define CGI_POOL_PYTHON_WORKER	"src/core/CgiPool/fastcgi_worker.py"  // FastCGI responder running python scripts in-process, next to the binary
+#define CGI_POOL_LISTEN_BACKLOG	4
+#define CGI_POOL_RESPAWN_DELAY	5    // seconds a pool stops spawning after a worker died before its first request
+#define CGI_POOL_WORKER_PATH	"PATH=/usr/local/bin:/usr/bin:/bin"
+#define CGI_POOL_PARENT_VARIABLE	"WEBSERV_PID"  // Lets a worker ask to die with the server, see fastcgi_worker.py
+
+
+
+
+#include <ctime>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/types.h>
+#include "../parsingConfFile/CgiPoolConfig.hpp"
+
+
+
+
+/**
+ * @brief One long-lived interpreter process of a pool.
+ */
+struct CgiWorker {
+	pid_t		pid;
+	std::string	address;   ///< Abstract unix socket the worker accepts on, leading NUL included
+	size_t		served;    ///< Requests completed so far
+	bool		busy;      ///< A CGIHandler holds it
+};
+
+/**
+ * @brief Started interpreters of one kind, reused from request to request.
+ * @details Each worker is spawned the way FastCGI applications are: with a
+ *          listening unix socket as its stdin. The pool binds that socket
+ *          before posix_spawn(), so a request can connect as soon as the worker
+ *          exists, and closes its own copy, so connecting to a worker that
+ *          died fails at once. A worker serves one request at a time; it is
+ *          replaced after maxRequests requests or when a request fails.
+ *          Workers are killed with the pool; the python worker also has the
+ *          kernel kill it when the reactor thread that spawned it ends, in
+ *          case the server dies first.
+ *          Only idle workers are ever waited for, with WNOHANG, so the pool
+ *          never blocks the event loop on a child.
+ */
+class CgiPool {
+  private:
+	std::vector<std::string>				_command;          ///< argv of a worker
+	CgiPoolConfig							_config;
+	std::vector<std::unique_ptr<CgiWorker>>	_workers;
+	std::vector<pid_t>						_killed;           ///< Retired workers not reaped yet
+	time_t									_spawnBlockedUntil;
+
+	/**
+	 * @brief Start one worker.
+	 * @return New idle worker, nullptr if the socket, posix_spawn() or the limits forbid it.
+	 */
+	CgiWorker* spawn(void);
+
+	/**
+	 * @brief Connect to a worker.
+	 * @param worker Worker to connect to.
+	 * @return Connected socket (blocking, close-on-exec), -1 if the worker is gone.
+	 */
+	int connectTo(const CgiWorker& worker) const;
+
+	/**
+	 * @brief Kill a worker and drop it; it is reaped later.
+	 * @param index Position of the worker in _workers.
+	 */
+	void retire(size_t index);
+
+	/**
+	 * @brief Reap the retired workers that exited.
+	 */
+	void reap(void);
+
+	/**
+	 * @brief Stop spawning for CGI_POOL_RESPAWN_DELAY seconds: the command does not start.
+	 */
+	void blockSpawning(void);
+
+	size_t indexOf(const CgiWorker* worker) const;
+
+  public:
+	/**
+	 * @brief Create an empty pool; call setConfig() to start workers.
+	 * @param command argv of a worker, interpreter first.
+	 */
+	CgiPool(const std::vector<std::string>& command);
+	CgiPool(const CgiPool&) = delete;
+	CgiPool& operator=(const CgiPool&) = delete;
+
+	/**
+	 * @brief Kill and reap every worker.
+	 */
+	~CgiPool();
+
+	/**
+	 * @brief Change the limits, retire the idle workers above them and start up to the minimum.
+	 * @param config New limits; a disabled config empties the pool as workers go idle.
+	 */
+	void setConfig(const CgiPoolConfig& config);
+
+	bool isEnabled(void) const { return (_config.enabled); }
+
+	/**
+	 * @brief Start workers until the minimum is reached.
+	 */
+	void fill(void);
+
+	/**
+	 * @brief Take an idle worker, starting one if all are busy and the maximum allows it.
+	 * @param socketFd Set to a connection to the worker.
+	 * @return Busy worker, nullptr if none is available (the caller forks instead).
+	 */
+	CgiWorker* acquire(int& socketFd);
+
+	/**
+	 * @brief Give a worker back once its request ended.
+	 * @param worker Worker returned by acquire().
+	 * @param completed The worker answered with END_REQUEST; otherwise it is replaced.
+	 */
+	void release(CgiWorker* worker, bool completed);
+
+	/**
+	 * @brief Kill a worker whose request was abandoned (timeout, client gone).
+	 * @param worker Worker returned by acquire().
+	 */
+	void discard(CgiWorker* worker);
+
+	/**
+	 * @brief Get the number of started workers.
+	 * @return Idle and busy workers.
+	 */
+	size_t size(void) const { return (_workers.size()); }
+};
+
+/**
+ * @brief The CGI worker pools of one reactor, one per interpreter.
+ */
+class CgiPoolSet {
+  private:
+	std::unordered_map<std::string, std::unique_ptr<CgiPool>>	_pools;  ///< By interpreter path
+
+  public:
+	CgiPoolSet();
+	CgiPoolSet(const CgiPoolSet&) = delete;
+	CgiPoolSet& operator=(const CgiPoolSet&) = delete;
+
+	/**
+	 * @brief Apply the limits of a configuration, starting and stopping workers.
+	 * @param limits Limits of every pooled interpreter; the pools of the others are emptied.
+	 */
+	void configure(const std::unordered_map<std::string, CgiPoolConfig>& limits);
+
+	/**
+	 * @brief Get the pool of an interpreter.
+	 * @param interpreter Interpreter path, as CGIHandler resolves it.
+	 * @return Pool, nullptr if the interpreter is not pooled.
+	 */
+	CgiPool* get(const std::string& interpreter);
+
+	/**
+	 * @brief Get the command that starts a FastCGI worker for an interpreter.
+	 * @param interpreter Interpreter path.
+	 * @return argv of the worker, empty if the interpreter cannot be pooled.
+	 * @note python runs CGI_POOL_PYTHON_WORKER, looked up from the directory of the webserv binary,
+	 *       then from the working directory; php is pooled through php-cgi, when installed next to it.
+	 */
+	static std::vector<std::string> workerCommand(const std::string& interpreter);
+
+	/**
+	 * @brief Merge the limits of two locations pooling the same interpreter.
+	 * @param merged Limits so far, updated in place.
+	 * @param config Limits of one more location.
+	 */
+	static void merge(CgiPoolConfig& merged, const CgiPoolConfig& config);
+};
+
+#endif
@@ -0,0 +1,387 @@
+#!/usr/bin/env python3
+"""FastCGI responder of the webserv CGI pool.
+
+Started by CgiPool with a listening unix socket as stdin, the way FastCGI
+applications are spawned. The script named by SCRIPT_FILENAME runs in this
+process as soon as its parameters arrived, with the request's environment,
+the FCGI_STDIN records as stdin (read from the connection as the script asks
+for them) and its stdout sent back as FCGI_STDOUT. What makes the next request cheap is the
+interpreter already running; the server replaces the worker after a number
+of requests, or as soon as one fails.
+
+Each run starts from the worker's own state: modules the script imported
+are dropped from sys.modules, signal handlers are put back, and fds 1 and 2
+point at /dev/null while it runs, so a raw os.write() cannot reach the
+server. Anything else a script leaves behind (threads, open files, changes
+to modules the worker itself had loaded) is not undone: scripts that rely
+on state between runs, or on being a fresh process, are not supported.
+
+Given an address (unix:<path> or <host>:<port>), it listens there instead
+and stands in for an application such as php-fpm behind fastcgi_pass: it
+keeps connections open, answers FCGI_GET_VALUES and takes several
+interleaved requests per connection. Scripts still run one at a time.
+"""
+
+import ctypes
+import io
+import os
+import runpy
+import selectors
+import signal
+import socket
+import struct
+import sys
+import traceback
+
+FCGI_VERSION_1 = 1
+FCGI_BEGIN_REQUEST = 1
+FCGI_ABORT_REQUEST = 2
+FCGI_END_REQUEST = 3
+FCGI_PARAMS = 4
+FCGI_STDIN = 5
+FCGI_STDOUT = 6
+FCGI_STDERR = 7
+FCGI_GET_VALUES = 9
+FCGI_GET_VALUES_RESULT = 10
+FCGI_UNKNOWN_TYPE = 11
+FCGI_KEEP_CONN = 1
+FCGI_RESPONDER = 1
+FCGI_REQUEST_COMPLETE = 0
+FCGI_UNKNOWN_ROLE = 3
+FCGI_MAX_CONTENT_LEN = 65535
+PR_SET_PDEATHSIG = 1
+MAX_REQUESTS_PER_CONNECTION = 16
+STDOUT_SEND_THRESHOLD = 8192  # Output held before it goes out unflushed, like a pipe's block buffering
+
+HEADER = struct.Struct("!BBHHBx")
+BASE_DIR = os.getcwd()
+# Set by the interpreter itself at startup (C locale coercion), so a script exec'd by the server sees it too.
+INTERPRETER_ENV = {name: os.environ[name] for name in ("LC_CTYPE",) if name in os.environ}
+SIGNALS = [number for number in signal.valid_signals() if number not in (signal.SIGKILL, signal.SIGSTOP)]
+
+
+def write_record(out, rtype, request_id, data=b""):
+    offset = 0
+    while True:
+        chunk = data[offset:offset + FCGI_MAX_CONTENT_LEN]
+        padding = -len(chunk) % 8
+        out += HEADER.pack(FCGI_VERSION_1, rtype, request_id, len(chunk), padding)
+        out += chunk
+        out += b"\0" * padding
+        offset += len(chunk)
+        if offset >= len(data):
+            return
+
+
+def write_stream(out, rtype, request_id, data):
+    if data:
+        write_record(out, rtype, request_id, data)
+    write_record(out, rtype, request_id)
+
+
+def read_length(data, offset):
+    if data[offset] < 0x80:
+        return data[offset], offset + 1
+    return struct.unpack_from("!I", data, offset)[0] & 0x7FFFFFFF, offset + 4
+
+
+def write_length(out, length):
+    out += struct.pack("!B", length) if length < 0x80 else struct.pack("!I", length | 0x80000000)
+
+
+def encode_params(params):
+    out = bytearray()
+    for name, value in params.items():
+        write_length(out, len(name))
+        write_length(out, len(value))
+        out += name.encode("latin-1") + value.encode("latin-1")
+    return bytes(out)
+
+
+def parse_params(data):
+    params = {}
+    offset = 0
+    while offset < len(data):
+        name_length, offset = read_length(data, offset)
+        value_length, offset = read_length(data, offset)
+        name = data[offset:offset + name_length]
+        offset += name_length
+        params[name.decode("latin-1")] = data[offset:offset + value_length].decode("latin-1")
+        offset += value_length
+    return params
+
+
+class StdoutRecords(io.BufferedIOBase):
+    """Stdout of a script: sent as FCGI_STDOUT records on each flush, or once enough piled up."""
+
+    def __init__(self, sock, request_id):
+        super().__init__()
+        self.sock = sock
+        self.request_id = request_id
+        self.pending = bytearray()
+
+    def writable(self):
+        return True
+
+    def write(self, data):
+        if self.closed:
+            raise ValueError("write to closed file")
+        self.pending += data
+        if len(self.pending) >= STDOUT_SEND_THRESHOLD:
+            self.send()
+        return len(data)
+
+    def flush(self):
+        # close() flushes before it marks the stream closed.
+        if not self.closed:
+            self.send()
+
+    def send(self):
+        if self.pending:
+            out = bytearray()
+            write_record(out, FCGI_STDOUT, self.request_id, bytes(self.pending))
+            self.pending.clear()
+            self.sock.sendall(out)
+
+    def end(self):
+        """Send what is left and the empty record ending the stream, even if the script closed it."""
+        out = bytearray()
+        write_stream(out, FCGI_STDOUT, self.request_id, bytes(self.pending))
+        self.pending.clear()
+        self.sock.sendall(out)
+
+
+class StdinRecords(io.RawIOBase):
+    """Stdin of a script: the body of its request, received as the script reads it."""
+
+    def __init__(self, connection, request):
+        super().__init__()
+        self.connection = connection
+        self.request = request
+
+    def readable(self):
+        return True
+
+    def readinto(self, buffer):
+        request = self.request
+        # Records of other requests on the connection are queued meanwhile; a lost connection is EOF.
+        while not request.body and not request.stdin_done:
+            if not self.connection.receive():
+                request.stdin_done = True
+        length = min(len(buffer), len(request.body))
+        buffer[:length] = request.body[:length]
+        del request.body[:length]
+        return length
+
+
+def run_script(params, stdin, stdout):
+    """Run one CGI script as if it had been exec'd, writing its output to stdout; return (stderr, exit status)."""
+    script = os.path.join(BASE_DIR, params.get("SCRIPT_FILENAME", ""))
+    script_dir = os.path.dirname(script)
+    stderr = io.BytesIO()
+    saved = (sys.stdin, sys.stdout, sys.stderr, sys.argv, sys.path[0])
+    modules = set(sys.modules)
+    handlers = {number: signal.getsignal(number) for number in SIGNALS}
+    saved_fds = [os.dup(1), os.dup(2)]
+    status = 0
+
+    os.environ.clear()
+    os.environ.update(INTERPRETER_ENV)
+    os.environ.update(params)
+    # Same encoding and newline handling as the standard streams of a python started by the server.
+    sys.stdin = io.TextIOWrapper(io.BufferedReader(stdin), "utf-8", "surrogateescape", newline="\n")
+    sys.stdout = io.TextIOWrapper(stdout, "utf-8", "surrogateescape", newline="\n", write_through=True)
+    sys.stderr = io.TextIOWrapper(stderr, "utf-8", "backslashreplace", newline="\n", write_through=True)
+    sys.argv = [os.path.basename(script)]
+    sys.path[0] = script_dir
+    devnull = os.open(os.devnull, os.O_WRONLY)
+    os.dup2(devnull, 1)
+    os.dup2(devnull, 2)
+    os.close(devnull)
+    try:
+        os.chdir(script_dir)
+        runpy.run_path(script, run_name="__main__")
+    except SystemExit as exit_request:
+        if isinstance(exit_request.code, int):
+            status = exit_request.code
+        elif exit_request.code is not None:
+            print(exit_request.code, file=sys.stderr)
+            status = 1
+    except BaseException:
+        traceback.print_exc()
+        status = 1
+    finally:
+        # Read the buffer before the wrapper is dropped: collecting a wrapper closes its buffer.
+        errors = stderr.getvalue() if not stderr.closed else b""
+        sys.stdin, sys.stdout, sys.stderr, sys.argv, sys.path[0] = saved
+        os.chdir(BASE_DIR)
+        for fd, saved_fd in enumerate(saved_fds, 1):
+            os.dup2(saved_fd, fd)
+            os.close(saved_fd)
+        for name in set(sys.modules) - modules:
+            del sys.modules[name]
+        for number, handler in handlers.items():
+            if handler is not None and signal.getsignal(number) is not handler:
+                signal.signal(number, handler)
+    return errors, status
+
+
+class Request:
+    def __init__(self, keep_conn):
+        self.keep_conn = keep_conn
+        self.params, self.body = bytearray(), bytearray()
+        self.params_done = self.stdin_done = self.started = False
+
+
+class Connection:
+    """Records of one connection; requests are told apart by their id."""
+
+    def __init__(self, sock):
+        self.sock = sock
+        self.buffer = bytearray()
+        self.requests = {}
+        self.open = True
+
+    def receive(self):
+        """Read and handle the records that arrived; return False once the connection is to be closed."""
+        data = self.sock.recv(65536)
+        self.buffer += data
+        self.open = self.open and bool(data) and self.feed()
+        return self.open
+
+    def feed(self):
+        """Handle the complete records received so far; return False on a protocol error."""
+        while len(self.buffer) >= HEADER.size:
+            version, rtype, rid, length, padding = HEADER.unpack_from(self.buffer)
+            if version != FCGI_VERSION_1:
+                return False
+            if len(self.buffer) < HEADER.size + length + padding:
+                break
+            content = bytes(self.buffer[HEADER.size:HEADER.size + length])
+            del self.buffer[:HEADER.size + length + padding]
+            if not self.handle(rtype, rid, content):
+                return False
+        return True
+
+    def end_request(self, rid, app_status, protocol_status):
+        out = bytearray()
+        out += HEADER.pack(FCGI_VERSION_1, FCGI_END_REQUEST, rid, 8, 0)
+        out += struct.pack("!IB3x", app_status & 0xFFFFFFFF, protocol_status)
+        self.sock.sendall(out)
+
+    def handle(self, rtype, rid, content):
+        """Record the content of one record; scripts are run by serve()."""
+        out = bytearray()
+        if rid == 0:
+            if rtype == FCGI_GET_VALUES:
+                limits = {"FCGI_MPXS_CONNS": "1", "FCGI_MAX_REQS": str(MAX_REQUESTS_PER_CONNECTION), "FCGI_MAX_CONNS": "64"}
+                asked = parse_params(content)
+                write_record(out, FCGI_GET_VALUES_RESULT, 0, encode_params({k: v for k, v in limits.items() if k in asked}))
+            else:
+                write_record(out, FCGI_UNKNOWN_TYPE, 0, struct.pack("!B7x", rtype))
+            self.sock.sendall(out)
+            return True
+        if rtype == FCGI_BEGIN_REQUEST:
+            role, flags = struct.unpack_from("!HB", content)
+            if role != FCGI_RESPONDER:
+                self.end_request(rid, 0, FCGI_UNKNOWN_ROLE)
+                return True
+            self.requests[rid] = Request(bool(flags & FCGI_KEEP_CONN))
+            return True
+        request = self.requests.get(rid)
+        if request is None:
+            return True
+        if rtype == FCGI_ABORT_REQUEST:
+            # A running script cannot be stopped: it reads EOF and its END_REQUEST ends the request.
+            request.stdin_done = True
+            if request.started:
+                return True
+            del self.requests[rid]
+            self.end_request(rid, 0, FCGI_REQUEST_COMPLETE)
+            return request.keep_conn
+        if rtype == FCGI_PARAMS:
+            request.params += content
+            request.params_done = not content
+        elif rtype == FCGI_STDIN and not request.stdin_done:
+            request.body += content
+            request.stdin_done = not content
+        return True
+
+    def serve(self):
+        """Run the scripts whose parameters are complete, one at a time; return False once the connection is to be closed."""
+        while self.open:
+            ready = [rid for rid, request in self.requests.items() if request.params_done and not request.started]
+            if not ready:
+                return True
+            rid = ready[0]
+            request = self.requests[rid]
+            request.started = True
+            stdout = StdoutRecords(self.sock, rid)
+            stderr, status = run_script(parse_params(bytes(request.params)), StdinRecords(self, request), stdout)
+            del self.requests[rid]
+            stdout.end()
+            if stderr:
+                out = bytearray()
+                write_stream(out, FCGI_STDERR, rid, stderr)
+                self.sock.sendall(out)
+            self.end_request(rid, status, FCGI_REQUEST_COMPLETE)
+            if not request.keep_conn:
+                return False
+        return False
+
+
+def listen(address):
+    if address.startswith("unix:"):
+        path = address[len("unix:"):]
+        if os.path.exists(path):
+            os.unlink(path)
+        listener = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        listener.bind(path)
+    else:
+        host, _, port = address.rpartition(":")
+        listener = socket.create_server((host.strip("[]"), int(port)), reuse_port=False)
+    listener.listen(64)
+    return listener
+
+
+def die_with_server():
+    """Have the kernel kill a pool worker when the server thread that spawned it ends.
+
+    The server spawns workers with posix_spawn(), which cannot set this, and
+    passes its pid: a server that died before this point left us to init.
+    """
+    parent = os.environ.pop("WEBSERV_PID", None)
+    if parent is None:
+        return
+    try:
+        ctypes.CDLL(None, use_errno=True).prctl(PR_SET_PDEATHSIG, signal.SIGKILL)
+    except (AttributeError, OSError):
+        return
+    if os.getppid() != int(parent):
+        sys.exit(1)
+
+
+def main():
+    if len(sys.argv) <= 1:
+        die_with_server()
+    listener = listen(sys.argv[1]) if len(sys.argv) > 1 else socket.socket(fileno=0)
+    selector = selectors.DefaultSelector()
+    selector.register(listener, selectors.EVENT_READ)
+    while True:
+        for key, _ in selector.select():
+            if key.fileobj is listener:
+                conn, _ = listener.accept()
+                selector.register(conn, selectors.EVENT_READ, Connection(conn))
+                continue
+            connection = key.data
+            try:
+                keep = connection.receive() and connection.serve()
+            except OSError:
+                keep = False
+            if not keep:
+                selector.unregister(connection.sock)
+                connection.sock.close()
+
+
+if __name__ == "__main__":
+    main()
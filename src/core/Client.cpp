@@ -13,8 +13,9 @@
 #include "Client.hpp" 
 
 
-Client::Client(int serverFd, ServerManager* serverManager) : _headersParsed(false), _clientBytesSent(0),
-	_serverFd(serverFd), _serverManager(serverManager), _closeAfterResponse(false){
+Client::Client(std::shared_ptr<const Server> listener, ServerManager* serverManager) : _headersParsed(false),
+	_listener(std::move(listener)), _serverManager(serverManager), _lastActiveTime(std::time(nullptr)), _closeAfterResponse(false),
+	_requestsServed(0), _cgiOutputPaused(false) {
 	}
 
 
@@ -26,15 +27,6 @@ Client::~Client() {
 
 
 
-Client::Client(const Client& other) : _request(other._request), _startLineAndHeadersBuffer(other._startLineAndHeadersBuffer),
-	_bodyBuffer(other._bodyBuffer), _headersParsed(other._headersParsed), _bodyStart(other._bodyStart),
-	_clientBytesSent(other._clientBytesSent), _clientResponse(other._clientResponse), _serverFd(other._serverFd),
-	_serverManager(other._serverManager), _lastActiveTime(other._lastActiveTime), _closeAfterResponse(other._closeAfterResponse) {
-}
-
-
-
-
 
 void	Client::setLastActiveTime( std::time_t timeStamp) {
 	this->_lastActiveTime = timeStamp;
@@ -50,59 +42,41 @@ std::time_t	Client::getLastActiveTime( void ) const {
 
 
 
-int	Client::getServerFd(void) const {
-	return(_serverFd);
-}
-
-
-
-
-size_t& Client::getClientsBytesSent(void) {
-	return(_clientBytesSent);
+const Server&	Client::getListener(void) const {
+	return(*_listener);
 }
 
 
 
 
-std::string	Client::prepareResponse(int clientFd) {
-	int		socketClientConnectedTo = this->getServerFd();
-	Response _response(&_request, _serverManager, socketClientConnectedTo, clientFd);
-	_response.generateResponse();
-	if (getAnyHeader(_response.getHeaders(), "Connection") == "close")
-		_closeAfterResponse = true;
-	return (_response.getRawResponse());
-}
-
-
-
 //curl -v -H "Host: server3.com" http://127.0.0.1:8055/
 
 bool Client::headersComplete(const std::string& request) {
-	// Check if the request ends with a double CRLF, indicating the end of headers
-	size_t pos = request.find("\r\n\r\n");
-	if (pos == std::string::npos) {
-		return false; // No end of headers found
-	}
-	_bodyStart = pos + 4; // Set the start of the body after the headers
-	return true;
+	// The parser resumes where the previous recv() left it, so bytes are only scanned once.
+	RequestParseState	state = _parser.parse(request.data(), request.size());
+
+	return (state == PARSE_DONE || state == PARSE_FAILED);
 }
 
-bool Client::bodyComplete(const std::string& body) const {
+bool Client::bodyComplete(const std::string& body, size_t& bodyLength) const {
 	// Check if the body is complete based on the Content-Length header or chunked transfer encoding
-	auto it = _request.getHeaders().find("Content-Length");
-	if (it != _request.getHeaders().end()) {
-		int contentLength = std::stoi(it->second);
-		return body.size() >= static_cast<size_t>(contentLength);
+	if (!_request.getIsChunked()) {
+		bodyLength = _request.getBodySize();
+		return body.size() >= bodyLength;
 	}
-	if (_request.getIsChunked()) {
+	else {
+		if (body.compare(0, 5, "0\r\n\r\n") == 0) {
+			bodyLength = 5;
+			return true;
+		}
 		auto it = body.find("\r\n0\r\n\r\n");
 		if (it != std::string::npos) {
 			// If we find the end of the chunked body, we consider it complete
+			bodyLength = it + 7;
 			return true;
 		}
 		return false; // Chunked transfer encoding, but we haven't found the end yet
 	}
-	return false; // No Content-Length or chunked transfer encoding, so we can't determine completeness
 }
 
 
@@ -113,44 +87,15 @@ void    Client::handleRequest (int clientFd) {
     bytesRead = recv(clientFd, requestBuffer, REQUEST_READ_BUFFER, 0);
     if (bytesRead > 0)
     {
-		std::string incomingData(requestBuffer, bytesRead);
-		if (!_headersParsed) {
-			_startLineAndHeadersBuffer += incomingData;
-			if (!headersComplete(_startLineAndHeadersBuffer)) {
-				std::cout << "Headers not complete yet, waiting for more data..." << std::endl;
-				return;
-			}
-			_request.reset();
-			_request = Request(_startLineAndHeadersBuffer);
-			try {
-				if (!_headersParsed)
-					_request.parseRequest();
-			} catch(const std::exception& e) {
-				std::cerr << "Failed to parse request: "<< e.what() << '\n';
-				_serverManager->closeClientFd(clientFd);
-				return;
-			}
-			_headersParsed = true;
-		}
-		// If headers are parsed, we can now check for the body. It is optional depending on request type, 
-		// so it is separated from the headers parsing logic.
-		if (_headersParsed && _request.getBodyExpected() && _request.getStatusCode() < 400)
-		{
-			_bodyBuffer += incomingData.substr(_bodyStart); // we append the chunk that may have been read with headers
-			_bodyStart = 0;
-			if (bodyComplete(_bodyBuffer)) {
-				_request.setBody(_bodyBuffer);
-				_request.parseBody();
-				_bodyBuffer.clear(); // Clear the body buffer after parsing
-			} else {
-				// std::cout << "Body not complete yet, waiting for more data..." << std::endl;
-				return;
-			}
+		_lastActiveTime = std::time(nullptr);
+		if (_timer.type == TIMER_KEEPALIVE) {
+			armTimer(TIMER_HEADER, clientFd);
 		}
-		_startLineAndHeadersBuffer.clear(); // Clear the buffer after parsing headers and body
-		_headersParsed = false; // Reset the headers parsed flag for the next request
-		// std::cout << "Request start line: " << _request.getPath() << std::endl;
-		_serverManager->setEpollCtl(clientFd, EPOLLOUT, EPOLL_CTL_MOD);
+		if (!_headersParsed)
+			_startLineAndHeadersBuffer.append(requestBuffer, bytesRead);
+		else
+			_bodyBuffer.append(requestBuffer, bytesRead);
+		processRequestBuffer(clientFd);
         return ;
     }
     else if (bytesRead == 0) {
@@ -165,51 +110,276 @@ void    Client::handleRequest (int clientFd) {
 }
 
 
+void	Client::processRequestBuffer(int clientFd) {
+	if (!_headersParsed) {
+		if (!headersComplete(_startLineAndHeadersBuffer)) {
+			std::cout << "Headers not complete yet, waiting for more data..." << std::endl;
+			return;
+		}
+		size_t	headSize = _parser.getHeadSize();
+
+		_request.parseRequest(_parser, _startLineAndHeadersBuffer);
+		_headersParsed = true;
+		// Whatever followed the headers is either the body or the next pipelined request. Move it out
+		// and shrink the head buffer in place: the request views it until the response is sent.
+		_bodyBuffer.assign(_startLineAndHeadersBuffer, headSize, std::string::npos);
+		_startLineAndHeadersBuffer.resize(headSize);
+	}
+	// If headers are parsed, we can now check for the body. It is optional depending on request type, 
+	// so it is separated from the headers parsing logic.
+	if (_request.getBodyExpected() && _request.getStatusCode() < 400)
+	{
+		size_t	bodyLength = 0;
+		if (!bodyComplete(_bodyBuffer, bodyLength)) {
+			armTimer(TIMER_BODY, clientFd);
+			return;
+		}
+		// The buffer becomes the body; only pipelined bytes after it are copied back.
+		std::string	body = std::move(_bodyBuffer);
+
+		_bodyBuffer.assign(body, bodyLength, std::string::npos);
+		body.resize(bodyLength);
+		_request.setBody(std::move(body));
+		_request.parseBody();
+	}
+	// _bodyBuffer now only holds pipelined bytes; they become the next head once this response is sent.
+	armTimer(TIMER_SEND, clientFd);
+	_serverManager->setEpollCtl(clientFd, EPOLLOUT, EPOLL_CTL_MOD);
+}
+
+
 void	Client::handleResponse(int clientFd) {
-	if (_clientResponse.empty()) {
-		_response = std::make_unique<Response>(&_request, _serverManager, _serverFd, clientFd);
+	if (!_response) {
+		_response = std::make_unique<Response>(&_request, _serverManager, _listener, clientFd, _requestsServed);
 		_response->generateResponse();
-		if (getAnyHeader(_response->getHeaders(), "Connection") == "close")
-			_closeAfterResponse = true;
-		_clientResponse = _response->getRawResponse();
+		_closeAfterResponse = !_response->getKeepAlive();
 		if (_response->getIsCGI()) {
-			// std::cout << "CGI is coming" << std::endl;
-			_serverManager->setEpollCtl(clientFd, EPOLLIN, EPOLL_CTL_MOD);
+			// Park the socket until the CGI pipes are drained; only errors and hang-ups are reported meanwhile.
+			armTimer(TIMER_CGI, clientFd);
+			_serverManager->setEpollCtl(clientFd, 0, EPOLL_CTL_MOD);
 			return;
 		}
-		if (_clientResponse.empty()) {
+		if (_response->buildOutput().isDone()) {
 			std::cerr << "Error: Response is empty, closing client connection." << std::endl;
 			_serverManager->closeClientFd(clientFd);
 			return;
 		}
-		_clientBytesSent = 0; // Reset bytes sent for the new response
 	}
-	sendResponse(_clientResponse, clientFd);
+	sendResponse(clientFd);
 }
 
-void Client::sendResponse(std::string responseBody, int clientFd)
-{
-	const char*	servResp = responseBody.c_str();
-	size_t		responseSize = responseBody.size();
-	ssize_t		bytesSent = send(clientFd, servResp + _clientBytesSent, responseSize - _clientBytesSent, 0);
-	if (bytesSent == -1) {
+void	Client::handleCgiOutput(int clientFd) {
+	CGIHandler*	cgiHandler = getCgiHandler();
+
+	if (!cgiHandler) {
+		return;
+	}
+	if (cgiHandler->hasOverflowed()) {
+		return (abortCgi(clientFd, cgiHandler->isFastCgiPass() ? 502 : 500));
+	}
+	if (cgiHandler->awaitsExit() && !_cgiExitTimer.isArmed()) {
+		_serverManager->getTimerWheel().arm(_cgiExitTimer, TIMER_CGI_EXIT, clientFd, CGI_EXIT_POLL_MS);
+	}
+	if (!_response->getStreamBody().isOpen()) {
+		// Output that is complete but for stderr or the exit status is still worth a Content-Length.
+		if (!cgiHandler->hasHeaders() || (cgiHandler->isOutputDone() && !cgiHandler->isDone())) {
+			return;
+		}
+		if (cgiHandler->isDone()) {
+			_response->generateCGIResponse();
+			_response->buildOutput();
+			armTimer(TIMER_SEND, clientFd);
+			_serverManager->setEpollCtl(clientFd, EPOLLOUT, EPOLL_CTL_MOD);
+			return;
+		}
+		_response->startCgiStream();
+		_response->buildOutput();
+		_closeAfterResponse = !_response->getKeepAlive();
+	}
+	if (!_response->streamCgiOutput()) {
+		_closeAfterResponse = true;
+	}
+	updateCgiStream(clientFd);
+}
+
+void	Client::updateCgiStream(int clientFd) {
+	StreamBody&	stream = _response->getStreamBody();
+	bool		full = stream.getPending() >= STREAM_BODY_HIGH_WATER;
+
+	if (full != _cgiOutputPaused) {
+		_cgiOutputPaused = full;
+		_serverManager->pauseCgiOutput(this, full);
+	}
+	if (!_response->getOutput().isDone() || stream.getPending() > 0 || stream.isFinished()) {
+		armTimer(TIMER_SEND, clientFd);
 		_serverManager->setEpollCtl(clientFd, EPOLLOUT, EPOLL_CTL_MOD);
 		return;
 	}
-	_clientBytesSent += bytesSent;
-	if (_clientBytesSent == responseSize) {
-		_clientBytesSent = 0;
+	// Everything is out: wait for the script again, as long as it may stay silent.
+	armTimer(TIMER_CGI, clientFd);
+	_serverManager->setEpollCtl(clientFd, 0, EPOLL_CTL_MOD);
+}
+
+void	Client::handleCgiTimeout(int clientFd) {
+	std::cerr << "CGI script timed out, answering 504 on fd " << clientFd << std::endl;
+	abortCgi(clientFd, 504);
+}
+
+void	Client::pollCgiExit(int clientFd) {
+	CGIHandler*	cgiHandler = getCgiHandler();
+
+	if (!cgiHandler) {
+		return;
+	}
+	cgiHandler->reap();
+	handleCgiOutput(clientFd);
+}
+
+void	Client::abortCgi(int clientFd, int statusCode) {
+	CGIHandler*	cgiHandler = getCgiHandler();
+
+	if (cgiHandler) {
+		_serverManager->closeCgiPipes(this);
+		cgiHandler->terminate();
+	}
+	TimerWheel::cancel(_cgiExitTimer);
+	// The status line is out: all the client can still learn is that the body is cut short.
+	if (_response->getStreamBody().isOpen()) {
 		_serverManager->closeClientFd(clientFd);
+		return;
 	}
+	_response->setStatusCode(statusCode);
+	_response->generateErrorResponse();
+	_response->buildOutput();
+	armTimer(TIMER_SEND, clientFd);
+	_serverManager->setEpollCtl(clientFd, EPOLLOUT, EPOLL_CTL_MOD);
 }
 
-std::string Client::getAnyHeader(std::unordered_map<std::string, std::string> headers, std::string headerName) {
-	std::unordered_map<std::string, std::string>::iterator it = headers.find(headerName);
+CGIHandler*	Client::getCgiHandler(void) const {
+	if (!_response) {
+		return (nullptr);
+	}
+	return (_response->getCgiHandler());
+}
 
-	if (it != headers.end()) {
-		return (it->second);
+void Client::sendResponse(int clientFd)
+{
+	SegmentQueue&	output = _response->getOutput();
+	FileBody*		fileBody = _response->getFileBody().isOpen() ? &_response->getFileBody() : nullptr;
+	StreamBody*		streamBody = _response->getStreamBody().isOpen() ? &_response->getStreamBody() : nullptr;
+
+	if (!output.isDone()) {
+		// Tell the kernel the payload follows, so headers and payload leave in full segments.
+		int		flags = (fileBody && !fileBody->isDone()) || (streamBody && streamBody->getPending() > 0) ? MSG_MORE : 0;
+		ssize_t	bytesSent = output.sendTo(clientFd, flags);
+		if (bytesSent == -1) {
+			_serverManager->closeClientFd(clientFd);
+			return;
+		}
+		if (bytesSent > 0) {
+			armTimer(TIMER_SEND, clientFd);
+		}
+		if (!output.isDone()) {
+			return;
+		}
 	}
-	else {
-		return ("");
+	if (fileBody && !fileBody->isDone()) {
+		ssize_t	bytesSent = fileBody->sendTo(clientFd);
+		if (bytesSent == -1) {
+			std::cerr << "sendfile failed: " << strerror(errno) << std::endl;
+			_serverManager->closeClientFd(clientFd);
+			return;
+		}
+		if (bytesSent > 0) {
+			armTimer(TIMER_SEND, clientFd);
+		}
+	}
+	if (streamBody && !streamBody->isDone()) {
+		ssize_t	bytesSent = streamBody->sendTo(clientFd);
+		if (bytesSent == -1) {
+			_serverManager->closeClientFd(clientFd);
+			return;
+		}
+		if (bytesSent > 0) {
+			armTimer(TIMER_SEND, clientFd);
+		}
+		if (!streamBody->isDone()) {
+			// The client caught up: let the script write again and take what it wrote meanwhile.
+			if (streamBody->getPending() < STREAM_BODY_HIGH_WATER) {
+				handleCgiOutput(clientFd);
+			}
+			return;
+		}
+	}
+	if (!fileBody || fileBody->isDone()) {
+		if (_closeAfterResponse) {
+			_serverManager->closeClientFd(clientFd);
+			return;
+		}
+		resetForNextRequest(clientFd);
+	}
+}
+
+void	Client::resetForNextRequest(int clientFd) {
+	// A pipelined request may already be waiting in the buffer.
+	armTimer(_bodyBuffer.empty() ? TIMER_KEEPALIVE : TIMER_HEADER, clientFd);
+	TimerWheel::cancel(_cgiExitTimer);
+	_response.reset();
+	_request.reset();
+	_parser.reset();
+	_headersParsed = false;
+	_cgiOutputPaused = false;
+	// Swapping keeps both allocations around for the next request on this connection.
+	_startLineAndHeadersBuffer.swap(_bodyBuffer);
+	_bodyBuffer.clear();
+	_requestsServed++;
+	_lastActiveTime = std::time(nullptr);
+	_serverManager->setEpollCtl(clientFd, EPOLLIN, EPOLL_CTL_MOD);
+	if (!_startLineAndHeadersBuffer.empty()) {
+		processRequestBuffer(clientFd);
+	}
+}
+
+const vServer*	Client::getTimeoutConfig(void) const {
+	if (_response && _response->getServerConfig()) {
+		return (_response->getServerConfig());
+	}
+	const std::vector<const vServer*>&	configs = _listener->getServConfigs();
+
+	return (configs.empty() ? nullptr : configs.front());
+}
+
+void	Client::armTimer(TimerType type, int clientFd) {
+	const vServer*	config = getTimeoutConfig();
+	size_t			seconds = 0;
+
+	switch (type) {
+		case TIMER_HEADER:
+			seconds = config ? config->getServerHeaderTimeout() : DEFAULT_CLIENT_TIMEOUT;
+		break;
+
+		case TIMER_BODY:
+			seconds = config ? config->getServerBodyTimeout() : DEFAULT_CLIENT_TIMEOUT;
+		break;
+
+		case TIMER_SEND:
+			seconds = config ? config->getServerSendTimeout() : DEFAULT_CLIENT_TIMEOUT;
+		break;
+
+		case TIMER_KEEPALIVE:
+			seconds = config ? config->getServerKeepaliveTimeout() : DEFAULT_KEEPALIVE_TIMEOUT;
+		break;
+
+		case TIMER_CGI:
+			seconds = getCgiHandler() ? getCgiHandler()->getTimeout() : _request.getTimeout();
+		break;
+
+		default:
+		break;
+	}
+	if (seconds == 0) {
+		TimerWheel::cancel(_timer);
+		return;
 	}
+	_serverManager->getTimerWheel().arm(_timer, type, clientFd, static_cast<uint64_t>(seconds) * 1000);
 }
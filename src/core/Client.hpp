@@ -22,6 +22,7 @@
 #include "ServerManager.hpp"
 #include "Server.hpp"
 #include "Response/Response.hpp"
+#include "TimerWheel/TimerWheel.hpp"
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <unistd.h>
@@ -31,7 +32,9 @@
 
 
 class ServerManager;
+class Server;
 class Response;
+class CGIHandler;
 
 
 
@@ -46,49 +49,70 @@ class Response;
  */
 class Client {
 	private:
-		Request _request;                          ///< Parsed client request object
+		Request _request;                          ///< Parsed client request object, viewing _startLineAndHeadersBuffer
+		RequestParser _parser;                     ///< Incremental parser of the request head
 		std::string _startLineAndHeadersBuffer;    ///< Buffer storing the start line and headers of the request
-		std::string _bodyBuffer;                   ///< Buffer storing the request body
+		std::string _bodyBuffer;                   ///< Buffer storing the request body, then any pipelined bytes
 		bool _headersParsed;                       ///< Flag indicating if headers have been fully parsed
-		size_t _bodyStart;                         ///< Position in buffer where the body begins
 
-		size_t _clientBytesSent;                   ///< Number of bytes sent to the client so far
-		std::string _clientResponse;               ///< Prepared response string for the client
-		int _serverFd;                             ///< File descriptor of the client socket
+		std::shared_ptr<const Server> _listener;   ///< Listening socket that accepted the connection, with its configuration
 		ServerManager* _serverManager;             ///< Pointer to the ServerManager managing this client
 		std::unique_ptr<Response> _response;       ///< Response object being generated for this client
 		std::time_t _lastActiveTime;               ///< Last time this client was active (for timeout handling)
 		bool _closeAfterResponse;                  ///< Flag indicating whether the connection should close after sending response
+		size_t _requestsServed;                    ///< Number of responses fully sent on this connection
+		TimerNode _timer;                          ///< Deadline of the current phase (header, body, send, CGI, keep-alive)
+		bool _cgiOutputPaused;                     ///< The CGI stdout is out of the epoll set until the client caught up
+		TimerNode _cgiExitTimer;                   ///< Polls a CGI script that closed its pipes for its exit, without a pidfd
 
 		/**
-		 * @brief Check if the request headers are complete.
+		 * @brief Feed the bytes received since the last call to the head parser.
 		 * @param request Request string to evaluate.
-		 * @return True if headers are complete, false otherwise.
+		 * @return True once the head is complete or malformed, false if more bytes are needed.
 		 */
 		bool headersComplete(const std::string& request);
 
 		/**
 		 * @brief Check if the request body is complete.
 		 * @param body Request body string.
+		 * @param bodyLength Set to the length of the body inside the buffer when complete.
 		 * @return True if the body is complete, false otherwise.
 		 */
-		bool bodyComplete(const std::string& body) const;
+		bool bodyComplete(const std::string& body, size_t& bodyLength) const;
+
+		/**
+		 * @brief Parse whatever is buffered and switch to EPOLLOUT once a full request is available.
+		 * @param clientFd Client socket file descriptor.
+		 */
+		void processRequestBuffer(int clientFd);
+
+		/**
+		 * @brief Reset the per-request state in place and go back to reading the next request.
+		 * @param clientFd Client socket file descriptor.
+		 */
+		void resetForNextRequest(int clientFd);
+
+		/**
+		 * @brief Get the server block whose timeouts apply to this connection.
+		 * @return Matched server of the current response, else the listener's default server.
+		 */
+		const vServer* getTimeoutConfig(void) const;
 
 	public:
 		/**
 		 * @brief Construct a new Client object.
-		 * @param serverFd Socket file descriptor for this client connection.
+		 * @param listener Listening socket that accepted the connection.
 		 * @param servManager Pointer to the ServerManager.
 		 */
-		Client(int serverFd, ServerManager* servManager);
+		Client(std::shared_ptr<const Server> listener, ServerManager* servManager);
 
 		/**
 		 * @brief Destroy the Client object, cleaning up resources.
 		 */
 		~Client();
 
-		/// @brief Copy constructor (disabled).
-		Client(const Client&);
+		/// @brief Copy constructor is deleted: the request views this client's buffer.
+		Client(const Client&) = delete;
 
 		/// @brief Assignment operator is deleted to avoid copying Client state.
 		Client& operator=(const Client&) = delete;
@@ -114,16 +138,10 @@ class Client {
 		std::time_t getLastActiveTime(void) const;
 
 		/**
-		 * @brief Get the server socket file descriptor associated with this client.
-		 * @return File descriptor as int.
+		 * @brief Get the listening socket that accepted this client.
+		 * @return Server, possibly one a configuration reload already replaced.
 		 */
-		int getServerFd(void) const;
-
-		/**
-		 * @brief Get the number of bytes sent to the client so far.
-		 * @return Reference to bytes sent counter.
-		 */
-		size_t& getClientsBytesSent(void);
+		const Server& getListener(void) const;
 
 		/**
 		 * @brief Get a reference to the client's Request object.
@@ -137,6 +155,12 @@ class Client {
 		 */
 		Response& getResponse(void) { return (*_response); }
 
+		/**
+		 * @brief Get the CGI handler of the current response, if any.
+		 * @return Pointer to the CGI handler, or nullptr.
+		 */
+		CGIHandler* getCgiHandler(void) const;
+
 		// ----------------- Methods -----------------
 		/**
 		 * @brief Handle incoming client request.
@@ -151,18 +175,57 @@ class Client {
 		void handleResponse(int clientFd);
 
 		/**
-		 * @brief Send a prepared response body to the client.
-		 * @param responseBody Response content string.
+		 * @brief Forward what the CGI script produced since the last call.
+		 * @param clientFd Client socket file descriptor.
+		 * @note Nothing is sent before the script's header fields are complete. A script that
+		 *       finished by then gets a Content-Length response, any other one a streamed body.
+		 */
+		void handleCgiOutput(int clientFd);
+
+		/**
+		 * @brief Kill a CGI script that exceeded its timeout and answer 504 Gateway Timeout.
+		 * @param clientFd Client socket file descriptor.
+		 */
+		void handleCgiTimeout(int clientFd);
+
+		/**
+		 * @brief Check whether a CGI script that closed its pipes has exited, and go on with its output.
+		 * @param clientFd Client socket file descriptor.
+		 * @note Without a pidfd nothing reports the exit; the script is polled until it is reaped
+		 *       or its deadline (TIMER_CGI) kills it.
+		 */
+		void pollCgiExit(int clientFd);
+
+		/**
+		 * @brief Stop the CGI script and answer with an error.
+		 * @param clientFd Client socket file descriptor.
+		 * @param statusCode Status of the error response.
+		 * @note Once the head of a streamed response is out, the connection is closed instead.
+		 */
+		void abortCgi(int clientFd, int statusCode);
+
+		/**
+		 * @brief Set what the connection waits for while a CGI response is streamed.
+		 * @param clientFd Client socket file descriptor.
+		 * @note The script's stdout is paused while STREAM_BODY_HIGH_WATER bytes wait for the
+		 *       client; with nothing to send, the socket is parked under the CGI timeout.
+		 */
+		void updateCgiStream(int clientFd);
+
+		/**
+		 * @brief (Re)arm the connection deadline for the given phase.
+		 * @param type Phase the connection enters.
 		 * @param clientFd Client socket file descriptor.
+		 * @note A configured timeout of 0 disables the deadline.
 		 */
-		void sendResponse(std::string responseBody, int clientFd);
+		void armTimer(TimerType type, int clientFd);
 
 		/**
-		 * @brief Prepare a response string for the client.
+		 * @brief Send the built response segments to the client, followed by the file body if any.
 		 * @param clientFd Client socket file descriptor.
-		 * @return Prepared response as string.
+		 * @note Resumes where the last partial write stopped; the Response tracks progress per segment.
 		 */
-		std::string prepareResponse(int clientFd);
+		void sendResponse(int clientFd);
 
 		/**
 		 * @brief Get the CGI response based on a Request.
@@ -170,14 +233,6 @@ class Client {
 		 * @return CGI response string.
 		 */
 		std::string getCgiResponse(Request& request);
-
-		/**
-		 * @brief Retrieve a header value from the headers map.
-		 * @param headers Map of headers.
-		 * @param headerName Name of the header to retrieve.
-		 * @return Header value if found, empty string otherwise.
-		 */
-		static std::string getAnyHeader(std::unordered_map<std::string, std::string> headers, std::string headerName);
 };
 
 #endif
@@ -0,0 +1,39 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   DateCache.cpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/26 10:14:03 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/26 10:14:03 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "DateCache.hpp"
+#include "../parsingUtils.hpp"
+
+
+
+
+DateCache::DateCache() : _second(-1) {
+	refresh(std::time(nullptr));
+}
+
+
+
+
+void	DateCache::refresh(std::time_t now) {
+	if (now == _second) {
+		return;
+	}
+	_second = now;
+	_headers = "Date: " + parsingUtils::httpDateString(now) + "\r\nServer: " + parsingUtils::serverNameString() + "\r\n";
+}
+
+
+
+
+const std::string&	DateCache::getHeaders(void) const {
+	return (_headers);
+}
@@ -0,0 +1,55 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   DateCache.hpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/26 10:14:03 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/26 10:14:03 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef DATECACHE_HPP
+#define DATECACHE_HPP
+
+
+
+
+#include <ctime>
+#include <string>
+
+
+
+
+/**
+ * @brief Date and Server header fields of one reactor, rendered once per second.
+ * @details An HTTP-date only changes every second, so formatting it for every
+ *          response wastes a gmtime_r() and a strftime() per request. The
+ *          reactor refreshes the cache once per loop iteration, which only
+ *          re-renders when the second changed; responses copy the finished
+ *          fragment into their header block. Each reactor owns its own cache,
+ *          so worker threads never share it.
+ */
+class DateCache {
+  private:
+    std::string _headers;  ///< "Date: ...\r\nServer: ...\r\n"
+    std::time_t _second;   ///< Second _headers was rendered for
+
+  public:
+    DateCache();
+
+    /**
+     * @brief Re-render the fragment if the second changed since the last call.
+     * @param now Current wall-clock time.
+     */
+    void refresh(std::time_t now);
+
+    /**
+     * @brief Get the header fields, ready to be copied into a response head.
+     * @return Date and Server fields, each ending in CRLF.
+     */
+    const std::string& getHeaders(void) const;
+};
+
+#endif
@@ -0,0 +1,187 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   FastCgi.cpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/27 09:41:12 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/27 09:41:12 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "FastCgi.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+
+
+
+/**
+ * @brief Append a name-value pair length: one byte up to 127, four bytes with the high bit set above.
+ */
+static void	appendLength(std::string& out, size_t length) {
+	if (length < 0x80) {
+		out += static_cast<char>(length);
+		return;
+	}
+	out += static_cast<char>(((length >> 24) & 0x7F) | 0x80);
+	out += static_cast<char>((length >> 16) & 0xFF);
+	out += static_cast<char>((length >> 8) & 0xFF);
+	out += static_cast<char>(length & 0xFF);
+}
+
+/**
+ * @brief Read a name-value pair length written by appendLength().
+ * @return false if the length does not fit in what is left of the content.
+ */
+static bool	readLength(std::string_view& content, size_t& length) {
+	const unsigned char*	bytes = reinterpret_cast<const unsigned char*>(content.data());
+
+	if (content.empty()) {
+		return (false);
+	}
+	if (bytes[0] < 0x80) {
+		length = bytes[0];
+		content.remove_prefix(1);
+		return (true);
+	}
+	if (content.size() < 4) {
+		return (false);
+	}
+	length = (static_cast<size_t>(bytes[0] & 0x7F) << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+	content.remove_prefix(4);
+	return (true);
+}
+
+static void	appendHeader(std::string& out, FastCgiRecordType type, uint16_t requestId, size_t contentLength, size_t paddingLength) {
+	const char	header[FCGI_HEADER_LEN] = {
+		static_cast<char>(FCGI_VERSION_1),
+		static_cast<char>(type),
+		static_cast<char>(requestId >> 8),
+		static_cast<char>(requestId & 0xFF),
+		static_cast<char>(contentLength >> 8),
+		static_cast<char>(contentLength & 0xFF),
+		static_cast<char>(paddingLength),
+		0
+	};
+
+	out.append(header, FCGI_HEADER_LEN);
+}
+
+
+
+
+void	FastCgi::appendRecord(std::string& out, FastCgiRecordType type, uint16_t requestId, std::string_view content) {
+	do {
+		size_t	length = std::min<size_t>(content.size(), FCGI_MAX_CONTENT_LEN);
+		// Records are padded to 8 bytes, so the next header stays aligned in the application's buffer.
+		size_t	padding = (8 - (length % 8)) % 8;
+
+		appendHeader(out, type, requestId, length, padding);
+		out.append(content.data(), length);
+		out.append(padding, '\0');
+		content.remove_prefix(length);
+	} while (!content.empty());
+}
+
+
+
+
+void	FastCgi::appendBeginRequest(std::string& out, uint16_t requestId, bool keepConn) {
+	const char	body[8] = {0, static_cast<char>(FCGI_RESPONDER), static_cast<char>(keepConn ? FCGI_KEEP_CONN : 0), 0, 0, 0, 0, 0};
+
+	appendRecord(out, FCGI_BEGIN_REQUEST, requestId, std::string_view(body, sizeof(body)));
+}
+
+
+
+
+void	FastCgi::appendParams(std::string& out, uint16_t requestId, const std::unordered_map<std::string, std::string>& params) {
+	std::string	pairs;
+
+	for (const auto& param : params) {
+		appendLength(pairs, param.first.size());
+		appendLength(pairs, param.second.size());
+		pairs += param.first;
+		pairs += param.second;
+	}
+	appendStream(out, FCGI_PARAMS, requestId, pairs);
+}
+
+
+
+
+void	FastCgi::appendStream(std::string& out, FastCgiRecordType type, uint16_t requestId, std::string_view data) {
+	if (!data.empty()) {
+		appendRecord(out, type, requestId, data);
+	}
+	appendRecord(out, type, requestId, std::string_view());
+}
+
+
+
+
+void	FastCgi::appendGetValues(std::string& out, const std::vector<std::string>& names) {
+	std::string	pairs;
+
+	for (const std::string& name : names) {
+		appendLength(pairs, name.size());
+		appendLength(pairs, 0);
+		pairs += name;
+	}
+	appendRecord(out, FCGI_GET_VALUES, FCGI_NULL_REQUEST_ID, pairs);
+}
+
+
+
+
+bool	FastCgi::parsePairs(std::string_view content, std::unordered_map<std::string, std::string>& pairs) {
+	while (!content.empty()) {
+		size_t	nameLength;
+		size_t	valueLength;
+
+		if (!readLength(content, nameLength) || !readLength(content, valueLength) || content.size() < nameLength + valueLength) {
+			return (false);
+		}
+		pairs[std::string(content.substr(0, nameLength))] = std::string(content.substr(nameLength, valueLength));
+		content.remove_prefix(nameLength + valueLength);
+	}
+	return (true);
+}
+
+
+
+
+size_t	FastCgi::parseRecord(const char* data, size_t size, FastCgiRecord& record) {
+	const unsigned char*	bytes = reinterpret_cast<const unsigned char*>(data);
+
+	if (size < FCGI_HEADER_LEN) {
+		return (0);
+	}
+	if (bytes[0] != FCGI_VERSION_1) {
+		throw std::runtime_error("FastCGI: unsupported protocol version " + std::to_string(bytes[0]));
+	}
+	size_t	contentLength = (static_cast<size_t>(bytes[4]) << 8) | bytes[5];
+	size_t	total = FCGI_HEADER_LEN + contentLength + bytes[6];
+
+	if (size < total) {
+		return (0);
+	}
+	record.type = bytes[1];
+	record.requestId = static_cast<uint16_t>((bytes[2] << 8) | bytes[3]);
+	record.content = std::string_view(data + FCGI_HEADER_LEN, contentLength);
+	return (total);
+}
+
+
+
+
+int	FastCgi::endRequestStatus(const FastCgiRecord& record) {
+	const unsigned char*	bytes = reinterpret_cast<const unsigned char*>(record.content.data());
+
+	if (record.type != FCGI_END_REQUEST || record.content.size() < 8 || bytes[4] != FCGI_REQUEST_COMPLETE) {
+		return (-1);
+	}
+	return (static_cast<int>((static_cast<uint32_t>(bytes[0]) << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3]));
+}
@@ -0,0 +1,142 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   FastCgi.hpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/27 09:41:12 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/27 09:41:12 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef FASTCGI_HPP
+#define FASTCGI_HPP
+
+
+
+
+#define FCGI_VERSION_1          1
+#define FCGI_HEADER_LEN         8
+#define FCGI_MAX_CONTENT_LEN    65535   ///< Longer streams are split over several records
+#define FCGI_RESPONDER          1       ///< Role of a CGI request
+#define FCGI_KEEP_CONN          1       ///< BEGIN_REQUEST flag: the application leaves the connection open
+#define FCGI_REQUEST_COMPLETE   0       ///< END_REQUEST protocol status of a request that ran
+#define FCGI_NULL_REQUEST_ID    0       ///< Management records (GET_VALUES) belong to no request
+
+
+
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+
+
+/**
+ * @brief Record types of the FastCGI 1.0 protocol.
+ */
+enum FastCgiRecordType {
+	FCGI_BEGIN_REQUEST = 1,
+	FCGI_ABORT_REQUEST,
+	FCGI_END_REQUEST,
+	FCGI_PARAMS,
+	FCGI_STDIN,
+	FCGI_STDOUT,
+	FCGI_STDERR,
+	FCGI_DATA,
+	FCGI_GET_VALUES,
+	FCGI_GET_VALUES_RESULT,
+	FCGI_UNKNOWN_TYPE
+};
+
+/**
+ * @brief One record read from an application, pointing into the receive buffer.
+ */
+struct FastCgiRecord {
+	uint8_t				type;       ///< FastCgiRecordType
+	uint16_t			requestId;
+	std::string_view	content;    ///< Padding already stripped
+};
+
+/**
+ * @brief Encoder and decoder of FastCGI records.
+ * @details Requests are built into a single buffer, so a whole request head
+ *          (BEGIN_REQUEST, the PARAMS stream and its terminator) goes out in
+ *          one write. Decoding never copies: records are views into the
+ *          buffer the application's output was received into.
+ */
+class FastCgi {
+  public:
+	/**
+	 * @brief Append one record, split into several if content exceeds FCGI_MAX_CONTENT_LEN.
+	 * @param out Buffer to append to.
+	 * @param type Record type.
+	 * @param requestId Request the record belongs to.
+	 * @param content Record content; empty writes the stream terminator.
+	 */
+	static void appendRecord(std::string& out, FastCgiRecordType type, uint16_t requestId, std::string_view content);
+
+	/**
+	 * @brief Append a BEGIN_REQUEST record for the responder role.
+	 * @param out Buffer to append to.
+	 * @param requestId Request to begin.
+	 * @param keepConn Ask the application to keep the connection open after the request.
+	 */
+	static void appendBeginRequest(std::string& out, uint16_t requestId, bool keepConn);
+
+	/**
+	 * @brief Append the PARAMS stream, terminator included.
+	 * @param out Buffer to append to.
+	 * @param requestId Request the parameters belong to.
+	 * @param params CGI environment of the request.
+	 */
+	static void appendParams(std::string& out, uint16_t requestId, const std::unordered_map<std::string, std::string>& params);
+
+	/**
+	 * @brief Append a whole input stream (STDIN or DATA), terminator included.
+	 * @param out Buffer to append to.
+	 * @param type FCGI_STDIN or FCGI_DATA.
+	 * @param requestId Request the stream belongs to.
+	 * @param data Stream content.
+	 */
+	static void appendStream(std::string& out, FastCgiRecordType type, uint16_t requestId, std::string_view data);
+
+	/**
+	 * @brief Append a GET_VALUES management record asking for some of the application's limits.
+	 * @param out Buffer to append to.
+	 * @param names Variables to ask for, e.g. FCGI_MPXS_CONNS.
+	 */
+	static void appendGetValues(std::string& out, const std::vector<std::string>& names);
+
+	/**
+	 * @brief Decode name-value pairs (PARAMS stream, GET_VALUES_RESULT).
+	 * @param content Encoded pairs.
+	 * @param pairs Filled with the decoded pairs.
+	 * @return false if a length runs past the end of content.
+	 */
+	static bool parsePairs(std::string_view content, std::unordered_map<std::string, std::string>& pairs);
+
+	/**
+	 * @brief Decode the record at the start of a buffer.
+	 * @param data Received bytes.
+	 * @param size Number of received bytes.
+	 * @param record Filled with the record, valid as long as data is.
+	 * @return Bytes the record takes, padding included; 0 if it is not complete yet.
+	 * @throws std::runtime_error on a record of another protocol version.
+	 */
+	static size_t parseRecord(const char* data, size_t size, FastCgiRecord& record);
+
+	/**
+	 * @brief Get the application status of an END_REQUEST record.
+	 * @param record END_REQUEST record.
+	 * @return Exit status the application reported, -1 if the record is malformed.
+	 */
+	static int endRequestStatus(const FastCgiRecord& record);
+};
+
+#endif
@@ -0,0 +1,435 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   FastCgiUpstream.cpp                                :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/28 09:42:17 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/28 09:42:17 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "FastCgiUpstream.hpp"
+#include "../ServerManager.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <netdb.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/un.h>
+
+
+
+
+FastCgiConnection::FastCgiConnection(FastCgiUpstream& upstream, ServerManager& manager, int fd, bool connected, bool probe)
+	: _upstream(upstream), _manager(manager), _fd(fd), _connected(connected), _probe(probe), _answered(false), _broken(false),
+	_writing(true), _paused(false), _outputOffset(0), _nextId(1) {
+	// Registered writable: EPOLLOUT reports the end of connect(), and flushes the probe.
+	_manager.addFastCgiSlot(_fd, this);
+	if (_probe) {
+		FastCgi::appendGetValues(_output, {"FCGI_MPXS_CONNS", "FCGI_MAX_REQS"});
+	}
+}
+
+
+
+
+FastCgiConnection::~FastCgiConnection() {
+	_manager.closeFastCgiFd(_fd);
+}
+
+
+
+
+uint16_t	FastCgiConnection::begin(CGIHandler& handler, int clientFd, const std::unordered_map<std::string, std::string>& params,
+	std::string_view body) {
+	while (_requests.count(_nextId) || _nextId == FCGI_NULL_REQUEST_ID) {
+		_nextId++;
+	}
+	uint16_t	requestId = _nextId++;
+
+	_requests[requestId] = Pending{&handler, clientFd, body, true};
+	FastCgi::appendBeginRequest(_output, requestId, true);
+	FastCgi::appendParams(_output, requestId, params);
+	// A write error surfaces as EPOLLERR or EPOLLHUP on the next wait, where the request is failed.
+	if (_connected && flush()) {
+		updateInterest();
+	}
+	return (requestId);
+}
+
+
+
+
+void	FastCgiConnection::abort(uint16_t requestId) {
+	auto	it = _requests.find(requestId);
+
+	if (it == _requests.end() || _broken) {
+		return;
+	}
+	it->second.handler = nullptr;
+	// The body goes away with the client; the application learns it is cut short from the abort.
+	it->second.input = std::string_view();
+	it->second.inputOpen = false;
+	// The application's END_REQUEST has to be read before the connection is reused.
+	pause(false);
+	FastCgi::appendRecord(_output, FCGI_ABORT_REQUEST, requestId, std::string_view());
+	if (_connected && flush()) {
+		updateInterest();
+	}
+}
+
+
+
+
+std::vector<FastCgiProgress>	FastCgiConnection::handleEvent(uint32_t events) {
+	std::vector<FastCgiProgress>	progress;
+
+	if (_broken) {
+		return (progress);
+	}
+	if (!_connected && (events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+		int			error = 0;
+		socklen_t	length = sizeof(error);
+
+		if (getsockopt(_fd, SOL_SOCKET, SO_ERROR, &error, &length) == -1 || error != 0) {
+			std::cerr << "FastCGI: cannot connect to " << _upstream.getAddress() << ": " << strerror(error ? error : errno) << std::endl;
+			fail(progress);
+			return (progress);
+		}
+		_connected = true;
+	}
+	if (!_connected) {
+		return (progress);
+	}
+	// Input first: an application may answer and close before it read all of a large body.
+	if ((events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !receive(progress)) {
+		fail(progress);
+		return (progress);
+	}
+	if (!flush()) {
+		fail(progress);
+		return (progress);
+	}
+	updateInterest();
+	return (progress);
+}
+
+
+
+
+bool	FastCgiConnection::flush(void) {
+	do {
+		while (_outputOffset < _output.size()) {
+			ssize_t	sent = send(_fd, _output.data() + _outputOffset, _output.size() - _outputOffset, MSG_NOSIGNAL);
+
+			if (sent == -1) {
+				if (errno == EINTR) {
+					continue;
+				}
+				return (errno == EAGAIN || errno == EWOULDBLOCK);
+			}
+			_outputOffset += sent;
+		}
+		_output.clear();
+		_outputOffset = 0;
+	} while (frameInput());
+	return (true);
+}
+
+
+
+
+bool	FastCgiConnection::frameInput(void) {
+	bool	framed = false;
+
+	// A record per request and round: the bodies of multiplexed requests go out interleaved.
+	for (auto& entry : _requests) {
+		Pending&			request = entry.second;
+		std::string_view	slice = request.input.substr(0, FCGI_MAX_CONTENT_LEN);
+
+		if (!request.inputOpen) {
+			continue;
+		}
+		request.input.remove_prefix(slice.size());
+		request.inputOpen = !slice.empty();
+		FastCgi::appendRecord(_output, FCGI_STDIN, entry.first, slice);
+		framed = true;
+	}
+	return (framed);
+}
+
+
+
+
+void	FastCgiConnection::updateInterest(void) {
+	bool	writing = !_connected || !_output.empty();
+
+	if (writing != _writing) {
+		_writing = writing;
+		_manager.watchFastCgiFd(_fd, !_paused, _writing);
+	}
+}
+
+
+
+
+void	FastCgiConnection::pause(bool paused) {
+	if (paused != _paused && !_broken) {
+		_paused = paused;
+		_manager.watchFastCgiFd(_fd, !_paused, _writing);
+	}
+}
+
+
+
+
+bool	FastCgiConnection::receive(std::vector<FastCgiProgress>& progress) {
+	char	buffer[CHUNK_SIZE];
+	ssize_t	bytesRead = 1;
+	size_t	total = 0;
+	bool	open = true;
+
+	// A batch per event: the clients get to send in between, so a fast application cannot bury a slow one.
+	while (total < CGI_READ_BATCH && (bytesRead = recv(_fd, buffer, sizeof(buffer), 0)) > 0) {
+		_input.append(buffer, bytesRead);
+		total += bytesRead;
+	}
+	if (bytesRead == 0 || (bytesRead == -1 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+		open = false;
+	}
+	size_t	offset = 0;
+
+	try {
+		FastCgiRecord	record;
+		size_t			length;
+
+		while ((length = FastCgi::parseRecord(_input.data() + offset, _input.size() - offset, record)) > 0) {
+			offset += length;
+			route(record, progress);
+		}
+	}
+	catch (const std::runtime_error& e) {
+		std::cerr << "FastCGI " << _upstream.getAddress() << ": " << e.what() << std::endl;
+		return (false);
+	}
+	_input.erase(0, offset);
+	// An application that closes between requests is not an error, one that closes during one is.
+	if (!open && !_requests.empty()) {
+		std::cerr << "FastCGI: " << _upstream.getAddress() << " closed the connection during a request" << std::endl;
+	}
+	return (open);
+}
+
+
+
+
+void	FastCgiConnection::route(const FastCgiRecord& record, std::vector<FastCgiProgress>& progress) {
+	if (record.requestId == FCGI_NULL_REQUEST_ID) {
+		std::unordered_map<std::string, std::string>	values;
+
+		if (_probe && record.type == FCGI_GET_VALUES_RESULT && FastCgi::parsePairs(record.content, values)) {
+			_upstream.learn(values);
+			_answered = true;
+		}
+		else if (_probe && record.type == FCGI_UNKNOWN_TYPE) {
+			_upstream.learn({});
+			_answered = true;
+		}
+		return;
+	}
+	auto	it = _requests.find(record.requestId);
+
+	if (it == _requests.end()) {
+		return;
+	}
+	if (it->second.handler) {
+		it->second.handler->handleRecord(record);
+		// One entry per run of records: the client takes all the request's output at once.
+		if ((record.type == FCGI_STDOUT || record.type == FCGI_END_REQUEST)
+			&& (progress.empty() || progress.back().handler != it->second.handler)) {
+			progress.push_back(FastCgiProgress{it->second.clientFd, it->second.handler});
+		}
+	}
+	if (record.type == FCGI_END_REQUEST) {
+		_requests.erase(it);
+	}
+}
+
+
+
+
+void	FastCgiConnection::fail(std::vector<FastCgiProgress>& progress) {
+	_broken = true;
+	for (const auto& request : _requests) {
+		if (request.second.handler) {
+			request.second.handler->handleBackendError();
+			progress.push_back(FastCgiProgress{request.second.clientFd, request.second.handler});
+		}
+	}
+	_requests.clear();
+	if (_probe) {
+		_upstream.learn({});
+	}
+}
+
+
+
+
+FastCgiUpstream::FastCgiUpstream(ServerManager& manager, const std::string& address)
+	: _manager(manager), _address(address), _sockaddr(), _sockaddrLength(0), _multiplex(MULTIPLEX_UNKNOWN), _maxRequests(1) {
+}
+
+
+
+
+bool	FastCgiUpstream::resolve(void) {
+	if (_address.compare(0, 5, "unix:") == 0) {
+		struct sockaddr_un*	addr = reinterpret_cast<struct sockaddr_un*>(&_sockaddr);
+		std::string			path = _address.substr(5);
+
+		addr->sun_family = AF_UNIX;
+		std::memcpy(addr->sun_path, path.c_str(), path.size() + 1);
+		_sockaddrLength = sizeof(struct sockaddr_un);
+		return (true);
+	}
+	size_t				colon = _address.find_last_of(':');
+	std::string			host = _address.substr(0, colon);
+	std::string			port = _address.substr(colon + 1);
+	struct addrinfo		hints = {};
+	struct addrinfo*	result = nullptr;
+
+	if (host.size() > 2 && host.front() == '[' && host.back() == ']') {
+		host = host.substr(1, host.size() - 2);
+	}
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_NUMERICSERV;
+	int	status = getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+
+	if (status != 0) {
+		std::cerr << "FastCGI: cannot resolve " << _address << ": " << gai_strerror(status) << std::endl;
+		return (false);
+	}
+	std::memcpy(&_sockaddr, result->ai_addr, result->ai_addrlen);
+	_sockaddrLength = result->ai_addrlen;
+	freeaddrinfo(result);
+	return (true);
+}
+
+
+
+
+FastCgiConnection*	FastCgiUpstream::open(bool probe) {
+	if (_sockaddrLength == 0 && !resolve()) {
+		return (nullptr);
+	}
+	int	fd = socket(_sockaddr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+	if (fd == -1) {
+		std::cerr << "FastCGI: socket: " << strerror(errno) << std::endl;
+		return (nullptr);
+	}
+	if (_sockaddr.ss_family != AF_UNIX) {
+		int	on = 1;
+
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+	}
+	// A unix socket connects at once or fails with EAGAIN when the application's backlog is full.
+	bool	connected = (connect(fd, reinterpret_cast<struct sockaddr*>(&_sockaddr), _sockaddrLength) == 0);
+
+	if (!connected && errno != EINPROGRESS) {
+		std::cerr << "FastCGI: cannot connect to " << _address << ": " << strerror(errno) << std::endl;
+		close(fd);
+		return (nullptr);
+	}
+	_connections.push_back(std::make_unique<FastCgiConnection>(*this, _manager, fd, connected, probe));
+	return (_connections.back().get());
+}
+
+
+
+
+FastCgiConnection*	FastCgiUpstream::dispatch(void) {
+	if (_multiplex == MULTIPLEX_UNKNOWN && open(true)) {
+		_multiplex = MULTIPLEX_PROBING;
+	}
+	size_t	limit = (_multiplex == MULTIPLEX_YES ? _maxRequests : 1);
+
+	for (const std::unique_ptr<FastCgiConnection>& connection : _connections) {
+		if (!connection->isProbe() && !connection->isSpent() && !connection->isPaused() && connection->getLoad() < limit) {
+			return (connection.get());
+		}
+	}
+	return (open(false));
+}
+
+
+
+
+void	FastCgiUpstream::learn(const std::unordered_map<std::string, std::string>& values) {
+	auto	mpxs = values.find("FCGI_MPXS_CONNS");
+	auto	maxRequests = values.find("FCGI_MAX_REQS");
+
+	if (_multiplex != MULTIPLEX_PROBING) {
+		return;
+	}
+	_multiplex = MULTIPLEX_NO;
+	if (mpxs == values.end() || mpxs->second != "1") {
+		return;
+	}
+	_multiplex = MULTIPLEX_YES;
+	_maxRequests = FASTCGI_DEFAULT_MULTIPLEX;
+	if (maxRequests != values.end() && !maxRequests->second.empty()
+		&& maxRequests->second.find_first_not_of("0123456789") == std::string::npos && maxRequests->second.size() < 10) {
+		_maxRequests = std::min<size_t>(std::max<size_t>(std::stoul(maxRequests->second), 1), FASTCGI_MAX_MULTIPLEX);
+	}
+}
+
+
+
+
+void	FastCgiUpstream::settle(FastCgiConnection& connection) {
+	size_t	idle = 0;
+
+	for (const std::unique_ptr<FastCgiConnection>& other : _connections) {
+		idle += (!other->isProbe() && !other->isSpent() && other->getLoad() == 0);
+	}
+	if (!connection.isSpent() && (connection.isProbe() || connection.getLoad() > 0 || idle <= FASTCGI_KEEPALIVE_CONNECTIONS)) {
+		return;
+	}
+	for (size_t i = 0; i < _connections.size(); i++) {
+		if (_connections[i].get() == &connection) {
+			_connections.erase(_connections.begin() + i);
+			break;
+		}
+	}
+	// Nothing left open: the application may have been restarted with other limits, ask again next time.
+	if (_connections.empty() && _multiplex != MULTIPLEX_PROBING) {
+		_multiplex = MULTIPLEX_UNKNOWN;
+		_maxRequests = 1;
+	}
+}
+
+
+
+
+FastCgiUpstreamSet::FastCgiUpstreamSet(ServerManager& manager) : _manager(manager) {
+}
+
+
+
+
+FastCgiUpstream&	FastCgiUpstreamSet::get(const std::string& address) {
+	std::unique_ptr<FastCgiUpstream>&	upstream = _upstreams[address];
+
+	if (!upstream) {
+		upstream = std::make_unique<FastCgiUpstream>(_manager, address);
+	}
+	return (*upstream);
+}
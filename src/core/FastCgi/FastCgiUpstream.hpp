@@ -0,0 +1,277 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   FastCgiUpstream.hpp                                :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/28 09:42:17 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/28 09:42:17 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef FASTCGIUPSTREAM_HPP
+#define FASTCGIUPSTREAM_HPP
+
+
+
+
+#define FASTCGI_KEEPALIVE_CONNECTIONS  8    // idle connections kept open per application and reactor
+#define FASTCGI_DEFAULT_MULTIPLEX      16   // requests per connection when the application multiplexes but sets no FCGI_MAX_REQS
+#define FASTCGI_MAX_MULTIPLEX          128
+
+
+
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <sys/socket.h>
+#include "FastCgi.hpp"
+
+
+
+
+class CGIHandler;
+class ServerManager;
+class FastCgiUpstream;
+
+/**
+ * @brief A request a FastCGI connection got output for or finished, so its client can be served.
+ */
+struct FastCgiProgress {
+	int					clientFd;
+	const CGIHandler*	handler;   ///< Checked against the client's handler before it is answered
+};
+
+/**
+ * @brief One non-blocking connection to a FastCGI application, registered in the reactor's epoll set.
+ * @details BEGIN_REQUEST and PARAMS are written into an output buffer that
+ *          is flushed as the socket accepts it. Bodies are framed into it one
+ *          FCGI_STDIN record per request at a time, each time it drained, so
+ *          a large upload is never copied whole and the requests queued after
+ *          it are not held back until it is sent. Records read back
+ *          are routed by request id to the CGIHandler waiting for them. Every
+ *          request asks the application to keep the connection open, so it
+ *          goes back to its upstream once the last END_REQUEST arrived.
+ *          A connection either carries one request at a time or, when the
+ *          application announced FCGI_MPXS_CONNS, several interleaved ones.
+ */
+class FastCgiConnection {
+  private:
+	struct Pending {
+		CGIHandler*			handler;    ///< nullptr once aborted: its records are dropped until END_REQUEST
+		int					clientFd;
+		std::string_view	input;      ///< Body not framed as FCGI_STDIN yet, a view of the client's Request
+		bool				inputOpen;  ///< The empty FCGI_STDIN ending the body is still to be framed
+	};
+
+	FastCgiUpstream&				_upstream;
+	ServerManager&					_manager;
+	int								_fd;
+	bool							_connected;   ///< connect() progress
+	bool							_probe;       ///< Only asks the application for its limits
+	bool							_answered;    ///< The probe got its answer
+	bool							_broken;
+	bool							_writing;     ///< EPOLLOUT is part of the registered events
+	bool							_paused;      ///< EPOLLIN is left out until the client caught up
+	std::string						_output;
+	size_t							_outputOffset;
+	std::string						_input;       ///< Received bytes not decoded yet
+	std::map<uint16_t, Pending>		_requests;
+	uint16_t						_nextId;
+
+	/**
+	 * @brief Write as much of the output buffer as the socket takes, framing more input as it drains.
+	 * @return false on a write error.
+	 */
+	bool flush(void);
+
+	/**
+	 * @brief Frame the next FCGI_STDIN record of every request that has body left.
+	 * @return false if no request had any input left to frame.
+	 */
+	bool frameInput(void);
+
+	/**
+	 * @brief Watch for EPOLLOUT exactly while output is pending (or connect() is).
+	 */
+	void updateInterest(void);
+
+	/**
+	 * @brief Read up to CGI_READ_BATCH bytes and route the complete records.
+	 * @param progress Requests that got output or ended are appended to it.
+	 * @return false if the application closed the connection or sent garbage.
+	 */
+	bool receive(std::vector<FastCgiProgress>& progress);
+
+	/**
+	 * @brief Handle one record read from the application.
+	 * @param record Decoded record.
+	 * @param progress Appended to when the record carries output or ends a request.
+	 */
+	void route(const FastCgiRecord& record, std::vector<FastCgiProgress>& progress);
+
+	/**
+	 * @brief Mark the connection broken and fail every request still on it.
+	 * @param progress The failed requests are appended to it.
+	 */
+	void fail(std::vector<FastCgiProgress>& progress);
+
+  public:
+	/**
+	 * @brief Take over a socket whose connect() was started.
+	 * @param upstream Application the socket connects to.
+	 * @param manager Reactor whose epoll set the socket is added to.
+	 * @param fd Non-blocking socket.
+	 * @param connected connect() already succeeded.
+	 * @param probe Send FCGI_GET_VALUES instead of requests.
+	 */
+	FastCgiConnection(FastCgiUpstream& upstream, ServerManager& manager, int fd, bool connected, bool probe);
+	FastCgiConnection(const FastCgiConnection&) = delete;
+	FastCgiConnection& operator=(const FastCgiConnection&) = delete;
+
+	/**
+	 * @brief Remove the socket from epoll and close it.
+	 */
+	~FastCgiConnection();
+
+	/**
+	 * @brief Queue a request: BEGIN_REQUEST and PARAMS, then STDIN as the socket drains.
+	 * @param handler Handler the records are routed to.
+	 * @param clientFd Client waiting for the response.
+	 * @param params CGI environment of the request.
+	 * @param body Request body, sent as STDIN; must stay valid until the request ends or is aborted.
+	 * @return Request id on this connection.
+	 */
+	uint16_t begin(CGIHandler& handler, int clientFd, const std::unordered_map<std::string, std::string>& params, std::string_view body);
+
+	/**
+	 * @brief Give up a request whose client no longer waits (timeout, client gone).
+	 * @param requestId Id returned by begin().
+	 * @note ABORT_REQUEST is sent; the connection is reused once the application ended the request.
+	 */
+	void abort(uint16_t requestId);
+
+	/**
+	 * @brief Stop or resume reading the connection while its only request's client is behind.
+	 * @param paused true to leave EPOLLIN out of the registered events.
+	 * @note The application then blocks on a full socket; queued output keeps being written.
+	 */
+	void pause(bool paused);
+
+	/**
+	 * @brief Handle readiness reported by epoll.
+	 * @param events Epoll events.
+	 * @return Requests that got output, ended or failed.
+	 */
+	std::vector<FastCgiProgress> handleEvent(uint32_t events);
+
+	FastCgiUpstream& getUpstream(void) const { return (_upstream); }
+	int getFd(void) const { return (_fd); }
+	/// @brief Tell whether the connection is of no further use: broken, or a probe that got its answer.
+	bool isSpent(void) const { return (_broken || _answered); }
+	bool isProbe(void) const { return (_probe); }
+	bool isPaused(void) const { return (_paused); }
+	size_t getLoad(void) const { return (_requests.size()); }
+};
+
+/**
+ * @brief The connections of one reactor to one FastCGI application (fastcgi_pass address).
+ * @details Replaces a process per request with a request on a kept-alive
+ *          connection to an application started on its own, such as
+ *          php-fpm. The first request also opens a probe connection asking
+ *          for FCGI_MPXS_CONNS and FCGI_MAX_REQS; until an answer arrives,
+ *          and for applications that do not multiplex, every connection
+ *          carries one request at a time and more are opened as needed.
+ *          Up to FASTCGI_KEEPALIVE_CONNECTIONS idle ones are kept. A paused
+ *          connection takes no further request, its reads wait for one client.
+ */
+class FastCgiUpstream {
+  private:
+	enum MultiplexState {
+		MULTIPLEX_UNKNOWN,
+		MULTIPLEX_PROBING,
+		MULTIPLEX_NO,
+		MULTIPLEX_YES
+	};
+
+	ServerManager&									_manager;
+	std::string										_address;         ///< As written in fastcgi_pass
+	struct sockaddr_storage							_sockaddr;
+	socklen_t										_sockaddrLength;  ///< 0 until the address resolved
+	MultiplexState									_multiplex;
+	size_t											_maxRequests;     ///< Per connection
+	std::vector<std::unique_ptr<FastCgiConnection>>	_connections;
+
+	/**
+	 * @brief Turn the fastcgi_pass address into a socket address.
+	 * @return false if the host does not resolve.
+	 */
+	bool resolve(void);
+
+	/**
+	 * @brief Start a non-blocking connect() and register the socket.
+	 * @param probe Open the probe connection.
+	 * @return New connection, nullptr if the application cannot be reached.
+	 */
+	FastCgiConnection* open(bool probe);
+
+  public:
+	/**
+	 * @brief Create the upstream of an address; nothing is connected until the first request.
+	 * @param manager Reactor the connections belong to.
+	 * @param address "unix:<path>" or "<host>:<port>".
+	 */
+	FastCgiUpstream(ServerManager& manager, const std::string& address);
+	FastCgiUpstream(const FastCgiUpstream&) = delete;
+	FastCgiUpstream& operator=(const FastCgiUpstream&) = delete;
+
+	/**
+	 * @brief Get a connection that can take one more request, opening one if needed.
+	 * @return Connection, nullptr if the application is unreachable.
+	 */
+	FastCgiConnection* dispatch(void);
+
+	/**
+	 * @brief Record the limits the application answered the probe with.
+	 * @param values FCGI_GET_VALUES_RESULT pairs, empty if it did not understand the question.
+	 */
+	void learn(const std::unordered_map<std::string, std::string>& values);
+
+	/**
+	 * @brief Close a connection after an event if it is spent or one idle connection too many.
+	 * @param connection Connection that just handled an event; may be destroyed.
+	 */
+	void settle(FastCgiConnection& connection);
+
+	const std::string& getAddress(void) const { return (_address); }
+};
+
+/**
+ * @brief The FastCGI upstreams of one reactor, one per fastcgi_pass address.
+ */
+class FastCgiUpstreamSet {
+  private:
+	ServerManager&												_manager;
+	std::unordered_map<std::string, std::unique_ptr<FastCgiUpstream>>	_upstreams;
+
+  public:
+	FastCgiUpstreamSet(ServerManager& manager);
+	FastCgiUpstreamSet(const FastCgiUpstreamSet&) = delete;
+	FastCgiUpstreamSet& operator=(const FastCgiUpstreamSet&) = delete;
+
+	/**
+	 * @brief Get the upstream of an address, creating it on first use.
+	 * @param address fastcgi_pass address.
+	 * @return Upstream, living as long as the reactor.
+	 */
+	FastCgiUpstream& get(const std::string& address);
+};
+
+#endif
@@ -0,0 +1,387 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   FileCache.cpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/25 11:02:37 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/25 11:02:37 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "FileCache.hpp"
+#include "../parsingUtils.hpp"
+#include "../Response/Compressor.hpp"
+#include <cerrno>
+#include <iterator>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+
+
+
+
+/// Everything that can make a cached file or a directory index stale.
+#define FILE_CACHE_WATCH_MASK (IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE | IN_DELETE \
+	| IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+
+
+
+
+/**
+ * @brief Header lines of a 200 response carrying a cached file.
+ */
+static std::string	headerBlock(const CachedFile& file) {
+	return ("Content-Length: " + std::to_string(file.content.size()) + "\r\n"
+		"Content-Type: " + file.contentType + "\r\n"
+		"ETag: " + file.etag + "\r\n"
+		"Last-Modified: " + file.lastModified + "\r\n"
+		"Accept-Ranges: bytes\r\n");
+}
+
+/**
+ * @brief Directory part of a path, without trailing slashes.
+ * @return "." for a bare file name, "/" for the file system root.
+ */
+static std::string	parentOf(const std::string& path) {
+	size_t	slash = path.find_last_of('/');
+
+	if (slash == std::string::npos) {
+		return (".");
+	}
+	while (slash > 0 && path[slash - 1] == '/') {
+		slash--;
+	}
+	return (slash == 0 ? "/" : path.substr(0, slash));
+}
+
+/**
+ * @brief Directory path without trailing slashes, comparable with parentOf().
+ */
+static std::string	normalizeDirectory(const std::string& dir) {
+	size_t	end = dir.find_last_not_of('/');
+
+	if (dir.empty()) {
+		return (".");
+	}
+	return (end == std::string::npos ? "/" : dir.substr(0, end + 1));
+}
+
+
+
+
+FileCache::FileCache() : _inotifyFd(-1), _capacity(0), _maxFileSize(0), _stats() {
+}
+
+
+
+
+FileCache::~FileCache() {
+	if (_inotifyFd != -1) {
+		close(_inotifyFd);
+	}
+}
+
+
+
+
+bool	FileCache::enable(size_t capacity, size_t maxFileSize) {
+	_capacity = capacity;
+	_maxFileSize = maxFileSize;
+	if (_capacity == 0) {
+		return (true);
+	}
+	_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (_inotifyFd == -1) {
+		_capacity = 0;
+		return (false);
+	}
+	return (true);
+}
+
+
+
+
+int	FileCache::getInotifyFd(void) const {
+	return (_inotifyFd);
+}
+
+
+
+
+const FileCacheStats&	FileCache::getStats(void) const {
+	return (_stats);
+}
+
+
+
+
+std::shared_ptr<const CachedFile>	FileCache::lookup(const std::string& key) {
+	if (!isEnabled()) {
+		return (nullptr);
+	}
+	auto	it = _index.find(key);
+
+	if (it == _index.end()) {
+		_stats.misses++;
+		return (nullptr);
+	}
+	_stats.hits++;
+	_lru.splice(_lru.begin(), _lru, it->second);
+	return (it->second->file);
+}
+
+
+
+
+std::shared_ptr<const CachedFile>	FileCache::insert(const std::string& key, const std::string& path, const std::string& root,
+	const std::string& contentType, const std::string& contentEncoding) {
+	if (!isEnabled()) {
+		return (nullptr);
+	}
+	std::shared_ptr<CachedFile>	file = std::make_shared<CachedFile>();
+	struct stat					fileStat;
+
+	// Large files are streamed from disk anyway, do not spend watches on their directories.
+	if (stat(path.c_str(), &fileStat) == -1 || !S_ISREG(fileStat.st_mode) || static_cast<size_t>(fileStat.st_size) > _maxFileSize) {
+		return (nullptr);
+	}
+	// Watch first: a change landing between the read and the watch would otherwise go unnoticed.
+	file->watch = watchPath(path, root);
+	if (file->watch == -1 || !readFile(path, file->content, fileStat)) {
+		return (nullptr);
+	}
+	file->etag = parsingUtils::entityTag(fileStat);
+	// A weak tag means the file is still changing; it is cached once it settled.
+	if (file->etag.compare(0, 2, "W/") == 0) {
+		return (nullptr);
+	}
+	file->path = path;
+	file->name = path.substr(path.find_last_of('/') + 1);
+	file->alias = (key != path);
+	file->mtime = fileStat.st_mtime;
+	file->lastModified = parsingUtils::httpDateString(file->mtime);
+	file->contentType = contentType;
+	file->contentEncoding = contentEncoding;
+	file->headers = headerBlock(*file);
+	return (store(key, file) ? file : nullptr);
+}
+
+
+
+
+std::shared_ptr<const CachedFile>	FileCache::insertVariant(const std::string& key, const CachedFile& source, const std::string& encoding, int level) {
+	if (!isEnabled()) {
+		return (nullptr);
+	}
+	std::shared_ptr<CachedFile>	file = std::make_shared<CachedFile>(source);
+
+	if (!Compressor::compress(encoding, level, source.content, file->content)) {
+		return (nullptr);
+	}
+	file->content.shrink_to_fit();
+	file->contentEncoding = encoding;
+	// Other bytes, other tag: a 304 or If-Range must not mix up the codings.
+	file->etag.insert(file->etag.size() - 1, "-" + encoding);
+	file->headers = headerBlock(*file);
+	return (store(key, file) ? file : nullptr);
+}
+
+
+
+
+bool	FileCache::store(const std::string& key, std::shared_ptr<const CachedFile> file) {
+	size_t	cost = key.size() + file->path.size() + file->name.size() + file->headers.size()
+		+ file->etag.size() + file->lastModified.size() + file->contentType.size() + file->contentEncoding.size() + file->content.size()
+		+ FILE_CACHE_ENTRY_OVERHEAD;
+
+	if (cost > _capacity) {
+		return (false);
+	}
+	auto	existing = _index.find(key);
+
+	if (existing != _index.end()) {
+		erase(existing->second);
+	}
+	while (_stats.bytes + cost > _capacity) {
+		erase(std::prev(_lru.end()));
+		_stats.evictions++;
+	}
+	_lru.push_front(Entry{key, std::move(file), cost});
+	_index[key] = _lru.begin();
+	_byWatch.emplace(_lru.front().file->watch, _lru.begin());
+	_stats.entries++;
+	_stats.bytes += cost;
+	return (true);
+}
+
+
+
+
+void	FileCache::handleEvents(void) {
+	alignas(struct inotify_event) char	buffer[FILE_CACHE_EVENT_BUFFER_SIZE];
+
+	while (true) {
+		ssize_t	length = read(_inotifyFd, buffer, sizeof(buffer));
+
+		if (length <= 0) {
+			// EAGAIN once drained; any other error leaves entries of unknown freshness.
+			if (length == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+				invalidateAll();
+			}
+			if (length == -1 && errno == EINTR) {
+				continue;
+			}
+			return;
+		}
+		for (ssize_t offset = 0; offset < length;) {
+			const struct inotify_event*	event = reinterpret_cast<const struct inotify_event*>(buffer + offset);
+
+			invalidate(event->wd, event->len ? std::string(event->name) : std::string(), event->mask);
+			offset += sizeof(struct inotify_event) + event->len;
+		}
+	}
+}
+
+
+
+
+int	FileCache::watchDirectory(const std::string& dir) {
+	auto	it = _watches.find(dir);
+
+	if (it != _watches.end()) {
+		return (it->second);
+	}
+	int	watch = inotify_add_watch(_inotifyFd, dir.c_str(), FILE_CACHE_WATCH_MASK);
+
+	if (watch != -1) {
+		_watches[dir] = watch;
+	}
+	return (watch);
+}
+
+
+
+
+int	FileCache::watchPath(const std::string& path, const std::string& root) {
+	const std::string	top = normalizeDirectory(root);
+	std::string			dir = parentOf(path);
+	int					fileWatch = -1;
+
+	while (true) {
+		int	watch = watchDirectory(dir);
+
+		if (watch == -1) {
+			return (-1);
+		}
+		if (fileWatch == -1) {
+			fileWatch = watch;
+		}
+		// A renamed directory only shows up in the events of its parent.
+		if (dir == top || dir.size() <= top.size() || dir == "/" || dir == ".") {
+			return (fileWatch);
+		}
+		dir = parentOf(dir);
+	}
+}
+
+
+
+
+bool	FileCache::readFile(const std::string& path, std::string& content, struct stat& fileStat) const {
+	int			fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	bool		complete = false;
+
+	if (fd == -1) {
+		return (false);
+	}
+	if (fstat(fd, &fileStat) == 0 && S_ISREG(fileStat.st_mode) && static_cast<size_t>(fileStat.st_size) <= _maxFileSize) {
+		size_t	size = static_cast<size_t>(fileStat.st_size);
+		size_t	done = 0;
+		ssize_t	bytesRead = 1;
+		char	extra;
+
+		content.resize(size);
+		while (done < size && bytesRead > 0) {
+			bytesRead = pread(fd, &content[done], size - done, done);
+			done += bytesRead > 0 ? bytesRead : 0;
+		}
+		// A file still growing is left to the next request; its watch will fire anyway.
+		complete = (done == size && pread(fd, &extra, 1, size) == 0);
+	}
+	close(fd);
+	return (complete);
+}
+
+
+
+
+void	FileCache::erase(std::list<Entry>::iterator it) {
+	auto	range = _byWatch.equal_range(it->file->watch);
+
+	for (auto watched = range.first; watched != range.second; ++watched) {
+		if (watched->second == it) {
+			_byWatch.erase(watched);
+			break;
+		}
+	}
+	_stats.entries--;
+	_stats.bytes -= it->cost;
+	_index.erase(it->key);
+	_lru.erase(it);
+}
+
+
+
+
+void	FileCache::invalidateAll(void) {
+	_stats.invalidations += _stats.entries;
+	_index.clear();
+	_byWatch.clear();
+	_lru.clear();
+	_stats.entries = 0;
+	_stats.bytes = 0;
+	// Paths may now name other directories: start over. Watch numbers are not reused,
+	// so the IN_IGNORED events this queues are recognised as stale and skipped.
+	for (const auto& watch : _watches) {
+		inotify_rm_watch(_inotifyFd, watch.second);
+	}
+	_watches.clear();
+}
+
+
+
+
+void	FileCache::invalidate(int watch, const std::string& name, uint32_t mask) {
+	if (mask & IN_Q_OVERFLOW) {
+		return (invalidateAll());
+	}
+	if (mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+		for (const auto& known : _watches) {
+			if (known.second == watch) {
+				return (invalidateAll());
+			}
+		}
+		return;
+	}
+	if (mask & IN_ISDIR) {
+		if (mask & (IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE | IN_ATTRIB)) {
+			invalidateAll();
+		}
+		return;
+	}
+	// Only the entries of that directory: a file being written elsewhere costs nothing per event.
+	auto	range = _byWatch.equal_range(watch);
+
+	for (auto watched = range.first; watched != range.second;) {
+		std::list<Entry>::iterator	it = (watched++)->second;
+
+		// Any change in its directory may change which index file or sibling a key maps to.
+		if (it->file->alias || it->file->name == name) {
+			erase(it);
+			_stats.invalidations++;
+		}
+	}
+}
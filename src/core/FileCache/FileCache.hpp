@@ -0,0 +1,214 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   FileCache.hpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/25 11:02:37 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/25 11:02:37 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef FILECACHE_HPP
+#define FILECACHE_HPP
+
+
+
+
+#define FILE_CACHE_DEFAULT_SIZE       (16 * 1024 * 1024)  ///< Bytes one reactor may keep in memory
+#define FILE_CACHE_DEFAULT_MAX_FILE   (1024 * 1024)       ///< Larger files are always streamed from disk
+#define FILE_CACHE_ENTRY_OVERHEAD     128                 ///< Bookkeeping charged per entry on top of its strings
+#define FILE_CACHE_EVENT_BUFFER_SIZE  4096
+
+
+
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <sys/stat.h>
+
+
+
+
+/**
+ * @brief Static file held in memory, with the header fields that describe it.
+ * @details Immutable once cached; a Response serving it keeps a reference, so
+ *          an entry evicted or invalidated mid-send stays alive until the last
+ *          byte is out.
+ */
+struct CachedFile {
+    std::string path;          ///< Resolved file the bytes were read from
+    std::string headers;       ///< Header lines of a 200 response (length, type, validators), appended as is
+    std::string content;       ///< Whole file
+    std::string contentType;   ///< Also needed to build partial responses
+    std::string contentEncoding; ///< Coding of a precompressed sibling, empty for the file itself
+    std::string etag;          ///< Strong entity tag of content
+    std::string lastModified;  ///< HTTP-date of mtime
+    time_t      mtime;         ///< Compared with If-Modified-Since
+    int         watch;         ///< inotify watch of the directory holding the file
+    std::string name;          ///< File name inside that directory
+    bool        alias;         ///< Key does not name path: a directory index or a precompressed sibling
+};
+
+/**
+ * @brief Counters of one reactor's cache.
+ */
+struct FileCacheStats {
+    uint64_t    hits;           ///< Requests answered from memory
+    uint64_t    misses;         ///< Lookups that had to go to the file system
+    uint64_t    evictions;      ///< Entries dropped to stay within the memory budget
+    uint64_t    invalidations;  ///< Entries dropped because the file or a directory changed
+    size_t      entries;
+    size_t      bytes;          ///< Memory charged against the budget
+};
+
+/**
+ * @brief Memory-bounded LRU cache of small static files.
+ * @details Keyed by the path a request maps to before index resolution, so a
+ *          hit answers without a single stat(). Every cached file's directory,
+ *          and each directory above it up to the location root, is watched
+ *          with inotify: a write, rename, delete or attribute change of the
+ *          file drops its entry, a structural change to a directory drops
+ *          them all. The inotify descriptor lives in the reactor's epoll set,
+ *          so stale entries are gone before the next request is read. Files
+ *          whose directory cannot be watched are never cached.
+ */
+class FileCache {
+  private:
+    struct Entry {
+        std::string                         key;
+        std::shared_ptr<const CachedFile>   file;
+        size_t                              cost;
+    };
+
+    std::list<Entry>                                            _lru;         ///< Most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> _index;
+    std::unordered_multimap<int, std::list<Entry>::iterator>    _byWatch;     ///< Watch of the file's directory -> its entries
+    std::unordered_map<std::string, int>                        _watches;     ///< Directory -> inotify watch
+    int                                                         _inotifyFd;
+    size_t                                                      _capacity;    ///< 0 when the cache is off
+    size_t                                                      _maxFileSize;
+    FileCacheStats                                              _stats;
+
+    /**
+     * @brief Watch a directory, reusing the watch if it already has one.
+     * @param dir Directory path.
+     * @return Watch descriptor, -1 on failure.
+     */
+    int watchDirectory(const std::string& dir);
+
+    /**
+     * @brief Watch the directory of a file and every directory above it up to root.
+     * @param path File path.
+     * @param root Location root the path was built from.
+     * @return Watch of the file's own directory, -1 if any watch failed.
+     */
+    int watchPath(const std::string& path, const std::string& root);
+
+    /**
+     * @brief Read a regular file into memory.
+     * @param path File path.
+     * @param content Filled with the file.
+     * @param fileStat Filled with fstat() of the file that was read.
+     * @return false if the file is missing, not regular, too large or changed while read.
+     */
+    bool readFile(const std::string& path, std::string& content, struct stat& fileStat) const;
+
+    /**
+     * @brief Charge a new entry against the budget, evicting the least recently used ones.
+     * @param key Key of the entry.
+     * @param file Entry to add.
+     * @return false if the entry alone exceeds the budget.
+     */
+    bool store(const std::string& key, std::shared_ptr<const CachedFile> file);
+
+    /**
+     * @brief Drop an entry and release its memory.
+     * @param it Entry to drop.
+     */
+    void erase(std::list<Entry>::iterator it);
+
+    /**
+     * @brief Drop every entry, e.g. when a directory moved or events were lost.
+     */
+    void invalidateAll(void);
+
+    /**
+     * @brief Drop the entries one inotify event may have made stale.
+     * @param watch Directory the event happened in.
+     * @param name File the event is about, empty for the directory itself.
+     * @param mask inotify event mask.
+     */
+    void invalidate(int watch, const std::string& name, uint32_t mask);
+
+  public:
+    FileCache();
+    FileCache(const FileCache&) = delete;
+    FileCache& operator=(const FileCache&) = delete;
+    ~FileCache();
+
+    /**
+     * @brief Create the inotify instance and set the limits.
+     * @param capacity Memory budget in bytes, 0 disables the cache.
+     * @param maxFileSize Largest file that is cached.
+     * @return false, with the cache disabled, if inotify is unavailable.
+     */
+    bool enable(size_t capacity, size_t maxFileSize);
+
+    bool isEnabled(void) const { return (_inotifyFd != -1); }
+
+    /**
+     * @brief Get the inotify descriptor to register in epoll.
+     * @return inotify fd, -1 when the cache is off.
+     */
+    int getInotifyFd(void) const;
+
+    /**
+     * @brief Find a file and mark it most recently used.
+     * @param key Path the request maps to.
+     * @return Cached file, nullptr on a miss.
+     */
+    std::shared_ptr<const CachedFile> lookup(const std::string& key);
+
+    /**
+     * @brief Read a file and cache it under key, evicting the least recently used entries.
+     * @param key Path the request maps to, plus the codings it accepts when it may get a precompressed file.
+     * @param path Resolved file (differs from key for a directory index or a precompressed sibling).
+     * @param root Location root, the highest directory watched.
+     * @param contentType Content-Type of the file.
+     * @param contentEncoding Content-Encoding of a precompressed file, empty otherwise.
+     * @return Cached file, nullptr if it cannot or should not be cached.
+     */
+    std::shared_ptr<const CachedFile> insert(const std::string& key, const std::string& path, const std::string& root,
+        const std::string& contentType, const std::string& contentEncoding);
+
+    /**
+     * @brief Compress a cached file and cache the result under key.
+     * @param key Key of the source entry plus the coding, so every coding is compressed once.
+     * @param source Cached file to compress.
+     * @param encoding Content coding to produce ("gzip" or "deflate").
+     * @param level zlib level.
+     * @return Compressed file, nullptr if it cannot be compressed or does not fit.
+     * @note The variant shares the watch of its source, so the events that drop one drop both.
+     */
+    std::shared_ptr<const CachedFile> insertVariant(const std::string& key, const CachedFile& source, const std::string& encoding, int level);
+
+    /**
+     * @brief Read every pending inotify event and drop the stale entries.
+     */
+    void handleEvents(void);
+
+    /**
+     * @brief Get the counters, with entries and bytes up to date.
+     * @return Counters of this cache.
+     */
+    const FileCacheStats& getStats(void) const;
+};
+
+#endif
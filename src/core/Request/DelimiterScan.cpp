@@ -0,0 +1,245 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   DelimiterScan.cpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/24 09:18:52 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/24 09:18:52 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "DelimiterScan.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+# define DELIMITER_SCAN_X86 1
+# include <immintrin.h>
+#endif
+
+
+
+
+/**
+ * @brief Membership bitmap of one ScanClass.
+ * @details Byte c < 0x80 belongs to the class when bit (c >> 4) of rows[c & 0xF]
+ *          is set. Bytes >= 0x80 are all in or all out, depending on allowHigh.
+ */
+struct ScanTable {
+	alignas(16) uint8_t	rows[16];
+	bool				allowHigh;
+};
+
+template <typename Predicate>
+static constexpr ScanTable	makeTable(Predicate isMember, bool allowHigh) {
+	ScanTable	table = {{}, allowHigh};
+
+	for (int c = 0; c < 0x80; c++) {
+		if (isMember(c)) {
+			table.rows[c & 0x0F] |= static_cast<uint8_t>(1 << (c >> 4));
+		}
+	}
+	return (table);
+}
+
+static constexpr bool	isVisible(int c) {
+	return (c > 0x20 && c < 0x7F);
+}
+
+static constexpr bool	isTchar(int c) {
+	const char*	separators = "\"(),/:;<=>?@[\\]{}";
+
+	for (size_t i = 0; separators[i]; i++) {
+		if (separators[i] == c) {
+			return (false);
+		}
+	}
+	return (isVisible(c));
+}
+
+static constexpr ScanTable	SCAN_TABLES[SCAN_CLASS_COUNT] = {
+	makeTable([](int c) { return (isTchar(c)); }, false),
+	makeTable([](int c) { return (isVisible(c)); }, false),
+	makeTable([](int c) { return (isVisible(c) && c != '?'); }, true),
+	makeTable([](int c) { return (isVisible(c) || c == ' ' || c == '\t'); }, true)
+};
+
+
+
+
+static const char*	findScalar(const ScanTable& table, const char* p, const char* end) {
+	while (p < end) {
+		unsigned char	c = static_cast<unsigned char>(*p);
+
+		if (c >= 0x80 ? !table.allowHigh : !((table.rows[c & 0x0F] >> (c >> 4)) & 1)) {
+			return (p);
+		}
+		p++;
+	}
+	return (end);
+}
+
+
+
+
+#ifdef DELIMITER_SCAN_X86
+
+/// Bit a row must have for a byte whose high nibble is the index; 0 for bytes >= 0x80.
+#define SCAN_HIGH_NIBBLE_BITS 1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0
+
+/**
+ * @brief 16 bytes per step until fewer than 16 are left.
+ * @details Always inlined, so inside findAvx2 it is VEX-encoded as well:
+ *          calling legacy SSE code with dirty upper YMM halves costs more
+ *          than the whole scan on short tokens.
+ */
+__attribute__((target("sse4.2"), always_inline))
+static inline const char*	scanBlocks16(const ScanTable& table, const char* p, const char* end) {
+	const __m128i	rows = _mm_load_si128(reinterpret_cast<const __m128i*>(table.rows));
+	const __m128i	bits = _mm_setr_epi8(SCAN_HIGH_NIBBLE_BITS);
+	const __m128i	nibble = _mm_set1_epi8(0x0F);
+	const __m128i	zero = _mm_setzero_si128();
+
+	while (end - p >= 16) {
+		__m128i	v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		__m128i	row = _mm_shuffle_epi8(rows, _mm_and_si128(v, nibble));
+		__m128i	bit = _mm_shuffle_epi8(bits, _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+		int		outside = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(row, bit), zero));
+
+		if (table.allowHigh) {
+			outside &= ~_mm_movemask_epi8(v);
+		}
+		if (outside) {
+			return (p + __builtin_ctz(outside));
+		}
+		p += 16;
+	}
+	return (p);
+}
+
+__attribute__((target("sse4.2")))
+static const char*	findSse42(const ScanTable& table, const char* p, const char* end) {
+	p = scanBlocks16(table, p, end);
+	if (end - p >= 16) {
+		return (p);
+	}
+	return (findScalar(table, p, end));
+}
+
+__attribute__((target("avx2")))
+static const char*	findAvx2(const ScanTable& table, const char* p, const char* end) {
+	const __m256i	rows = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(table.rows)));
+	const __m256i	bits = _mm256_setr_epi8(SCAN_HIGH_NIBBLE_BITS, SCAN_HIGH_NIBBLE_BITS);
+	const __m256i	nibble = _mm256_set1_epi8(0x0F);
+	const __m256i	zero = _mm256_setzero_si256();
+
+	while (end - p >= 32) {
+		__m256i		v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		__m256i		row = _mm256_shuffle_epi8(rows, _mm256_and_si256(v, nibble));
+		__m256i		bit = _mm256_shuffle_epi8(bits, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+		uint32_t	outside = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(row, bit), zero));
+
+		if (table.allowHigh) {
+			outside &= ~static_cast<uint32_t>(_mm256_movemask_epi8(v));
+		}
+		if (outside) {
+			return (p + __builtin_ctz(outside));
+		}
+		p += 32;
+	}
+	// Most tokens end within the next 16 bytes; let the 16-byte step catch them before going scalar.
+	p = scanBlocks16(table, p, end);
+	if (end - p >= 16) {
+		return (p);
+	}
+	return (findScalar(table, p, end));
+}
+
+#endif
+
+
+
+
+typedef const char*	(*ScanFunction)(const ScanTable&, const char*, const char*);
+
+static bool	isSupported(ScanKernel kernel) {
+#ifdef DELIMITER_SCAN_X86
+	// Also runs from a static initializer, possibly before libgcc filled in the CPU model.
+	__builtin_cpu_init();
+	switch (kernel) {
+		case SCAN_KERNEL_AVX2:
+			return (__builtin_cpu_supports("avx2"));
+
+		case SCAN_KERNEL_SSE42:
+			return (__builtin_cpu_supports("sse4.2"));
+
+		default:
+			return (kernel == SCAN_KERNEL_SCALAR);
+	}
+#else
+	return (kernel == SCAN_KERNEL_SCALAR);
+#endif
+}
+
+static ScanFunction	functionFor(ScanKernel kernel) {
+#ifdef DELIMITER_SCAN_X86
+	if (kernel == SCAN_KERNEL_AVX2) {
+		return (findAvx2);
+	}
+	if (kernel == SCAN_KERNEL_SSE42) {
+		return (findSse42);
+	}
+#endif
+	(void)kernel;
+	return (findScalar);
+}
+
+static ScanKernel	g_scanKernel = DelimiterScan::bestKernel();
+static ScanFunction	g_scanFunction = functionFor(g_scanKernel);
+
+
+
+
+const char*	DelimiterScan::find(ScanClass cls, const char* begin, const char* end) {
+	return (g_scanFunction(SCAN_TABLES[cls], begin, end));
+}
+
+
+
+
+ScanKernel	DelimiterScan::bestKernel(void) {
+	for (int kernel = SCAN_KERNEL_COUNT - 1; kernel > SCAN_KERNEL_SCALAR; kernel--) {
+		if (isSupported(static_cast<ScanKernel>(kernel))) {
+			return (static_cast<ScanKernel>(kernel));
+		}
+	}
+	return (SCAN_KERNEL_SCALAR);
+}
+
+
+
+
+ScanKernel	DelimiterScan::getKernel(void) {
+	return (g_scanKernel);
+}
+
+
+
+
+bool	DelimiterScan::setKernel(ScanKernel kernel) {
+	if (!isSupported(kernel)) {
+		return (false);
+	}
+	g_scanKernel = kernel;
+	g_scanFunction = functionFor(kernel);
+	return (true);
+}
+
+
+
+
+const char*	DelimiterScan::kernelName(ScanKernel kernel) {
+	static const char*	names[SCAN_KERNEL_COUNT] = {"scalar", "sse4.2", "avx2"};
+
+	return (kernel < SCAN_KERNEL_COUNT ? names[kernel] : "unknown");
+}
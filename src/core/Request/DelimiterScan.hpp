@@ -0,0 +1,95 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   DelimiterScan.hpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/24 09:18:52 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/24 09:18:52 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef DELIMITERSCAN_HPP
+#define DELIMITERSCAN_HPP
+
+
+
+
+#include <cstddef>
+#include <cstdint>
+
+
+
+
+/**
+ * @brief Byte classes a request head token may consist of.
+ * @details Scanning a class stops at the first byte outside of it, which is
+ *          the delimiter that ends the token (SP, ':', CR, LF) or an invalid
+ *          byte the parser rejects.
+ */
+enum ScanClass {
+    SCAN_TOKEN,         ///< RFC 9110 tchar: method and field names, stops on ':'
+    SCAN_VCHAR,         ///< Visible ASCII: HTTP version, stops on CR/LF
+    SCAN_TARGET,        ///< Visible ASCII and obs-text except '?': request target, stops on SP and '?'
+    SCAN_FIELD_VALUE,   ///< VCHAR, SP, HTAB and obs-text: field value, stops on CR/LF
+    SCAN_CLASS_COUNT
+};
+
+/**
+ * @brief Implementations of the scan, from slowest to fastest.
+ */
+enum ScanKernel {
+    SCAN_KERNEL_SCALAR,
+    SCAN_KERNEL_SSE42,  ///< 16 bytes per step
+    SCAN_KERNEL_AVX2,   ///< 32 bytes per step
+    SCAN_KERNEL_COUNT
+};
+
+/**
+ * @brief Finds the end of a request head token many bytes at a time.
+ * @details Every class is a 128-bit membership bitmap indexed by the low
+ *          nibble of a byte for the row and the high nibble for the bit, so
+ *          one PSHUFB per nibble classifies 16 (SSE) or 32 (AVX2) bytes at
+ *          once. The kernel is chosen once from the CPU the server runs on;
+ *          the scalar loop walks the same bitmap and handles the tail.
+ */
+class DelimiterScan {
+    public:
+        /**
+         * @brief Finds the first byte that does not belong to a class
+         * @param cls Class of the token being read
+         * @param begin First byte to look at
+         * @param end One past the last readable byte
+         * @return Pointer to that byte, or end if every byte belongs to the class
+         */
+        static const char *find(ScanClass cls, const char *begin, const char *end);
+
+        /**
+         * @brief Returns the fastest kernel this CPU supports
+         * @return The kernel selected at startup
+         */
+        static ScanKernel bestKernel(void);
+
+        /**
+         * @brief Returns the kernel find() currently dispatches to
+         * @return Active kernel
+         */
+        static ScanKernel getKernel(void);
+
+        /**
+         * @brief Forces a kernel, used by the benchmark to compare them
+         * @param kernel Kernel to use from now on
+         * @return false, with the kernel unchanged, if the CPU lacks the instructions
+         */
+        static bool setKernel(ScanKernel kernel);
+
+        /**
+         * @brief Returns a printable kernel name
+         * @param kernel Kernel to name
+         * @return "scalar", "sse4.2" or "avx2"
+         */
+        static const char *kernelName(ScanKernel kernel);
+};
+
+#endif
@@ -11,43 +11,31 @@
 /* ************************************************************************** */
 
 #include "Request.hpp"
+#include <algorithm>
+#include <strings.h>
 
-Request::Request() : _currentPosition(0), _bodySize(REQUEST_DEFAULT_MAX_BODY_SIZE), _timeout(REQUEST_DEFAULT_TIMEOUT), _statusCode(REQUEST_DEFAULT_STATUS_CODE), _isChunked(false) {
+Request::Request() : _bodySize(REQUEST_DEFAULT_MAX_BODY_SIZE), _timeout(REQUEST_DEFAULT_TIMEOUT), _statusCode(REQUEST_DEFAULT_STATUS_CODE), _isChunked(false), _isCgi(false), _bodyExpected(false), _headerCount(0) {
 }
 
-Request::Request(const std::string &rawRequest) : _rawRequest(rawRequest), _currentPosition(0), _method(""), _path(""), _httpVersion(""), _query(""), _body(""), _bodySize(REQUEST_DEFAULT_MAX_BODY_SIZE), _timeout(REQUEST_DEFAULT_TIMEOUT), _statusCode(REQUEST_DEFAULT_STATUS_CODE), _isChunked(false), _isCgi(false), _bodyExpected(false), _headers(), _supportedMethods(), _seenHeaders() {
-    registerSupportedMethods();
-    if (_rawRequest.empty()) {
-        std::cerr << "Empty request received." << std::endl;
-        this->setStatusCode(400);
-        return;
-    }
-}
-
-void Request::registerSupportedMethods(void){
-	_supportedMethods.insert("GET");
-	_supportedMethods.insert("POST");
-	_supportedMethods.insert("DELETE");
-}
-
-Request::Request(const Request &src) : _rawRequest(src._rawRequest), _currentPosition(src._currentPosition), _method(src._method), _path(src._path), _httpVersion(src._httpVersion), _query(src._query), _body(src._body), _bodySize(src._bodySize), _timeout(src._timeout), _statusCode(src._statusCode), _isChunked(src._isChunked), _isCgi(src._isCgi), _bodyExpected(src._bodyExpected), _headers(src._headers), _supportedMethods(src._supportedMethods), _seenHeaders(src._seenHeaders) {
+Request::Request(const Request &src) : _method(src._method), _path(src._path), _httpVersion(src._httpVersion), _query(src._query), _body(src._body), _bodySize(src._bodySize), _timeout(src._timeout), _statusCode(src._statusCode), _isChunked(src._isChunked), _isCgi(src._isCgi), _bodyExpected(src._bodyExpected), _headerCount(src._headerCount) {
+    std::copy(src._headers, src._headers + src._headerCount, _headers);
 }
 
 Request &Request::operator=(const Request &src) {
     if (this != &src) {
-        _rawRequest = src._rawRequest;
-        _currentPosition = src._currentPosition;
         _method = src._method;
         _path = src._path;
         _httpVersion = src._httpVersion;
-        _headers = src._headers;
+        std::copy(src._headers, src._headers + src._headerCount, _headers);
+        _headerCount = src._headerCount;
         _body = src._body;
         _query = src._query;
         _timeout = src._timeout;
         _statusCode = src._statusCode;
         _bodySize = src._bodySize;
         _isChunked = src._isChunked;
-        _supportedMethods = src._supportedMethods;
+        _isCgi = src._isCgi;
+        _bodyExpected = src._bodyExpected;
     }
     return *this;
 }
@@ -56,138 +44,132 @@ Request::~Request() {
 }
 
 void Request::reset() {
-    _rawRequest.clear();
-    _currentPosition = 0;
-    _method.clear();
-    _path.clear();
-    _httpVersion.clear();
-    _headers.clear();
+    _method = std::string_view();
+    _path = std::string_view();
+    _httpVersion = std::string_view();
+    _query = std::string_view();
+    _headerCount = 0;
     _body.clear();
-    _query.clear();
     _timeout = REQUEST_DEFAULT_TIMEOUT;
     _statusCode = REQUEST_DEFAULT_STATUS_CODE;
     _bodySize = REQUEST_DEFAULT_MAX_BODY_SIZE;
     _isChunked = false;
+    _isCgi = false;
+    _bodyExpected = false;
 }
 
-void Request::parseRequest() {
-    parseStartLine();
+static bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && strncasecmp(a.data(), b.data(), a.size()) == 0;
+}
+
+void Request::parseRequest(const RequestParser &parser, const std::string &buffer) {
+    if (parser.getState() == PARSE_FAILED) {
+        std::cerr << "Malformed request head." << std::endl;
+        return this->setStatusCode(parser.getErrorStatus());
+    }
+    const char *base = buffer.data();
+    const RequestSlice &target = parser.getTarget();
+
+    _method = parser.getMethod().view(base);
+    _httpVersion = parser.getVersion().view(base);
+    if (parser.getQueryStart() != 0) {
+        _path = std::string_view(base + target.offset, parser.getQueryStart() - target.offset);
+        _query = std::string_view(base + parser.getQueryStart() + 1, target.offset + target.length - parser.getQueryStart() - 1);
+    } else {
+        _path = target.view(base);
+    }
+    _headerCount = parser.getFieldCount();
+    for (size_t i = 0; i < _headerCount; i++) {
+        _headers[i].name = parser.getFieldName(i).view(base);
+        _headers[i].value = parser.getFieldValue(i).view(base);
+    }
+    parseMethod(_method);
     if (checkError()) return;
-    parseHeaders();
+    parseHttpVersion(_httpVersion);
     if (checkError()) return;
+    if (countHeader("Host") > 1) {
+        std::cerr << "Duplicate Host header." << std::endl;
+        return this->setStatusCode(400);
+    }
     _bodyExpected = checkBodyRelatedHeaders();
-    if (_bodyExpected && _headers.find("Content-Length") != _headers.end()) {
-        _bodySize = std::stoul(_headers["Content-Length"]);
-    }  
-	if (!_bodyExpected)
-		_bodySize = 0;
+    if (!_bodyExpected)
+        _bodySize = 0;
 }
 
 bool Request::checkBodyRelatedHeaders() {
-    auto it = _headers.find("Content-Length");
-    auto it2 = _headers.find("Transfer-Encoding");
-    if (it == _headers.end() && it2 == _headers.end())
-        return false;
-    if (it != _headers.end() && !it->second.empty() && std::stoul(it->second) > _bodySize) {
-        std::cerr << "Request body size exceeds the limit." << std::endl;
-        this->setStatusCode(413);
+    size_t lengthCount = countHeader("Content-Length");
+    size_t encodingCount = countHeader("Transfer-Encoding");
+    if (lengthCount == 0 && encodingCount == 0)
         return false;
-    }
-    if (it != _headers.end() && it2 != _headers.end() && it2->second != "chunked") {
-        std::cerr << "Invalid Transfer-Encoding header: " << it2->second << std::endl;
+    if (lengthCount > 1 || encodingCount > 1 || (lengthCount && encodingCount)) {
+        // Two framings for one body is how requests get smuggled past proxies.
+        std::cerr << "Ambiguous request body framing." << std::endl;
         this->setStatusCode(400);
         return false;
     }
-    if (_headers["Transfer-Encoding"] == "chunked")
+    if (encodingCount) {
+        std::string_view encoding = getHeader("Transfer-Encoding");
+        if (!equalsIgnoreCase(encoding, "chunked")) {
+            std::cerr << "Invalid Transfer-Encoding header: " << encoding << std::endl;
+            this->setStatusCode(400);
+            return false;
+        }
         _isChunked = true;
-    return true;
-}
-
-void Request::parseStartLine() {
-    std::string startLine;
-    while (_currentPosition < _rawRequest.size() && _rawRequest[_currentPosition] != '\n') {
-        startLine += _rawRequest[_currentPosition++];
+        return true;
     }
-    std::istringstream ss(startLine);
-    std::string method, uri, httpVersion;
-    ss >> method >> uri >> httpVersion;
-    parseMethod(method);
-    parseUri(uri);
-    parseHttpVersion(httpVersion);
-    _currentPosition++;
+    std::string_view length = getHeader("Content-Length");
+    unsigned long long value = 0;
+    if (length.empty() || length.size() > 19) {
+        std::cerr << "Invalid Content-Length header: " << length << std::endl;
+        this->setStatusCode(length.empty() ? 400 : 413);
+        return false;
+    }
+    for (char c : length) {
+        if (c < '0' || c > '9') {
+            std::cerr << "Invalid Content-Length header: " << length << std::endl;
+            this->setStatusCode(400);
+            return false;
+        }
+        value = value * 10 + (c - '0');
+    }
+    if (value > _bodySize) {
+        std::cerr << "Request body size exceeds the limit." << std::endl;
+        this->setStatusCode(413);
+        return false;
+    }
+    _bodySize = static_cast<unsigned>(value);
+    return true;
 }
 
-void Request::parseMethod(const std::string &method) {
-    if (method.empty()) {
-        std::cerr << "Empty method in request." << std::endl;
-        setStatusCode(400);
-		return ;
-    }
-    if (_supportedMethods.find(method) == _supportedMethods.end()) {
+void Request::parseMethod(std::string_view method) {
+    if (method != "GET" && method != "POST" && method != "DELETE") {
         std::cerr << "Unsupported method: " << method << std::endl;
         this->setStatusCode(405);
     }
-    _method = method;
 }
 
-void Request::parseHttpVersion(const std::string &httpVersion) {
-    if (httpVersion.empty()) {
-        std::cerr << "Empty HTTP version in request." << std::endl;
-        return this->setStatusCode(400);
-    }
+void Request::parseHttpVersion(std::string_view httpVersion) {
     if (httpVersion != "HTTP/1.1" && httpVersion != "HTTP/2.0") {
         std::cerr << "Unsupported HTTP version: " << httpVersion << std::endl;
         return this->setStatusCode(505);
     }
-    _httpVersion = httpVersion;
 }
 
-void Request::parseUri(const std::string &uri) {
-    if (uri.empty()) {
-        std::cerr << "Empty URI in request." << std::endl;
-        return this->setStatusCode(400);
-    }
-    std::string query;
-    std::string path;
-    if (uri.find('?') != std::string::npos) {
-        size_t pos = uri.find('?');
-        path = uri.substr(0, pos);
-        query = uri.substr(pos + 1);
-    } else {
-        path = uri;
+std::string_view Request::getHeader(std::string_view name) const {
+    for (size_t i = 0; i < _headerCount; i++) {
+        if (equalsIgnoreCase(_headers[i].name, name))
+            return _headers[i].value;
     }
-    _path = path;
-    _query = query;
+    return std::string_view();
 }
 
-void Request::parseHeaders() {
-    if (_currentPosition >= _rawRequest.size()) {
-        std::cerr << "No headers found in request." << std::endl;
-        return this->setStatusCode(400);
-    }
-    std::istringstream ss(&_rawRequest[_currentPosition]);
-    std::string line;
-    while (std::getline(ss, line)) {
-        if (line.empty() || line == "\r") {
-            break;
-        }
-       
-        size_t pos = line.find(':');
-        if (pos != std::string::npos) {
-            std::string headerName = line.substr(0, pos);
-            std::string headerValue = line.substr(pos + 1);
-            parsingUtils::trim(headerValue);
-            if (headerName.empty() || headerValue.empty()) {
-                std::cerr << "Invalid header: " << line << std::endl;
-                return this->setStatusCode(400);
-            }
-            _headers[headerName] = headerValue;
-        } else {
-            std::cerr << "Invalid header format: " << line << std::endl;
-            return this->setStatusCode(400);
-        }
-        _currentPosition += line.size() + 1;
+size_t Request::countHeader(std::string_view name) const {
+    size_t count = 0;
+    for (size_t i = 0; i < _headerCount; i++) {
+        if (equalsIgnoreCase(_headers[i].name, name))
+            count++;
     }
+    return count;
 }
 
 void Request::parseBody() {
@@ -238,27 +220,23 @@ void Request::setTimeout(time_t timeout) {
     _timeout = timeout;
 }
 
-const std::string &Request::getMethod() const {
+std::string_view Request::getMethod() const {
     return _method;
 }
 
-const std::string &Request::getPath() const {
+std::string_view Request::getPath() const {
     return _path;
 }
 
-const std::string &Request::getHttpVersion() const {
+std::string_view Request::getHttpVersion() const {
     return _httpVersion;
 }
 
-const std::unordered_map<std::string, std::string> &Request::getHeaders() const {
-    return _headers;
-}
-
 const std::string &Request::getBody() const {
     return _body;
 }
 
-const std::string &Request::getQuery() const {
+std::string_view Request::getQuery() const {
     return _query;
 }
 
@@ -294,8 +272,8 @@ void Request::printRequest() const {
     std::cout << "Path: " << _path << std::endl;
     std::cout << "HTTP Version: " << _httpVersion << std::endl;
     std::cout << "Headers:" << std::endl;
-    for (const auto &header : _headers) {
-        std::cout << "   " <<header.first << ": " << header.second << std::endl;
+    for (size_t i = 0; i < _headerCount; i++) {
+        std::cout << "   " << _headers[i].name << ": " << _headers[i].value << std::endl;
     }
     std::cout << "Body: " << _body << std::endl;
     std::cout << "Query: " << _query << std::endl;
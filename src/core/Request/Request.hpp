@@ -16,9 +16,10 @@
 
 
 #include "../parsingUtils.hpp"
-#include <unordered_map>
-#include <unordered_set>
+#include "RequestParser.hpp"
+#include <string_view>
 #include <iostream>
+#include <utility>
 
 
 
@@ -26,13 +27,23 @@
 #define REQUEST_DEFAULT_STATUS_CODE 200 // Default status code for the request
 #define REQUEST_DEFAULT_MAX_BODY_SIZE 1024 * 1024 * 1024 // Maximum body size for the request in bytes (1 GB)
 
+/**
+ * @brief One header field, both parts pointing into the connection buffer.
+ */
+struct RequestHeader {
+    std::string_view name;
+    std::string_view value;
+};
+
 /**
  * @brief HTTP request parser and handler class for the webserv application
- * @details This class is responsible for parsing raw HTTP requests, extracting method, URI, headers, 
- *          and body content. It supports various HTTP methods (GET, POST, DELETE), handles chunked 
+ * @details This class is responsible for validating the request head recorded by RequestParser,
+ *          exposing method, URI, headers and body content. It supports various HTTP methods (GET, POST, DELETE), handles chunked 
  *          transfer encoding, and validates request components according to HTTP standards.
  * @note The class automatically validates HTTP methods, versions, and body sizes, setting appropriate 
  *       status codes for malformed requests.
+ * @note Method, path, query, version and headers are views into the client's head buffer; they stay
+ *       valid until the client resets the request for the next one on the connection.
  */
 class Request {
     public:
@@ -44,17 +55,11 @@ class Request {
          */
         Request();
 
-        /**
-         * @brief Constructor with raw request string
-         * @param rawRequest The raw HTTP request string to parse
-         * @note Automatically registers supported methods and validates the request
-         */
-        Request(const std::string &rawRequest);
 
         /**
          * @brief Copy constructor
          * @param src The Request object to copy from
-         * @note Performs deep copy of all member variables
+         * @note The copy views the same head buffer as src
          */
         Request(const Request &src);
 
@@ -75,49 +80,29 @@ class Request {
 
         // Core parsing methods
         /**
-         * @brief Parses the complete HTTP request including start line, headers, and body
+         * @brief Validates the head recorded by the parser and binds the request fields to it
+         * @param parser Parser that reached PARSE_DONE or PARSE_FAILED on buffer
+         * @param buffer Connection buffer the parser was fed with
          * @return None
-         * @note Stops parsing if errors are encountered during any step
+         * @note A failed parse only carries the parser's status code (400 or 431)
          */
-        void parseRequest();
+        void parseRequest(const RequestParser &parser, const std::string &buffer);
 
         /**
-         * @brief Parses the first line of the HTTP request containing method, URI, and HTTP version
+         * @brief Validates the HTTP method of the request
+         * @param method The HTTP method to check
          * @return None
-         * @note Advances _currentPosition to skip the newline character after parsing
+         * @note Sets status code to 405 for unsupported methods
          */
-        void parseStartLine();
+        void parseMethod(std::string_view method);
 
         /**
-         * @brief Parses and validates the HTTP method from the request
-         * @param method The HTTP method string to parse
+         * @brief Validates the HTTP version of the request
+         * @param httpVersion The HTTP version to check
          * @return None
-         * @note Sets status code to 400 for empty methods or 405 for unsupported methods
+         * @note Sets status code to 505 for unsupported versions
          */
-        void parseMethod(const std::string &method);
-
-        /**
-         * @brief Parses the request URI, separating the path from query parameters
-         * @param uri The URI string to parse
-         * @return None
-         * @note Sets status code to 400 if URI is empty
-         */
-        void parseUri(const std::string &uri);
-
-        /**
-         * @brief Parses and validates the HTTP version from the request
-         * @param httpVersion The HTTP version string to parse
-         * @return None
-         * @note Sets status code to 400 for empty versions or 505 for unsupported versions
-         */
-        void parseHttpVersion(const std::string &httpVersion);
-
-        /**
-         * @brief Parses all HTTP headers from the request
-         * @return None
-         * @note Sets status code to 400 for invalid headers or missing headers
-         */
-        void parseHeaders();
+        void parseHttpVersion(std::string_view httpVersion);
 
         /**
          * @brief Parses the request body, handling both regular and chunked transfer encoding
@@ -157,42 +142,55 @@ class Request {
 
         /**
          * @brief Sets the request body
-         * @param body The body content to set
+         * @param body The body content to set, moved in
          * @return None
          */
-        void setBody(const std::string &body) { _body = body; }
+        void setBody(std::string &&body) { _body = std::move(body); }
 
         /**
          * @brief Resets all Request object fields to their default values
          * @return None
-         * @note Don't clear _supportedMethods as it's constant
+         * @note Drops the views, so the head buffer can be reused afterwards
          */
         void reset(void);
 
         // Getter methods
         /**
          * @brief Returns the HTTP method of the request
-         * @return const reference to the HTTP method string
+         * @return View of the HTTP method
          */
-        const std::string &getMethod() const;
+        std::string_view getMethod() const;
 
         /**
          * @brief Returns the request path
-         * @return const reference to the request path string
+         * @return View of the request path, without the query
          */
-        const std::string &getPath() const;
+        std::string_view getPath() const;
 
         /**
          * @brief Returns the HTTP version of the request
-         * @return const reference to the HTTP version string
+         * @return View of the HTTP version
+         */
+        std::string_view getHttpVersion() const;
+
+        /**
+         * @brief Looks up a header field, ignoring the case of its name
+         * @param name Field name to look for
+         * @return View of the first matching value, empty if the field is absent
+         */
+        std::string_view getHeader(std::string_view name) const;
+
+        /**
+         * @brief Returns the header fields in the order they were received
+         * @return Pointer to the first of getHeaderCount() fields
          */
-        const std::string &getHttpVersion() const;
+        const RequestHeader *getHeaders() const { return _headers; }
 
         /**
-         * @brief Returns the request headers as an unordered map
-         * @return const reference to the headers map
+         * @brief Returns the number of header fields
+         * @return The header count
          */
-        const std::unordered_map<std::string, std::string> &getHeaders() const;
+        size_t getHeaderCount() const { return _headerCount; }
 
         /**
          * @brief Returns the request body
@@ -208,9 +206,9 @@ class Request {
 
         /**
          * @brief Returns the query string from the URI
-         * @return const reference to the query string
+         * @return View of the query string, empty if the URI has none
          */
-        const std::string &getQuery() const;
+        std::string_view getQuery() const;
 
         /**
          * @brief Returns the timeout value for the request
@@ -244,9 +242,9 @@ class Request {
 
         /**
          * @brief Returns the request URI
-         * @return const reference to the request URI string
+         * @return View of the request URI path
          */
-        const std::string &getUri() const { return _path; }
+        std::string_view getUri() const { return _path; }
 
         // Utility methods
         /**
@@ -273,11 +271,11 @@ class Request {
     private:
         // Helper methods
         /**
-         * @brief Registers the supported HTTP methods (GET, POST, DELETE)
-         * @return None
-         * @note Called during construction to populate the supported methods set
+         * @brief Counts the header fields with the given name
+         * @param name Field name, compared case-insensitively
+         * @return Number of occurrences
          */
-        void registerSupportedMethods();
+        size_t countHeader(std::string_view name) const;
 
         /**
          * @brief Checks if the request should have a body based on Content-Length and Transfer-Encoding headers
@@ -287,12 +285,10 @@ class Request {
         bool checkBodyRelatedHeaders();
 
         // Request data attributes
-        std::string _rawRequest; // Raw HTTP request string
-        size_t _currentPosition; // Current position in the request stream
-        std::string _method; // HTTP method (GET, POST, DELETE)
-        std::string _path; // Request path
-        std::string _httpVersion; // HTTP version (HTTP/1.1, HTTP/2.0)
-        std::string _query; // Query string from the URL
+        std::string_view _method; // HTTP method (GET, POST, DELETE)
+        std::string_view _path; // Request path
+        std::string_view _httpVersion; // HTTP version (HTTP/1.1, HTTP/2.0)
+        std::string_view _query; // Query string from the URL
         std::string _body; // Request body
         unsigned _bodySize; // Size of the request body
 
@@ -303,10 +299,9 @@ class Request {
         bool _isCgi; // Flag to indicate if the request is a CGI request
         bool _bodyExpected; // Flag to indicate if the body is expected in the request
 
-        // Headers and methods
-        std::unordered_map<std::string, std::string> _headers; // Request headers
-        std::unordered_set<std::string> _supportedMethods; // Set of supported HTTP methods
-        std::unordered_set<std::string> _seenHeaders; // Set of seen headers to avoid duplicates
+        // Headers
+        RequestHeader _headers[REQUEST_MAX_HEADERS]; // Request headers, in arrival order
+        size_t _headerCount; // Number of used entries in _headers
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,215 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   RequestParser.cpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/23 10:41:07 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/23 10:41:07 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "RequestParser.hpp"
+#include "DelimiterScan.hpp"
+
+
+
+
+/**
+ * @brief Skip to the first byte outside a class.
+ * @return Offset of that byte, limit if the token runs to the end of the data.
+ */
+static size_t	skip(ScanClass cls, const char* data, size_t pos, size_t limit) {
+	return (DelimiterScan::find(cls, data + pos, data + limit) - data);
+}
+
+
+
+
+RequestParser::RequestParser() {
+	reset();
+}
+
+
+
+
+void	RequestParser::reset(void) {
+	_state = PARSE_LEADING_CRLF;
+	_offset = 0;
+	_tokenStart = 0;
+	_queryStart = 0;
+	_errorStatus = 0;
+	_method = RequestSlice();
+	_target = RequestSlice();
+	_version = RequestSlice();
+	_fieldCount = 0;
+}
+
+
+
+
+void	RequestParser::fail(int status) {
+	_state = PARSE_FAILED;
+	_errorStatus = status;
+}
+
+
+
+
+RequestParseState	RequestParser::parse(const char* data, size_t size) {
+	const size_t	limit = size < REQUEST_MAX_HEAD_SIZE ? size : REQUEST_MAX_HEAD_SIZE;
+	size_t			pos = _offset;
+
+	while (pos < limit && _state != PARSE_DONE && _state != PARSE_FAILED) {
+		switch (_state) {
+			case PARSE_LEADING_CRLF:
+				if (data[pos] == '\r' || data[pos] == '\n') {
+					pos++;
+					break;
+				}
+				_tokenStart = pos;
+				_state = PARSE_METHOD;
+			break;
+
+			case PARSE_METHOD:
+				pos = skip(SCAN_TOKEN, data, pos, limit);
+				if (pos == limit) {
+					break;
+				}
+				if (data[pos] != ' ' || pos == _tokenStart) {
+					fail(400);
+					break;
+				}
+				_method = RequestSlice{_tokenStart, pos - _tokenStart};
+				_tokenStart = ++pos;
+				_state = PARSE_TARGET;
+			break;
+
+			case PARSE_TARGET:
+				pos = skip(SCAN_TARGET, data, pos, limit);
+				if (pos == limit) {
+					break;
+				}
+				if (data[pos] == '?') {
+					_queryStart = _queryStart ? _queryStart : pos;
+					pos++;
+					break;
+				}
+				if (data[pos] != ' ' || pos == _tokenStart) {
+					fail(400);
+					break;
+				}
+				_target = RequestSlice{_tokenStart, pos - _tokenStart};
+				_tokenStart = ++pos;
+				_state = PARSE_VERSION;
+			break;
+
+			case PARSE_VERSION:
+				pos = skip(SCAN_VCHAR, data, pos, limit);
+				if (pos == limit) {
+					break;
+				}
+				if ((data[pos] != '\r' && data[pos] != '\n') || pos == _tokenStart) {
+					fail(400);
+					break;
+				}
+				_version = RequestSlice{_tokenStart, pos - _tokenStart};
+				// A bare LF is accepted as line terminator, as the previous parser did.
+				_state = data[pos] == '\r' ? PARSE_START_LINE_LF : PARSE_FIELD_START;
+				pos++;
+			break;
+
+			case PARSE_START_LINE_LF:
+			case PARSE_FIELD_LF:
+				if (data[pos] != '\n') {
+					fail(400);
+					break;
+				}
+				pos++;
+				_state = PARSE_FIELD_START;
+			break;
+
+			case PARSE_FIELD_START:
+				if (data[pos] == '\r' || data[pos] == '\n') {
+					_state = data[pos] == '\r' ? PARSE_HEAD_LF : PARSE_DONE;
+					pos++;
+					break;
+				}
+				if (data[pos] == ' ' || data[pos] == '\t') {
+					fail(400); // obsolete line folding
+					break;
+				}
+				if (_fieldCount == REQUEST_MAX_HEADERS) {
+					fail(431);
+					break;
+				}
+				_tokenStart = pos;
+				_state = PARSE_FIELD_NAME;
+			break;
+
+			case PARSE_FIELD_NAME:
+				pos = skip(SCAN_TOKEN, data, pos, limit);
+				if (pos == limit) {
+					break;
+				}
+				if (data[pos] != ':' || pos == _tokenStart) {
+					fail(400);
+					break;
+				}
+				_fieldNames[_fieldCount] = RequestSlice{_tokenStart, pos - _tokenStart};
+				pos++;
+				_state = PARSE_FIELD_OWS;
+			break;
+
+			case PARSE_FIELD_OWS:
+				while (pos < limit && (data[pos] == ' ' || data[pos] == '\t')) {
+					pos++;
+				}
+				if (pos == limit) {
+					break;
+				}
+				_tokenStart = pos;
+				_state = PARSE_FIELD_VALUE;
+			break;
+
+			case PARSE_FIELD_VALUE: {
+				size_t	valueEnd;
+
+				pos = skip(SCAN_FIELD_VALUE, data, pos, limit);
+				if (pos == limit) {
+					break;
+				}
+				if (data[pos] != '\r' && data[pos] != '\n') {
+					fail(400); // control character inside the value
+					break;
+				}
+				valueEnd = pos;
+				while (valueEnd > _tokenStart && (data[valueEnd - 1] == ' ' || data[valueEnd - 1] == '\t')) {
+					valueEnd--;
+				}
+				_fieldValues[_fieldCount++] = RequestSlice{_tokenStart, valueEnd - _tokenStart};
+				_state = data[pos] == '\r' ? PARSE_FIELD_LF : PARSE_FIELD_START;
+				pos++;
+			}
+			break;
+
+			case PARSE_HEAD_LF:
+				if (data[pos] != '\n') {
+					fail(400);
+					break;
+				}
+				pos++;
+				_state = PARSE_DONE;
+			break;
+
+			default:
+			break;
+		}
+	}
+	_offset = pos;
+	if (pos == REQUEST_MAX_HEAD_SIZE && _state != PARSE_DONE && _state != PARSE_FAILED) {
+		fail(431);
+	}
+	return (_state);
+}
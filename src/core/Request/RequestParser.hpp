@@ -0,0 +1,130 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   RequestParser.hpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/23 10:41:07 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/23 10:41:07 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef REQUESTPARSER_HPP
+#define REQUESTPARSER_HPP
+
+
+
+
+#define REQUEST_MAX_HEADERS       64           ///< Header fields kept per request, more is a 431
+#define REQUEST_MAX_HEAD_SIZE     (32 * 1024)  ///< Request line + headers, larger is a 431
+
+
+
+
+#include <cstddef>
+#include <string_view>
+
+
+
+
+/**
+ * @brief Position of the parser inside the request head.
+ */
+enum RequestParseState {
+    PARSE_LEADING_CRLF,   ///< Empty lines tolerated before the request line
+    PARSE_METHOD,
+    PARSE_TARGET,
+    PARSE_VERSION,
+    PARSE_START_LINE_LF,
+    PARSE_FIELD_START,    ///< Beginning of a header line, or of the terminating empty line
+    PARSE_FIELD_NAME,
+    PARSE_FIELD_OWS,      ///< Whitespace between ':' and the value
+    PARSE_FIELD_VALUE,
+    PARSE_FIELD_LF,
+    PARSE_HEAD_LF,        ///< LF of the empty line closing the head
+    PARSE_DONE,
+    PARSE_FAILED
+};
+
+/**
+ * @brief Byte range of a token inside the connection buffer.
+ * @details Offsets rather than pointers, so the buffer may grow between two
+ *          recv() calls while the head is still incomplete.
+ */
+struct RequestSlice {
+    size_t  offset;
+    size_t  length;
+
+    std::string_view view(const char* base) const { return (std::string_view(base + offset, length)); }
+};
+
+/**
+ * @brief Incremental HTTP/1.x request head parser.
+ * @details parse() is handed the whole connection buffer on every call and
+ *          resumes where the previous call stopped, so each byte is looked at
+ *          exactly once no matter how the head is split across recv() calls.
+ *          Tokens are skipped with DelimiterScan, 16 or 32 bytes at a time.
+ *          Method, target, query, version and header fields are recorded as
+ *          slices of that buffer into fixed storage; nothing is copied and
+ *          nothing is allocated.
+ */
+class RequestParser {
+  private:
+    RequestParseState   _state;
+    size_t              _offset;        ///< Next unread byte of the buffer
+    size_t              _tokenStart;    ///< Start of the token being read
+    size_t              _queryStart;    ///< Offset of the first '?' in the target, 0 if none
+    int                 _errorStatus;
+    RequestSlice        _method;
+    RequestSlice        _target;
+    RequestSlice        _version;
+    RequestSlice        _fieldNames[REQUEST_MAX_HEADERS];
+    RequestSlice        _fieldValues[REQUEST_MAX_HEADERS];
+    size_t              _fieldCount;
+
+    /**
+     * @brief Stop parsing with an error.
+     * @param status HTTP status the request must be answered with.
+     */
+    void fail(int status);
+
+  public:
+    RequestParser();
+
+    /**
+     * @brief Forget the previous request; the next head starts at offset 0.
+     */
+    void reset(void);
+
+    /**
+     * @brief Consume the bytes added to the buffer since the last call.
+     * @param data Start of the connection buffer.
+     * @param size Bytes currently in the buffer.
+     * @return PARSE_DONE once the empty line has been read, PARSE_FAILED on a
+     *         malformed head, any other state when more bytes are needed.
+     */
+    RequestParseState parse(const char* data, size_t size);
+
+    RequestParseState getState(void) const { return (_state); }
+
+    /**
+     * @brief Offset right after the head: the body or the next request starts here.
+     */
+    size_t getHeadSize(void) const { return (_offset); }
+
+    /**
+     * @brief Status to answer a failed parse with (400 or 431).
+     */
+    int getErrorStatus(void) const { return (_errorStatus); }
+
+    const RequestSlice& getMethod(void) const { return (_method); }
+    const RequestSlice& getTarget(void) const { return (_target); }
+    const RequestSlice& getVersion(void) const { return (_version); }
+    size_t getQueryStart(void) const { return (_queryStart); }
+    size_t getFieldCount(void) const { return (_fieldCount); }
+    const RequestSlice& getFieldName(size_t index) const { return (_fieldNames[index]); }
+    const RequestSlice& getFieldValue(size_t index) const { return (_fieldValues[index]); }
+};
+
+#endif
@@ -0,0 +1,112 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Compressor.cpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/26 10:14:03 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/26 10:14:03 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "Compressor.hpp"
+
+#define COMPRESSOR_GZIP_WINDOW (15 + 16) // 32 KB window, gzip header and trailer
+#define COMPRESSOR_ZLIB_WINDOW 15 // 32 KB window, zlib header and trailer ("deflate" coding)
+#define COMPRESSOR_MEM_LEVEL 8 // zlib default: about 256 KB of state per stream
+
+Compressor::Compressor() : _stream(), _active(false) {}
+
+Compressor::Compressor(const Compressor &src) : _stream(), _active(false) {
+    *this = src;
+}
+
+Compressor &Compressor::operator=(const Compressor &src) {
+    if (this != &src) {
+        end();
+        _stream = z_stream();
+        if (src._active)
+            _active = deflateCopy(&_stream, const_cast<z_stream *>(&src._stream)) == Z_OK;
+    }
+    return *this;
+}
+
+Compressor::~Compressor() {
+    end();
+}
+
+bool Compressor::supports(const std::string &encoding) {
+    return encoding == "gzip" || encoding == "deflate";
+}
+
+bool Compressor::begin(const std::string &encoding, int level) {
+    end();
+    if (!supports(encoding))
+        return false;
+    _stream = z_stream();
+    int windowBits = encoding == "gzip" ? COMPRESSOR_GZIP_WINDOW : COMPRESSOR_ZLIB_WINDOW;
+    _active = deflateInit2(&_stream, level, Z_DEFLATED, windowBits, COMPRESSOR_MEM_LEVEL, Z_DEFAULT_STRATEGY) == Z_OK;
+    return _active;
+}
+
+bool Compressor::update(const char *data, size_t size, std::string &out) {
+    if (!_active)
+        return false;
+    _stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    _stream.avail_in = static_cast<uInt>(size);
+    return run(Z_NO_FLUSH, out);
+}
+
+bool Compressor::flush(std::string &out) {
+    if (!_active)
+        return false;
+    _stream.next_in = Z_NULL;
+    _stream.avail_in = 0;
+    return run(Z_SYNC_FLUSH, out);
+}
+
+bool Compressor::finish(std::string &out) {
+    if (!_active)
+        return false;
+    _stream.next_in = Z_NULL;
+    _stream.avail_in = 0;
+    bool done = run(Z_FINISH, out);
+    end();
+    return done;
+}
+
+bool Compressor::compress(const std::string &encoding, int level, const std::string &in, std::string &out) {
+    Compressor compressor;
+
+    out.clear();
+    if (!compressor.begin(encoding, level))
+        return false;
+    // The bound holds for any input, so a single deflate() round normally suffices.
+    out.reserve(deflateBound(&compressor._stream, in.size()));
+    return compressor.update(in.data(), in.size(), out) && compressor.finish(out);
+}
+
+bool Compressor::run(int flush, std::string &out) {
+    int status;
+
+    do {
+        size_t used = out.size();
+        size_t space = out.capacity() > used + COMPRESSOR_OUTPUT_STEP ? out.capacity() - used : COMPRESSOR_OUTPUT_STEP;
+
+        out.resize(used + space);
+        _stream.next_out = reinterpret_cast<Bytef *>(&out[used]);
+        _stream.avail_out = static_cast<uInt>(space);
+        status = deflate(&_stream, flush);
+        out.resize(used + space - _stream.avail_out);
+        if (status == Z_STREAM_ERROR)
+            return false;
+    } while (flush == Z_FINISH ? status != Z_STREAM_END : _stream.avail_out == 0 || _stream.avail_in > 0);
+    return true;
+}
+
+void Compressor::end() {
+    if (_active)
+        deflateEnd(&_stream);
+    _active = false;
+}
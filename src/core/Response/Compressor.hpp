@@ -0,0 +1,111 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Compressor.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/26 10:14:03 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/26 10:14:03 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef COMPRESSOR_HPP
+#define COMPRESSOR_HPP
+
+#define COMPRESSOR_DEFAULT_LEVEL 1 // Fastest zlib level: most of the size gain for a fraction of the CPU
+#define COMPRESSOR_OUTPUT_STEP 16384 // Output space added per deflate() round
+
+#include <string>
+#include <zlib.h>
+
+/**
+ * @brief Streaming gzip or deflate (zlib) compressor for response payloads
+ * @details Input is fed in pieces as it becomes available and the compressed bytes
+ *          are appended to the caller's buffer, so a body never has to be held whole.
+ *          One instance compresses one payload; begin() starts the next one.
+ */
+class Compressor {
+    public:
+        Compressor();
+
+        /**
+         * @brief Copy constructor
+         * @param src The Compressor to copy from
+         * @note Duplicates the zlib state, both copies continue the same payload independently
+         */
+        Compressor(const Compressor &src);
+        Compressor &operator=(const Compressor &src);
+        ~Compressor();
+
+        /**
+         * @brief Starts a new payload
+         * @param encoding Content coding to produce: "gzip" or "deflate"
+         * @param level zlib level, 1 (fastest) to 9 (smallest)
+         * @return false if the coding is unknown or zlib cannot allocate its state
+         */
+        bool begin(const std::string &encoding, int level);
+
+        /**
+         * @brief Compresses the next piece of the payload
+         * @param data Input bytes
+         * @param size Number of input bytes
+         * @param out Compressed bytes are appended; may stay unchanged while zlib buffers input
+         * @return false on a zlib error
+         */
+        bool update(const char *data, size_t size, std::string &out);
+
+        /**
+         * @brief Emits every byte fed so far, without ending the payload
+         * @param out Compressed bytes are appended
+         * @return false on a zlib error
+         * @note Z_SYNC_FLUSH: costs a few bytes and some ratio, so call it only when the
+         *       receiver should see the data now (e.g. a streamed response that paused)
+         */
+        bool flush(std::string &out);
+
+        /**
+         * @brief Flushes what zlib still holds and writes the trailer
+         * @param out Compressed bytes are appended
+         * @return false on a zlib error
+         * @note The compressor is idle afterwards
+         */
+        bool finish(std::string &out);
+
+        /**
+         * @brief Compresses a whole payload at once
+         * @param encoding Content coding to produce: "gzip" or "deflate"
+         * @param level zlib level
+         * @param in Payload
+         * @param out Replaced by the compressed payload
+         * @return false if the payload could not be compressed; out is then unspecified
+         */
+        static bool compress(const std::string &encoding, int level, const std::string &in, std::string &out);
+
+        /**
+         * @brief Checks whether a content coding can be produced
+         * @param encoding Content coding name
+         * @return true for "gzip" and "deflate"
+         */
+        static bool supports(const std::string &encoding);
+
+    private:
+        /**
+         * @brief Runs deflate() until the input is consumed, or the stream ends when finishing
+         * @param flush Z_NO_FLUSH, Z_SYNC_FLUSH or Z_FINISH
+         * @param out Compressed bytes are appended
+         * @return false on a zlib error
+         */
+        bool run(int flush, std::string &out);
+
+        /**
+         * @brief Releases the zlib state
+         * @return None
+         */
+        void end();
+
+        z_stream _stream; // zlib state, valid while _active
+        bool _active; // deflateInit2() succeeded and deflateEnd() is still due
+};
+
+#endif
@@ -0,0 +1,303 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   FileBody.cpp                                       :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/21 11:40:27 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/22 16:08:51 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "FileBody.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+
+FileBody::FileBody() : _fd(-1), _mode(FILE_BODY_SENDFILE), _chunked(false), _offset(0), _remaining(0), _size(0), _buffer(), _bufferSent(0), _memory(), _compressor(), _input(), _ranges(), _rangeIndex(0), _headSent(0) {}
+
+FileBody::FileBody(const FileBody &src) :
+    _fd(src._fd == -1 ? -1 : dup(src._fd)),
+    _mode(src._mode),
+    _chunked(src._chunked),
+    _offset(src._offset),
+    _remaining(src._remaining),
+    _size(src._size),
+    _buffer(src._buffer),
+    _bufferSent(src._bufferSent),
+    _memory(src._memory),
+    _compressor(src._compressor ? std::make_unique<Compressor>(*src._compressor) : nullptr),
+    _input(src._input),
+    _ranges(src._ranges),
+    _rangeIndex(src._rangeIndex),
+    _headSent(src._headSent)
+{
+}
+
+FileBody &FileBody::operator=(const FileBody &src) {
+    if (this != &src) {
+        reset();
+        _fd = src._fd == -1 ? -1 : dup(src._fd);
+        _mode = src._mode;
+        _chunked = src._chunked;
+        _offset = src._offset;
+        _remaining = src._remaining;
+        _size = src._size;
+        _buffer = src._buffer;
+        _bufferSent = src._bufferSent;
+        _memory = src._memory;
+        _compressor = src._compressor ? std::make_unique<Compressor>(*src._compressor) : nullptr;
+        _input = src._input;
+        _ranges = src._ranges;
+        _rangeIndex = src._rangeIndex;
+        _headSent = src._headSent;
+    }
+    return *this;
+}
+
+FileBody::~FileBody() {
+    reset();
+}
+
+bool FileBody::open(const std::string &path, FileBodyMode mode, bool chunked) {
+    struct stat fileStat;
+
+    reset();
+    _fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (_fd == -1)
+        return false;
+    if (fstat(_fd, &fileStat) == -1 || !S_ISREG(fileStat.st_mode)) {
+        reset();
+        return false;
+    }
+    _chunked = chunked;
+    _mode = chunked ? FILE_BODY_BUFFERED : mode;
+    _offset = 0;
+    _size = fileStat.st_size;
+    _remaining = _size;
+    if (_chunked && _remaining == 0)
+        _buffer = "0\r\n\r\n";
+    return true;
+}
+
+void FileBody::open(std::shared_ptr<const std::string> content) {
+    reset();
+    _memory = std::move(content);
+    _mode = FILE_BODY_MEMORY;
+    _size = _memory->size();
+    _remaining = _size;
+}
+
+bool FileBody::compress(const std::string &encoding, int level) {
+    if (!_chunked || !_ranges.empty())
+        return false;
+    _compressor = std::make_unique<Compressor>();
+    if (!_compressor->begin(encoding, level)) {
+        _compressor.reset();
+        return false;
+    }
+    // An empty file still compresses to a header and a trailer, which replace the bare last-chunk.
+    if (_remaining == 0) {
+        _buffer.assign(FILE_BODY_CHUNK_HEADER_MAX, '\0');
+        if (!_compressor->finish(_buffer)) {
+            _compressor.reset();
+            _buffer = "0\r\n\r\n";
+            return false;
+        }
+        frameChunk(FILE_BODY_CHUNK_HEADER_MAX);
+    }
+    return true;
+}
+
+void FileBody::setRanges(std::vector<FileRange> ranges) {
+    _ranges = std::move(ranges);
+    _rangeIndex = 0;
+    _headSent = 0;
+    _size = 0;
+    for (const FileRange &range : _ranges)
+        _size += range.head.size() + range.length;
+    _offset = _ranges.empty() ? 0 : _ranges[0].offset;
+    _remaining = _ranges.empty() ? 0 : _ranges[0].length;
+}
+
+bool FileBody::isDone() const {
+    if (_remaining != 0 || _bufferSent != _buffer.size())
+        return false;
+    return _ranges.empty() || (_rangeIndex + 1 == _ranges.size() && _headSent == _ranges[_rangeIndex].head.size());
+}
+
+ssize_t FileBody::sendTo(int socketFd) {
+    ssize_t total = 0;
+
+    do {
+        if (!sendHead(socketFd, total))
+            return -1;
+        if (!_ranges.empty() && _headSent < _ranges[_rangeIndex].head.size())
+            return total; // socket full
+        if (_mode == FILE_BODY_SENDFILE && !sendFromFile(socketFd, total))
+            return -1;
+        if (_mode == FILE_BODY_BUFFERED && !sendFromBuffer(socketFd, total))
+            return -1;
+        if (_mode == FILE_BODY_MEMORY && !sendFromMemory(socketFd, total))
+            return -1;
+    } while (_remaining == 0 && _bufferSent == _buffer.size() && nextRange());
+    return total;
+}
+
+bool FileBody::sendHead(int socketFd, ssize_t &total) {
+    if (_ranges.empty())
+        return true;
+    const std::string &head = _ranges[_rangeIndex].head;
+    while (_headSent < head.size()) {
+        int flags = _remaining > 0 || _rangeIndex + 1 < _ranges.size() ? MSG_MORE : 0;
+        ssize_t sent = send(socketFd, head.data() + _headSent, head.size() - _headSent, flags);
+        if (sent == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return true;
+            return false;
+        }
+        _headSent += sent;
+        total += sent;
+    }
+    return true;
+}
+
+bool FileBody::nextRange() {
+    if (_rangeIndex + 1 >= _ranges.size())
+        return false;
+    _rangeIndex++;
+    _headSent = 0;
+    _offset = _ranges[_rangeIndex].offset;
+    _remaining = _ranges[_rangeIndex].length;
+    return true;
+}
+
+bool FileBody::sendFromFile(int socketFd, ssize_t &total) {
+    while (_remaining > 0) {
+        ssize_t sent = sendfile(socketFd, _fd, &_offset, _remaining);
+        if (sent == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return true;
+            if (errno == EINVAL || errno == ENOSYS) {
+                _mode = FILE_BODY_BUFFERED; // file system without sendfile support
+                return true;
+            }
+            return false;
+        }
+        if (sent == 0) {
+            errno = EIO; // the file got shorter than the Content-Length we announced
+            return false;
+        }
+        _remaining -= sent;
+        total += sent;
+    }
+    return true;
+}
+
+bool FileBody::sendFromBuffer(int socketFd, ssize_t &total) {
+    while (_remaining > 0 || _bufferSent < _buffer.size()) {
+        if (_bufferSent == _buffer.size()) {
+            if (!refill())
+                return false;
+            continue; // the compressor may have kept everything it was given
+        }
+        int flags = _remaining > 0 || _rangeIndex + 1 < _ranges.size() ? MSG_MORE : 0;
+        ssize_t sent = send(socketFd, _buffer.data() + _bufferSent, _buffer.size() - _bufferSent, flags);
+        if (sent == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return true;
+            return false;
+        }
+        _bufferSent += sent;
+        total += sent;
+    }
+    return true;
+}
+
+bool FileBody::sendFromMemory(int socketFd, ssize_t &total) {
+    while (_remaining > 0) {
+        int flags = _rangeIndex + 1 < _ranges.size() ? MSG_MORE : 0;
+        ssize_t sent = send(socketFd, _memory->data() + _offset, _remaining, flags);
+        if (sent == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return true;
+            return false;
+        }
+        _offset += sent;
+        _remaining -= sent;
+        total += sent;
+    }
+    return true;
+}
+
+bool FileBody::refill() {
+    // Leave room in front of the data for the chunk-size line, which is only known after the read.
+    size_t  reserve = _chunked ? FILE_BODY_CHUNK_HEADER_MAX : 0;
+    size_t  toRead = _remaining < FILE_BODY_BUFFER_SIZE ? static_cast<size_t>(_remaining) : FILE_BODY_BUFFER_SIZE;
+    // Compressed data is produced from a separate input buffer, plain data is read in place.
+    std::string &target = _compressor ? _input : _buffer;
+    size_t  start = _compressor ? 0 : reserve;
+
+    target.resize(start + toRead);
+    ssize_t bytesRead = pread(_fd, &target[start], toRead, _offset);
+    if (bytesRead <= 0) {
+        if (bytesRead == 0)
+            errno = EIO; // the file got shorter than announced
+        return false;
+    }
+    target.resize(start + bytesRead);
+    _offset += bytesRead;
+    _remaining -= bytesRead;
+    if (_compressor) {
+        _buffer.assign(reserve, '\0');
+        if (!_compressor->update(_input.data(), _input.size(), _buffer) || (_remaining == 0 && !_compressor->finish(_buffer))) {
+            errno = EIO;
+            return false;
+        }
+    }
+    if (_chunked)
+        frameChunk(reserve);
+    _bufferSent = 0;
+    return true;
+}
+
+void FileBody::frameChunk(size_t reserve) {
+    size_t  payload = _buffer.size() - reserve;
+
+    if (payload == 0) {
+        _buffer.clear();
+    } else {
+        char    chunkHeader[FILE_BODY_CHUNK_HEADER_MAX + 1];
+        int     headerLength = snprintf(chunkHeader, sizeof(chunkHeader), "%zx\r\n", payload);
+
+        _buffer.replace(0, reserve, chunkHeader, headerLength);
+        _buffer += "\r\n";
+    }
+    if (_remaining == 0)
+        _buffer += "0\r\n\r\n";
+    _bufferSent = 0;
+}
+
+void FileBody::reset() {
+    if (_fd != -1)
+        close(_fd);
+    _fd = -1;
+    _mode = FILE_BODY_SENDFILE;
+    _chunked = false;
+    _offset = 0;
+    _remaining = 0;
+    _size = 0;
+    _buffer.clear();
+    _bufferSent = 0;
+    _memory.reset();
+    _compressor.reset();
+    _input.clear();
+    _ranges.clear();
+    _rangeIndex = 0;
+    _headSent = 0;
+}
@@ -0,0 +1,188 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   FileBody.hpp                                       :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/21 11:40:27 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/22 16:08:51 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef FILEBODY_HPP
+#define FILEBODY_HPP
+
+#define FILE_BODY_BUFFER_SIZE 65536 // Upper bound of file data held in memory per connection
+#define FILE_BODY_CHUNK_HEADER_MAX 18 // 16 hex digits + CRLF
+
+#include "Compressor.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+/**
+ * @brief How a FileBody moves bytes from the file to the socket
+ */
+enum FileBodyMode {
+    FILE_BODY_SENDFILE, // Kernel copies page cache -> socket, no user-space buffer
+    FILE_BODY_BUFFERED, // pread() into a bounded buffer, then send(); needed for chunked framing
+    FILE_BODY_MEMORY    // send() straight from bytes already in memory (file cache hit)
+};
+
+/**
+ * @brief Slice of the file to send, with the bytes that precede it on the wire
+ */
+struct FileRange {
+    off_t offset; // First byte of the slice
+    off_t length; // Bytes of the file in the slice
+    std::string head; // Sent before the slice: multipart/byteranges delimiter and part header, or empty
+};
+
+/**
+ * @brief Response payload streamed from the file it comes from
+ * @details Keeps the open descriptor and the current offset and produces the next
+ *          bytes only when the socket reports EPOLLOUT, so memory per connection is
+ *          bounded no matter how large the file is. In sendfile mode the bytes never
+ *          enter user space; buffered mode refills at most FILE_BODY_BUFFER_SIZE at a
+ *          time and can wrap every refill in a chunk of Transfer-Encoding: chunked.
+ */
+class FileBody {
+    public:
+        FileBody();
+
+        /**
+         * @brief Copy constructor
+         * @param src The FileBody to copy from
+         * @note Duplicates the descriptor, both copies own their own fd
+         */
+        FileBody(const FileBody &src);
+        FileBody &operator=(const FileBody &src);
+        ~FileBody();
+
+        /**
+         * @brief Opens a regular file to be sent from the beginning
+         * @param path The file path to open
+         * @param mode sendfile() or bounded buffer
+         * @param chunked Frame the payload as chunked transfer coding (buffered mode only)
+         * @return true on success, false if the file cannot be opened or is not a regular file
+         */
+        bool open(const std::string &path, FileBodyMode mode, bool chunked);
+
+        /**
+         * @brief Sends bytes already held in memory instead of a file
+         * @param content Payload, shared with the cache so nothing is copied
+         * @return None
+         */
+        void open(std::shared_ptr<const std::string> content);
+
+        /**
+         * @brief Restricts the payload to slices of the file, sent in order
+         * @param ranges Slices within the file; a trailing slice of length 0 can carry the closing delimiter
+         * @return None
+         * @note Call right after open(), never with chunked framing. Each slice keeps the
+         *       transfer method, so a single range is still sent with sendfile()
+         */
+        void setRanges(std::vector<FileRange> ranges);
+
+        /**
+         * @brief Compresses the payload while it is streamed
+         * @param encoding Content coding to produce: "gzip" or "deflate"
+         * @param level zlib level
+         * @return false, leaving the payload as is, unless the body is chunked and has no ranges
+         * @note Call right after open(); the compressed length is unknown up front, hence chunked only.
+         *       Adds the zlib state (about 256 KB) and one input buffer to the connection
+         */
+        bool compress(const std::string &encoding, int level);
+
+        /**
+         * @brief Sends as much of the remaining payload as the socket accepts
+         * @param socketFd Non-blocking socket to write to
+         * @return Number of bytes sent (0 if the socket is full), -1 on error
+         * @note Falls back to buffered mode if the file system does not support sendfile();
+         *       a file that shrank while being sent is reported as an error
+         */
+        ssize_t sendTo(int socketFd);
+
+        /**
+         * @brief Closes the descriptor and forgets the range
+         * @return None
+         */
+        void reset();
+
+        bool isOpen() const { return _fd != -1 || _memory; }
+        bool isDone() const;
+        off_t getSize() const { return _size; }
+        off_t getRemaining() const { return _remaining; }
+
+    private:
+        /**
+         * @brief Sends what precedes the current range
+         * @param socketFd Socket to write to
+         * @param total Bytes sent so far in this call, updated
+         * @return false on error
+         */
+        bool sendHead(int socketFd, ssize_t &total);
+
+        /**
+         * @brief Moves to the next range once the current one is out
+         * @return false if there is no range left
+         */
+        bool nextRange();
+
+        /**
+         * @brief Reads the next slice of the file into the buffer, with chunk framing if enabled
+         * @return false if the file ended early or cannot be read
+         */
+        bool refill();
+
+        /**
+         * @brief Wraps the bytes after the reserved front of the buffer in a chunk
+         * @param reserve Bytes left free in front of the data for the chunk-size line
+         * @return None
+         * @note Adds the last-chunk once the file is consumed; an empty slice yields no chunk
+         */
+        void frameChunk(size_t reserve);
+
+        /**
+         * @brief Pushes the file to the socket with sendfile()
+         * @param socketFd Socket to write to
+         * @param total Bytes sent so far in this call, updated
+         * @return false on error
+         */
+        bool sendFromFile(int socketFd, ssize_t &total);
+
+        /**
+         * @brief Pushes the file to the socket through the bounded buffer
+         * @param socketFd Socket to write to
+         * @param total Bytes sent so far in this call, updated
+         * @return false on error
+         */
+        bool sendFromBuffer(int socketFd, ssize_t &total);
+
+        /**
+         * @brief Pushes the in-memory payload to the socket
+         * @param socketFd Socket to write to
+         * @param total Bytes sent so far in this call, updated
+         * @return false on error
+         */
+        bool sendFromMemory(int socketFd, ssize_t &total);
+
+        int _fd; // Open file, -1 when there is no file body
+        FileBodyMode _mode; // Current transfer method
+        bool _chunked; // Wrap each refill in a chunk and end with the last-chunk
+        off_t _offset; // Next byte of the file to read or send
+        off_t _remaining; // File bytes not yet read (buffered) or sent (sendfile)
+        off_t _size; // Total payload length: the file, or the ranges and their heads
+        std::string _buffer; // Pending wire bytes in buffered mode
+        size_t _bufferSent; // Bytes of _buffer already written to the socket
+        std::shared_ptr<const std::string> _memory; // Payload of FILE_BODY_MEMORY
+        std::unique_ptr<Compressor> _compressor; // Set when the file is compressed on the way out
+        std::string _input; // File bytes read for the compressor
+        std::vector<FileRange> _ranges; // Slices to send instead of the whole file, empty for all of it
+        size_t _rangeIndex; // Slice being sent
+        size_t _headSent; // Bytes of its head already written to the socket
+};
+
+#endif
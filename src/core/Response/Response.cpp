@@ -19,57 +19,56 @@ Response::Response(const Response &src) :
     _serverManager(src._serverManager),
     _serverConfig(src._serverConfig),
     _locationConfig(src._locationConfig),
-    _serverFd(src._serverFd),
+    _listener(src._listener),
     _clientFd(src._clientFd),
     _isCgi(src._isCgi),
     _cgiHandler(src._cgiHandler ? std::make_unique<CGIHandler>(*src._cgiHandler) : nullptr),
     _cgiIndexFile(src._cgiIndexFile),
     _statusCode(src._statusCode),
-    _statusMessage(src._statusMessage),
-    _rawResponse(src._rawResponse),
+    _statusLine(src._statusLine),
+    _headerBlock(src._headerBlock),
     _body(src._body),
     _headers(src._headers),
+    _fileBody(src._fileBody),
+    _streamBody(src._streamBody),
+    _cgiOutput(src._cgiOutput),
+    _cachedFile(src._cachedFile),
+    _output(),
+    _keepAlive(src._keepAlive),
     _validPath(src._validPath),
-    _statusMessages(src._statusMessages)
+    _fileStat(src._fileStat)
 {
 }
 
-Response::Response(Request *request, ServerManager *ServerManager, int serverFd, int clientFd) : 
+Response::Response(Request *request, ServerManager *ServerManager, std::shared_ptr<const Server> listener, int clientFd, size_t requestsServed) : 
     _request(request),
     _serverManager(ServerManager),
     _serverConfig(nullptr),
     _locationConfig(nullptr),
-    _serverFd(serverFd),
+    _listener(std::move(listener)),
 	_clientFd(clientFd),
 	_isCgi(false),
 	_cgiHandler(nullptr),
 	_cgiIndexFile(""),
 	_statusCode(200),
-	_statusMessage("OK"),
-	_rawResponse(""),
+	_statusLine(),
+	_headerBlock(""),
 	_body(""),
 	_headers(),
+	_fileBody(),
+	_streamBody(),
+	_cgiOutput(),
+	_cachedFile(),
+	_output(),
+	_keepAlive(false),
 	_validPath(false),
-	_statusMessages({
-		{200, "OK"},
-		{301, "Moved Permanently"},
-		{400, "Bad Request"},
-		{401, "Unauthorized"},
-		{403, "Forbidden"},
-		{404, "Not Found"},
-		{405, "Method Not Allowed"},
-		{408, "Request Timeout"},
-		{413, "Payload Too Large"},
-		{418, "I'm a teapot"},
-		{429, "Too Many Requests"},
-		{500, "Internal Server Error"}
-	})
+	_fileStat()
 {
     _statusCode = request->getStatusCode();
-    _statusMessage = _statusMessages[_statusCode];
     _validPath = false;
     matchServer();
     matchLocation();
+    _keepAlive = decideKeepAlive(requestsServed);
 }
 
 Response::~Response() {}
@@ -82,12 +81,8 @@ void Response::setStatusCode(int statusCode) {
     _statusCode = statusCode;
 }
 
-const std::string& Response::getStatusMessage() const {
-    return _statusMessage;
-}
-
-void Response::setStatusMessage(const std::string& statusMessage) {
-    _statusMessage = statusMessage;
+std::string_view Response::getStatusMessage() const {
+    return StatusLine::reason(_statusCode);
 }
 
 void Response::addHeader(const std::string& key, const std::string& value) {
@@ -107,19 +102,21 @@ const std::string& Response::getBody() const {
 }
 
 void Response::matchServer() {
-    const std::vector<const vServer*>&	subServConfigs = _serverManager->findServerConfigsByFd(_serverFd);
+    const std::vector<const vServer*>&	subServConfigs = _listener->getServConfigs();
 	if (subServConfigs.empty()) {
 		std::cerr << "No server configurations found for the connected socket." << std::endl;
 		setStatusCode(500);
         return ;
 	}
-    std::string hostHeaderValue = Client::getAnyHeader(_request->getHeaders(), "Host");
+    std::string_view hostHeaderValue = _request->getHeader("Host");
     if (hostHeaderValue.empty()) {
-        setStatusCode(400);
+        // Keep the parser's verdict (e.g. 431) when the head never got as far as Host.
+        if (_statusCode < 400)
+            setStatusCode(400);
         return ;
     }
     
-    _serverConfig = _serverManager->findServerConfigByName(subServConfigs, hostHeaderValue);
+    _serverConfig = _serverManager->findServerConfigByName(*_listener, hostHeaderValue);
     if (!_serverConfig) {
         setStatusCode(404);
         return ;
@@ -130,7 +127,8 @@ void Response::matchLocation() {
     if (!_serverConfig)
     {
         std::cerr << "No server config found" << std::endl;
-        setStatusCode(400);
+        if (_statusCode < 400)
+            setStatusCode(400);
         return;
     }
     _locationConfig = _serverManager->findLocationBlockByUri(*_serverConfig, _request->getUri());
@@ -146,8 +144,19 @@ void Response::matchLocation() {
         setStatusCode(413);
 }
 
-const std::string& Response::getRawResponse() const {
-    return _rawResponse;
+SegmentQueue& Response::buildOutput() {
+    _output.clear();
+    _output.push(_statusLine);
+    _output.push(_headerBlock);
+    if (_cachedFile && _statusCode == 200) {
+        _output.push(_cachedFile->headers);
+        _output.push("\r\n", 2);
+        // The entry outlives the send through _cachedFile: hand its bytes to the same sendmsg() as the head.
+        _output.push(_cachedFile->content);
+        _fileBody.reset();
+    }
+    _output.push(_body);
+    return _output;
 }
 
 void Response::generateResponse() {
@@ -162,7 +171,7 @@ void Response::generateResponse() {
     if (isCgiRequest())
         return handleCGIRequest();
 
-    std::string method = _request->getMethod();
+    std::string method(_request->getMethod());
     std::transform(method.begin(), method.end(), method.begin(), ::toupper);
     if (method == "GET")
         handleGetRequest();
@@ -181,15 +190,14 @@ void Response::generateResponse() {
     }
     createStartLine();
     createHeaders();
-    createBody();
 }
 
 void Response::generateErrorResponse() {
     std::cout << "Generating error response for status code: " << _statusCode << std::endl;
-    setStatusMessage(_statusMessages[_statusCode]);
-    
     _headers.clear();
     _body.clear();
+    _fileBody.reset();
+    _cachedFile.reset();
     
 	std::cout << "Checking for custom error page for status code: " << _statusCode << std::endl;
 	if (_locationConfig && _locationConfig->getLocationErrorPages().find(_statusCode) != _locationConfig->getLocationErrorPages().end()) {
@@ -206,15 +214,13 @@ void Response::generateErrorResponse() {
 		}
 	}
 	else {
-    _body = "<html><body><h1>" + std::to_string(_statusCode) + " " + _statusMessage + "</h1></body></html>";
+    _body = "<html><body><h1>" + std::to_string(_statusCode) + " " + std::string(StatusLine::reason(_statusCode)) + "</h1></body></html>";
 	}
     addHeader("Content-Type", "text/html");
-    addHeader("Connection", "close");
+    compressBody("text/html");
     
-	_rawResponse.clear();
     createStartLine();
     createHeaders();
-    createBody();
 }
 
 void Response::handleRedirectRequest() {
@@ -222,7 +228,6 @@ void Response::handleRedirectRequest() {
         std::pair<int, std::string> redirect = _locationConfig->getLocationReturnPages();
         if (redirect.first != 0) {
             setStatusCode(redirect.first);
-            setStatusMessage(_statusMessages[redirect.first]);
             addHeader("Location", redirect.second);
             _body.clear();
             createStartLine();
@@ -238,40 +243,35 @@ void Response::handleRedirectRequest() {
 }
 
 bool Response::isCgiRequest() {
-    std::string path = _request->getUri();
-    size_t extDot = path.find_last_of('.');
-    std::string extension;
-    if (extDot != std::string::npos)
-        extension = path.substr(path.find_last_of('.'));
-    else
-        extension = "";
-    std::map <std::string, std::string> cgiExtensions = _locationConfig->getLocationAllowedCgi();
+    std::string_view path = _request->getUri();
+    const std::map<std::string, std::string, std::less<>>& cgiExtensions = _locationConfig->getLocationAllowedCgi();
+    // The FastCGI application answers for every URI of its location, a directory through the first index file.
+    if (!_locationConfig->getLocationFastCgiPass().empty()) {
+        if (!path.empty() && path.back() == '/' && !_locationConfig->getLocationIndex().empty())
+            _cgiIndexFile = _locationConfig->getLocationIndex().front();
+        return true;
+    }
     if (cgiExtensions.empty()) {
         return false;
     }
-     if (extension.empty()) {
-        std::vector<std::string> indexFiles = _locationConfig->getLocationIndex();
-        if (indexFiles.empty()) {
-            std::cerr << "No index files specified for this location." << std::endl;
-            return false;
-        }
-        for (const auto &indexFile : indexFiles) {
-            extDot = indexFile.find_last_of('.');
-            std::string indexExtension;
-            if (extDot != std::string::npos)
-                indexExtension = indexFile.substr(extDot);
-            else
-                indexExtension = "";
-            if (cgiExtensions.find(indexExtension) != cgiExtensions.end() && fileExists(indexFile)) {
-				_cgiIndexFile = indexFile;
-                return true;
-            }
+    size_t extDot = path.find_last_of('.');
+    if (extDot != std::string_view::npos) {
+        return cgiExtensions.find(path.substr(extDot)) != cgiExtensions.end();
+    }
+    const std::vector<std::string>& indexFiles = _locationConfig->getLocationIndex();
+    if (indexFiles.empty()) {
+        std::cerr << "No index files specified for this location." << std::endl;
+        return false;
+    }
+    for (const std::string& indexFile : indexFiles) {
+        extDot = indexFile.find_last_of('.');
+        std::string_view indexExtension = extDot != std::string::npos ? std::string_view(indexFile).substr(extDot) : std::string_view();
+        if (cgiExtensions.find(indexExtension) != cgiExtensions.end() && fileExists(indexFile)) {
+            _cgiIndexFile = indexFile;
+            return true;
         }
     }
-    else if (cgiExtensions.find(extension) != cgiExtensions.end()) {
-        return true;
-    } 
-   return false;
+    return false;
 }
 
 void Response::handleCGIRequest() {
@@ -281,10 +281,23 @@ void Response::handleCGIRequest() {
     }
     try {
         _cgiHandler = std::make_unique<CGIHandler>(*_request, *_locationConfig, _cgiIndexFile);
-        _cgiHandler->start();
+        _cgiHandler->start(*_serverManager, _clientFd);
 		_isCgi = true;
-		_serverManager->addCgiFdToMap(_cgiHandler->getStdoutFd(), _clientFd);
-		_serverManager->addCgiFdToMap(_cgiHandler->getStderrFd(), _clientFd);
+		// A FastCGI application answers over its upstream connection, a pooled worker sends its stderr along with stdout.
+		// Stdin is only left open while some of the body still has to be written.
+		if (_cgiHandler->getStdinFd() != -1) {
+			_serverManager->addCgiFdSlot(_cgiHandler->getStdinFd(), _clientFd, EPOLLOUT);
+		}
+		if (_cgiHandler->getStdoutFd() != -1) {
+			_serverManager->addCgiFdSlot(_cgiHandler->getStdoutFd(), _clientFd, EPOLLIN);
+		}
+		if (_cgiHandler->getStderrFd() != -1) {
+			_serverManager->addCgiFdSlot(_cgiHandler->getStderrFd(), _clientFd, EPOLLIN);
+		}
+		// The pidfd turns readable when the script exits, which is when it is reaped.
+		if (_cgiHandler->getPidFd() != -1) {
+			_serverManager->addCgiFdSlot(_cgiHandler->getPidFd(), _clientFd, EPOLLIN);
+		}
     }
     catch (const CGIHandler::CGIException &e) {
         std::cerr << "CGI Exception: " << e.what() << std::endl;
@@ -294,12 +307,60 @@ void Response::handleCGIRequest() {
 }
 
 void Response::generateCGIResponse(){
-	_rawResponse.clear();
-	_rawResponse = _cgiHandler->finalize();
-	if (_rawResponse.empty()) {
-		setStatusCode(500);
+	_headerBlock = _cgiHandler->finalize(_body);
+	if (_headerBlock.empty()) {
+		setStatusCode(_cgiHandler->isFastCgiPass() ? 502 : 500);
 		return generateErrorResponse();
 	}
+	setStatusCode(200);
+	createStartLine();
+	compressCgiResponse();
+	// The CGI handler only knows the script output; announce date and connection state right after the start line.
+	_headerBlock.insert(0, _serverManager->getDateHeaders() + (_keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n"));
+}
+
+void Response::startCgiStream() {
+	bool chunked = _request->getHttpVersion() == "HTTP/1.1";
+	std::string fields;
+	std::string contentType;
+	// The length is unknown, so gzip_min_length cannot rule the body out.
+	std::string encoding = filterCgiFields(_cgiHandler->takeHeaders(), fields, contentType)
+		? negotiateCompression(contentType, std::numeric_limits<off_t>::max()) : "";
+
+	setStatusCode(200);
+	createStartLine();
+	// Without chunked framing only the end of the connection tells the client where the body ends.
+	if (!chunked)
+		_keepAlive = false;
+	_streamBody.open(chunked);
+	if (_headers.count("Vary"))
+		fields += "Vary: Accept-Encoding\r\n";
+	if (!encoding.empty() && _streamBody.compress(encoding, _locationConfig->getLocationGzip().level))
+		fields += "Content-Encoding: " + encoding + "\r\n";
+	if (chunked)
+		fields += "Transfer-Encoding: chunked\r\n";
+	_body.clear();
+	_headerBlock = _serverManager->getDateHeaders() + (_keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n") + fields + "\r\n";
+}
+
+bool Response::streamCgiOutput() {
+	if (_streamBody.isFinished())
+		return true;
+	if (_streamBody.getPending() < STREAM_BODY_HIGH_WATER) {
+		_cgiHandler->takeOutput(_cgiOutput);
+		if (!_streamBody.append(_cgiOutput)) {
+			_streamBody.abort();
+			return false;
+		}
+		_cgiOutput.clear();
+	}
+	if (!_cgiHandler->isDone() || _cgiHandler->hasOutput())
+		return true;
+	if (_cgiHandler->hasFailed() || !_streamBody.finish()) {
+		_streamBody.abort();
+		return false;
+	}
+	return true;
 }
 
 void Response::handleGetRequest() {
@@ -307,9 +368,22 @@ void Response::handleGetRequest() {
         setStatusCode(405);
         return generateErrorResponse();
     }
-    std::string path = _request->getPath();
+    std::string path(_request->getPath());
     std::string fullPath = _locationConfig->getLocationRoot() + resolveRelativePath(path, _locationConfig->getLocationPath());
-    
+    std::vector<std::string> encodings = acceptedEncodings();
+    std::string cacheKey = fullPath;
+    FileCache &fileCache = _serverManager->getFileCache();
+
+    // Which sibling is served depends on the codings the client accepts, so they are part of the key.
+    for (const std::string &encoding : encodings)
+        cacheKey += '\0' + encoding;
+    if (!_locationConfig->getLocationPrecompressed().empty())
+        addHeader("Vary", "Accept-Encoding");
+    std::shared_ptr<const CachedFile> cachedFile = fileCache.lookup(cacheKey);
+
+    if (cachedFile)
+        return serveCachedFile(cacheKey, cachedFile,
+            cachedFile->contentEncoding.empty() ? negotiateCompression(cachedFile->contentType, cachedFile->content.size()) : "");
     if (!fileExists(fullPath) && !_validPath) {
         setStatusCode(404);
         return generateErrorResponse();
@@ -330,6 +404,10 @@ void Response::handleGetRequest() {
 		if (!foundIndex) {
 			if (_locationConfig->getLocationAutoIndex()) {
 				_body = generateDirectoryListing(fullPath, _locationConfig->getLocationPath());
+				if (_statusCode < 400) {
+					addHeader("Content-Type", "text/html");
+					compressBody("text/html");
+				}
 				return ;
 			}
 			else {
@@ -339,56 +417,364 @@ void Response::handleGetRequest() {
 		}
 	}
 
-    if (isLargeFile(fullPath) && _statusCode < 400) {
-        makeChunkedResponse(fullPath);
-    } else if (_statusCode >= 400 ) {
+    // The type describes the original file whichever encoded sibling carries it.
+    std::string contentType = getMimeType(fullPath);
+    std::string encoding = selectPrecompressed(fullPath, encodings);
+    std::string compression = encoding.empty() ? negotiateCompression(contentType, _fileStat.st_size) : "";
+    std::string etag = parsingUtils::entityTag(_fileStat);
+    if (_statusCode >= 400 ) {
         generateErrorResponse();
+    } else if (isNotModified(etag, _fileStat.st_mtime)) {
+        makeNotModifiedResponse(etag, parsingUtils::httpDateString(_fileStat.st_mtime));
+    } else if ((cachedFile = fileCache.insert(cacheKey, fullPath, _locationConfig->getLocationRoot(), contentType, encoding))) {
+        serveCachedFile(cacheKey, cachedFile, compression);
     } else {
-        makeRegularResponse(fullPath);
+        if (!encoding.empty())
+            addHeader("Content-Encoding", encoding);
+        if (!compression.empty() && _request->getHttpVersion() == "HTTP/1.1")
+            makeCompressedResponse(fullPath, contentType, compression);
+        else if (!_locationConfig->getLocationSendfile() && _request->getHttpVersion() == "HTTP/1.1" && _request->getHeader("Range").empty() && isLargeFile(fullPath))
+            makeChunkedResponse(fullPath, contentType);
+        else
+            makeRegularResponse(fullPath, contentType);
+    }
+}
+
+void Response::serveCachedFile(const std::string &key, std::shared_ptr<const CachedFile> file, const std::string &compression) {
+    if (!compression.empty()) {
+        FileCache &fileCache = _serverManager->getFileCache();
+        // Two NULs cannot occur in a key otherwise: every precompressed coding in it is named.
+        std::string variantKey = key + std::string(2, '\0') + compression;
+        std::shared_ptr<const CachedFile> variant = fileCache.lookup(variantKey);
+
+        if (!variant)
+            variant = fileCache.insertVariant(variantKey, *file, compression, _locationConfig->getLocationGzip().level);
+        if (variant)
+            file = std::move(variant);
+    }
+    if (isNotModified(file->etag, file->mtime))
+        return makeNotModifiedResponse(file->etag, file->lastModified);
+    makeCachedResponse(std::move(file));
+}
+
+std::string Response::negotiateCompression(const std::string &contentType, off_t length) {
+    if (!_locationConfig || !_request)
+        return "";
+    const GzipConfig &gzip = _locationConfig->getLocationGzip();
+    std::string type = contentType.substr(0, contentType.find(';'));
+    std::string_view acceptEncoding = _request->getHeader("Accept-Encoding");
+
+    type.erase(type.find_last_not_of(" \t") + 1);
+    if (!gzip.enabled || length < static_cast<off_t>(gzip.minLength) || (!gzip.types.count("*") && !gzip.types.count(type)))
+        return "";
+    addHeader("Vary", "Accept-Encoding");
+    // A range addresses bytes of the file itself, so it is answered uncompressed.
+    if (acceptEncoding.empty() || !_request->getHeader("Range").empty())
+        return "";
+    int gzipQuality = parsingUtils::codingQuality(acceptEncoding, "gzip");
+    int deflateQuality = parsingUtils::codingQuality(acceptEncoding, "deflate");
+    if (gzipQuality == 0 && deflateQuality == 0)
+        return "";
+    return gzipQuality >= deflateQuality ? "gzip" : "deflate";
+}
+
+void Response::compressBody(const std::string &contentType) {
+    std::string encoding = negotiateCompression(contentType, _body.size());
+    std::string compressed;
+
+    if (encoding.empty() || !Compressor::compress(encoding, _locationConfig->getLocationGzip().level, _body, compressed))
+        return;
+    _body.swap(compressed);
+    addHeader("Content-Encoding", encoding);
+}
+
+bool Response::filterCgiFields(const std::string &block, std::string &fields, std::string &contentType) {
+    size_t lineStart = 0;
+    bool encoded = false;
+
+    while (lineStart < block.size()) {
+        size_t lineEnd = block.find("\r\n", lineStart);
+        if (lineEnd == std::string::npos)
+            lineEnd = block.size();
+        std::string line = block.substr(lineStart, lineEnd - lineStart);
+        size_t colon = line.find(':');
+        std::string name = line.substr(0, colon);
+
+        lineStart = lineEnd + 2;
+        if (colon == std::string::npos)
+            continue;
+        if (strcasecmp(name.c_str(), "Content-Encoding") == 0)
+            encoded = true;
+        if (strcasecmp(name.c_str(), "Content-Type") == 0) {
+            contentType = line.substr(colon + 1);
+            parsingUtils::trim(contentType);
+        }
+        // The server frames the body itself.
+        if (strcasecmp(name.c_str(), "Content-Length") != 0 && strcasecmp(name.c_str(), "Transfer-Encoding") != 0)
+            fields += line + "\r\n";
+    }
+    return !encoded;
+}
+
+void Response::compressCgiResponse() {
+    size_t headEnd = _headerBlock.find("\r\n\r\n");
+    std::string head;
+    std::string contentType;
+
+    // Keep every field but Content-Length, which changes; leave a body the script encoded itself alone.
+    if (headEnd == std::string::npos || !filterCgiFields(_headerBlock.substr(0, headEnd + 2), head, contentType))
+        return;
+    std::string encoding = negotiateCompression(contentType, _body.size());
+    std::string compressed;
+
+    if (encoding.empty() || !Compressor::compress(encoding, _locationConfig->getLocationGzip().level, _body, compressed)) {
+        if (_headers.count("Vary"))
+            _headerBlock.insert(headEnd + 2, "Vary: Accept-Encoding\r\n");
+        return;
+    }
+    _body.swap(compressed);
+    _headerBlock = head + "Vary: Accept-Encoding\r\nContent-Encoding: " + encoding + "\r\nContent-Length: " + std::to_string(_body.size()) + "\r\n\r\n";
+}
+
+std::vector<std::string> Response::acceptedEncodings() const {
+    const std::vector<std::string> &offered = _locationConfig->getLocationPrecompressed();
+    std::string_view acceptEncoding = _request->getHeader("Accept-Encoding");
+    std::vector<std::pair<int, std::string>> weighted;
+    std::vector<std::string> encodings;
+
+    if (offered.empty() || acceptEncoding.empty())
+        return encodings;
+    for (const std::string &encoding : offered) {
+        int quality = parsingUtils::codingQuality(acceptEncoding, encoding);
+        if (quality > 0)
+            weighted.emplace_back(quality, encoding);
+    }
+    // Stable: the configured order decides between codings the client weighs the same.
+    std::stable_sort(weighted.begin(), weighted.end(), [](const auto &a, const auto &b) { return a.first > b.first; });
+    for (const auto &entry : weighted)
+        encodings.push_back(entry.second);
+    return encodings;
+}
+
+std::string Response::selectPrecompressed(std::string &path, const std::vector<std::string> &encodings) {
+    struct stat siblingStat;
+
+    for (const std::string &encoding : encodings) {
+        std::string sibling = path + (encoding == "gzip" ? ".gz" : ".br");
+        if (stat(sibling.c_str(), &siblingStat) == 0 && S_ISREG(siblingStat.st_mode)) {
+            path = sibling;
+            _fileStat = siblingStat;
+            return encoding;
+        }
     }
+    return std::string();
 }
 
-void Response::makeRegularResponse(const std::string &path) {
-    std::ifstream file(path);
-    if (!file.is_open()) {
+void Response::makeRegularResponse(const std::string &path, const std::string &contentType) {
+    FileBodyMode mode = _locationConfig->getLocationSendfile() ? FILE_BODY_SENDFILE : FILE_BODY_BUFFERED;
+
+    if (!_fileBody.open(path, mode, false)) {
         setStatusCode(404);
         return generateErrorResponse();
     }
-    std::ostringstream oss;
-    oss << file.rdbuf();
-    _body = oss.str();
-    file.close();
     setStatusCode(200);
-    addHeader("Content-Length", std::to_string(_body.size()));
-    addHeader("Content-Type", getMimeType(path));
+    addHeader("Content-Length", std::to_string(_fileBody.getSize()));
+    addHeader("Content-Type", contentType);
+    addHeader("Accept-Ranges", "bytes");
+    addValidatorHeaders(_fileStat);
+    applyRangeRequest(parsingUtils::entityTag(_fileStat), _fileStat.st_mtime, contentType);
 };
 
-void Response::makeChunkedResponse(const std:: string &path) {
-    char buffer[RESPONSE_READ_BUFFER_SIZE];
-    int file = open(path.c_str(), O_RDONLY);
-    ssize_t bytesRead = read(file, buffer, RESPONSE_READ_BUFFER_SIZE);
-    if (bytesRead == -1)
-    {
+void Response::makeChunkedResponse(const std::string &path, const std::string &contentType) {
+    if (!_fileBody.open(path, FILE_BODY_BUFFERED, true)) {
         setStatusCode(404);
         return generateErrorResponse();
     }
-    else if (bytesRead == 0)
-    {
-        close(file);
-        _rawResponse += "0\r\n\r\n";
-    }
-    else
-    {
-        std::string chunkSize = intToHex(bytesRead) + "\r\n";
-        _rawResponse += chunkSize;
-        _rawResponse.append(buffer, bytesRead);
-        _rawResponse += "\r\n";
-    }
     addHeader("Transfer-Encoding", "chunked");
-    addHeader("Content-Type", getMimeType(path));
+    addHeader("Content-Type", contentType);
+    addHeader("Accept-Ranges", "bytes");
+    addValidatorHeaders(_fileStat);
     setStatusCode(200);
 };
 
+void Response::makeCompressedResponse(const std::string &path, const std::string &contentType, const std::string &encoding) {
+    makeChunkedResponse(path, contentType);
+    if (_statusCode != 200 || !_fileBody.compress(encoding, _locationConfig->getLocationGzip().level))
+        return;
+    std::string etag = parsingUtils::entityTag(_fileStat);
+    addHeader("Content-Encoding", encoding);
+    // The bytes depend on zlib as much as on the file: only a weak tag is honest.
+    addHeader("ETag", etag.compare(0, 2, "W/") == 0 ? etag : "W/" + etag);
+}
+
+void Response::makeCachedResponse(std::shared_ptr<const CachedFile> file) {
+    _fileBody.open(std::shared_ptr<const std::string>(file, &file->content));
+    _cachedFile = std::move(file);
+    setStatusCode(200);
+    if (!_cachedFile->contentEncoding.empty())
+        addHeader("Content-Encoding", _cachedFile->contentEncoding);
+    applyRangeRequest(_cachedFile->etag, _cachedFile->mtime, _cachedFile->contentType);
+}
+
+void Response::makeNotModifiedResponse(const std::string &etag, const std::string &lastModified) {
+    setStatusCode(304);
+    addHeader("ETag", etag);
+    addHeader("Last-Modified", lastModified);
+}
+
+void Response::addValidatorHeaders(const struct stat &fileStat) {
+    addHeader("ETag", parsingUtils::entityTag(fileStat));
+    addHeader("Last-Modified", parsingUtils::httpDateString(fileStat.st_mtime));
+}
+
+bool Response::isNotModified(const std::string &etag, time_t lastModified) const {
+    std::string_view ifNoneMatch = _request->getHeader("If-None-Match");
+    std::string_view ifModifiedSince = _request->getHeader("If-Modified-Since");
+    time_t since;
+
+    // RFC 9110 13.2.2: If-Modified-Since is ignored when If-None-Match is present.
+    if (!ifNoneMatch.empty())
+        return parsingUtils::entityTagMatches(ifNoneMatch, etag);
+    if (ifModifiedSince.empty() || !parsingUtils::parseHttpDate(ifModifiedSince, since))
+        return false;
+    return lastModified <= since;
+}
+
+void Response::applyRangeRequest(const std::string &etag, time_t lastModified, const std::string &contentType) {
+    std::vector<FileRange> ranges;
+    off_t size = _fileBody.getSize();
+    int status = selectRanges(etag, lastModified, size, ranges);
+
+    if (status == 416) {
+        setStatusCode(416);
+        generateErrorResponse();
+        // RFC 9110 14.4: tell the client the current length; error responses start from a clean header set.
+        _headerBlock.insert(0, "Content-Range: bytes */" + std::to_string(size) + "\r\n");
+        return;
+    }
+    if (status != 206)
+        return;
+    if (ranges.size() == 1) {
+        const FileRange &range = ranges[0];
+        addHeader("Content-Range", "bytes " + std::to_string(range.offset) + "-" + std::to_string(range.offset + range.length - 1) + "/" + std::to_string(size));
+        addHeader("Content-Type", contentType);
+    } else {
+        std::string boundary = generateUUID();
+        for (FileRange &range : ranges) {
+            range.head = "\r\n--" + boundary + "\r\nContent-Type: " + contentType + "\r\nContent-Range: bytes "
+                + std::to_string(range.offset) + "-" + std::to_string(range.offset + range.length - 1) + "/" + std::to_string(size) + "\r\n\r\n";
+        }
+        ranges.push_back(FileRange{0, 0, "\r\n--" + boundary + "--\r\n"});
+        addHeader("Content-Type", "multipart/byteranges; boundary=" + boundary);
+    }
+    _fileBody.setRanges(std::move(ranges));
+    setStatusCode(206);
+    addHeader("Content-Length", std::to_string(_fileBody.getSize()));
+    addHeader("Accept-Ranges", "bytes");
+    addHeader("ETag", etag);
+    addHeader("Last-Modified", parsingUtils::httpDateString(lastModified));
+}
+
+int Response::selectRanges(const std::string &etag, time_t lastModified, off_t size, std::vector<FileRange> &ranges) const {
+    std::string_view range = _request->getHeader("Range");
+    std::string_view ifRange = _request->getHeader("If-Range");
+
+    if (range.empty() || (!ifRange.empty() && !ifRangeMatches(ifRange, etag, lastModified)))
+        return 200;
+    if (!parseByteRanges(range, size, ranges)) {
+        ranges.clear();
+        return 200;
+    }
+    if (ranges.empty())
+        return 416;
+    // Overlapping or adjacent parts are merged, so a request cannot make us send a byte twice.
+    std::sort(ranges.begin(), ranges.end(), [](const FileRange &a, const FileRange &b) { return a.offset < b.offset; });
+    size_t merged = 0;
+    for (size_t i = 1; i < ranges.size(); i++) {
+        FileRange &last = ranges[merged];
+        if (ranges[i].offset <= last.offset + last.length) {
+            last.length = std::max(last.offset + last.length, ranges[i].offset + ranges[i].length) - last.offset;
+        } else {
+            ranges[++merged] = ranges[i];
+        }
+    }
+    ranges.resize(merged + 1);
+    return 206;
+}
+
+/**
+ * @brief Parses the digits of a range position, saturating instead of overflowing
+ */
+static bool parseRangePosition(std::string_view digits, off_t &value) {
+    const off_t max = std::numeric_limits<off_t>::max();
+
+    if (digits.empty())
+        return false;
+    value = 0;
+    for (char c : digits) {
+        if (!isdigit(static_cast<unsigned char>(c)))
+            return false;
+        value = value > (max - (c - '0')) / 10 ? max : value * 10 + (c - '0');
+    }
+    return true;
+}
+
+bool Response::parseByteRanges(std::string_view value, off_t size, std::vector<FileRange> &ranges) const {
+    size_t specs = 0;
+    size_t pos = 0;
+
+    if (value.size() < 6 || strncasecmp(value.data(), "bytes=", 6) != 0)
+        return false;
+    value.remove_prefix(6);
+    while (pos <= value.size()) {
+        size_t comma = std::min(value.find(',', pos), value.size());
+        std::string_view spec = value.substr(pos, comma - pos);
+        pos = comma + 1;
+
+        while (!spec.empty() && (spec.front() == ' ' || spec.front() == '\t'))
+            spec.remove_prefix(1);
+        while (!spec.empty() && (spec.back() == ' ' || spec.back() == '\t'))
+            spec.remove_suffix(1);
+        if (spec.empty())
+            continue; // empty list elements are allowed
+        if (++specs > RANGE_MAX_SPECS)
+            return false;
+        size_t dash = spec.find('-');
+        off_t first;
+        off_t last;
+        if (dash == std::string_view::npos)
+            return false;
+        if (dash == 0) {
+            // suffix-range: the final N bytes
+            if (!parseRangePosition(spec.substr(1), last))
+                return false;
+            if (last > 0 && size > 0)
+                ranges.push_back(FileRange{size - std::min(last, size), std::min(last, size), ""});
+            continue;
+        }
+        if (!parseRangePosition(spec.substr(0, dash), first))
+            return false;
+        if (dash + 1 == spec.size())
+            last = std::numeric_limits<off_t>::max();
+        else if (!parseRangePosition(spec.substr(dash + 1), last))
+            return false;
+        if (last < first)
+            return false;
+        if (first < size)
+            ranges.push_back(FileRange{first, std::min(last, size - 1) - first + 1, ""});
+    }
+    return specs > 0;
+}
+
+bool Response::ifRangeMatches(std::string_view ifRange, const std::string &etag, time_t lastModified) const {
+    time_t date;
+
+    // Strong comparison: a weak tag on either side never matches.
+    if (ifRange.front() == '"' || ifRange.compare(0, 2, "W/") == 0)
+        return etag.compare(0, 2, "W/") != 0 && ifRange == etag;
+    return etag.compare(0, 2, "W/") != 0 && parsingUtils::parseHttpDate(ifRange, date) && date == lastModified;
+}
+
 std::string Response::intToHex(int value) {
 	std::ostringstream oss;
 	oss << std::hex << value;
@@ -453,7 +839,7 @@ void Response::handleDeleteRequest() {
         setStatusCode(405);
         return generateErrorResponse();
     }
-    std::string path = _request->getPath();
+    std::string path(_request->getPath());
     if (path.find("..") != std::string::npos) {
         setStatusCode(400);
         return generateErrorResponse();
@@ -482,18 +868,32 @@ void Response::handleDeleteRequest() {
 }
 
 void Response::createStartLine() {
-    if (_statusMessages.find(_statusCode) == _statusMessages.end()) 
-        setStatusCode(418);
-    _statusMessage = _statusMessages[_statusCode];
-    std::string startLine = _request->getHttpVersion() + " " + std::to_string(_statusCode) + " " + _statusMessage + "\r\n";
-    _rawResponse += startLine;
+    // RFC 9110 15: an unrecognized code is treated as the x00 code of its class. A 1xx cannot end
+    // a response and a code outside 2xx-5xx has no class, so those become 500.
+    if (!StatusLine::isKnown(_statusCode))
+        setStatusCode(_statusCode >= 200 && _statusCode <= STATUS_CODE_MAX ? (_statusCode / 100) * 100 : 500);
+    _statusLine = StatusLine::get(_statusCode);
 }
 
 void Response::createHeaders(){
+    // A 304 describes the representation the client already has; it has no body of its own.
+    bool cachedHeaders = _cachedFile && _statusCode == 200;
+
+    if (!cachedHeaders && _statusCode != 304 && _headers.find("Content-Length") == _headers.end() && _headers.find("Transfer-Encoding") == _headers.end())
+        addHeader("Content-Length", std::to_string(_body.size()));
+    if (_keepAlive) {
+        addHeader("Connection", "keep-alive");
+        addHeader("Keep-Alive", "timeout=" + std::to_string(_serverConfig->getServerKeepaliveTimeout()));
+    } else {
+        addHeader("Connection", "close");
+    }
+    _headerBlock = _serverManager->getDateHeaders();
     for (const auto &header : _headers) {
-        _rawResponse += header.first + ": " + header.second + "\r\n";
+        _headerBlock += header.first + ": " + header.second + "\r\n";
     }
-    _rawResponse += "\r\n";
+    // The cached file's own header block and the blank line are separate segments, see buildOutput().
+    if (!cachedHeaders)
+        _headerBlock += "\r\n";
 }
 
 std::string Response::generateDirectoryListing(const std::string& fsPath, const std::string& urlPath) {
@@ -536,14 +936,6 @@ std::string Response::urlEncode(const std::string& value) {
     return encoded.str();
 }
 
-void Response::createBody() {
-    if (_body.empty()) {
-        _rawResponse += "\r\n";
-    } else {
-        _rawResponse += _body + "\r\n";
-    }
-}
-
 std::string Response::resolveRelativePath(const std::string &path, const std::string &locationPath) const {
 	std::string new_path = path;
     if (new_path.empty()) {
@@ -555,9 +947,25 @@ std::string Response::resolveRelativePath(const std::string &path, const std::st
     return locationPath + "/" + path;
 }
 
-bool Response::isMethodAllowed(const std::string &method) const {
-    const std::unordered_set<std::string>& allowedMethods = _locationConfig->getLocationAllowedMethods();
-    return (allowedMethods.count(method));
+bool Response::decideKeepAlive(size_t requestsServed) const {
+    if (!_serverConfig || _request->checkError() || _statusCode == 400)
+        return false;
+    if (_serverConfig->getServerKeepaliveTimeout() == 0 || requestsServed + 1 >= _serverConfig->getServerKeepaliveRequests())
+        return false;
+    // Accepted before a configuration reload: finish on the old configuration, then let the client reconnect.
+    if (_serverManager->isRetired(*_listener))
+        return false;
+    std::string connection(_request->getHeader("Connection"));
+    std::transform(connection.begin(), connection.end(), connection.begin(), ::tolower);
+    if (connection.find("close") != std::string::npos)
+        return false;
+    if (_request->getHttpVersion() != "HTTP/1.1" && connection.find("keep-alive") == std::string::npos)
+        return false;
+    return true;
+}
+
+bool Response::isMethodAllowed(std::string_view method) const {
+    return _locationConfig->isMethodAllowed(method);
 }
 
 bool Response::fileExists(const std::string &path) {
@@ -566,6 +974,7 @@ bool Response::fileExists(const std::string &path) {
         return false;
     }
     _validPath = true;
+    _fileStat = fileStat;
     return S_ISREG(fileStat.st_mode);
 };
 
@@ -19,16 +19,26 @@
 #include "../CGIHandler/CGIHandler.hpp"
 #include "../parsingConfFile/vServer.hpp"
 #include "../parsingConfFile/LocationConfig.hpp"
+#include "../parsingUtils.hpp"
+#include "../FileCache/FileCache.hpp"
+#include "FileBody.hpp"
+#include "StreamBody.hpp"
+#include "Compressor.hpp"
+#include "SegmentQueue.hpp"
+#include "StatusLine.hpp"
 #include <uuid/uuid.h>
+#include <limits>
+#include <strings.h>
 #include <sys/stat.h>
 #include <dirent.h>
 
 #define DEFAULT_CGI_DIRECTORY "/cgi-bin/"
 #define LARGE_FILE_SIZE_THRESHOLD 1048576 // 1 MB
-#define RESPONSE_READ_BUFFER_SIZE 8192 // Buffer size for reading response data
+#define RANGE_MAX_SPECS 64 // A Range with more parts than this is ignored and the whole file sent
 
 class ServerManager;
 class CGIHandler;
+class Server;
 
 /**
  * @brief HTTP response generator and handler class for the webserv application
@@ -53,11 +63,12 @@ class Response {
          * @brief Constructor with request and server information
          * @param request Pointer to the HTTP request object
          * @param serverManager Pointer to the server manager
-         * @param serverFd Server file descriptor
+         * @param listener Listening socket the request arrived on
          * @param clientfFd Client file descriptor
+         * @param requestsServed Number of responses already sent on this connection
          * @note Automatically matches server and location configurations
          */
-        Response(Request *request, ServerManager *serverManager, int serverFd, int clientfFd);
+        Response(Request *request, ServerManager *serverManager, std::shared_ptr<const Server> listener, int clientfFd, size_t requestsServed);
 
         /**
          * @brief Copy constructor
@@ -103,6 +114,21 @@ class Response {
          */
         void generateCGIResponse();
 
+        /**
+         * @brief Builds the head of a CGI response whose body is streamed while the script runs
+         * @return None
+         * @note Uses the script's header fields; the body goes chunked over HTTP/1.1, over HTTP/1.0
+         *       the connection is closed after it. Compressed on the fly when negotiated
+         */
+        void startCgiStream();
+
+        /**
+         * @brief Moves the script's output into the stream body, and ends it once the script is done
+         * @return false if the stream was cut short (script failed, zlib error): the connection has to be closed
+         * @note Takes nothing while STREAM_BODY_HIGH_WATER bytes still wait for the client
+         */
+        bool streamCgiOutput();
+
         // HTTP method handlers
         /**
          * @brief Handles GET requests by serving files or generating directory listings
@@ -141,41 +167,161 @@ class Response {
 
         // Response building methods
         /**
-         * @brief Creates the HTTP start line with version, status code, and message
+         * @brief Picks the pre-rendered HTTP/1.1 start line of the status code
          * @return None
-         * @note Sets status code to 418 if status code is not recognized
+         * @note An unrecognized status code becomes the x00 code of its class, or 500 when it has none;
+         *       replaces any previous start line
          */
         void createStartLine();
 
         /**
          * @brief Creates the HTTP headers section of the response
          * @return None
-         * @note Adds all stored headers and ends with double CRLF
+         * @note Starts with the reactor's cached Date and Server fields, then adds Content-Length if no framing
+         *       header was set, the Connection header and all stored headers;
+         *       ends the head with CRLF unless the cached file's header block still follows
          */
         void createHeaders();
 
         /**
-         * @brief Creates the response body section
+         * @brief Creates a regular response backed by the open file
+         * @param path The file path to serve
+         * @param contentType Content-Type of the requested file
+         * @return None
+         * @note Sets status code to 404 if file cannot be opened; the payload is sent later with sendfile()
+         */
+        void makeRegularResponse(const std::string &path, const std::string &contentType);
+
+        /**
+         * @brief Creates a chunked response streamed from the file through a bounded buffer
+         * @param path The file path to stream
+         * @param contentType Content-Type of the requested file
+         * @return None
+         * @note Sets status code to 404 if file cannot be opened; used for large files when sendfile is off
+         */
+        void makeChunkedResponse(const std::string &path, const std::string &contentType);
+
+        /**
+         * @brief Lists the precompressed codings of the location that the client accepts
+         * @return Codings ordered by the client's weights, then by the precompressed directive
+         * @note Empty when the location serves no precompressed files or Accept-Encoding is absent
+         */
+        std::vector<std::string> acceptedEncodings() const;
+
+        /**
+         * @brief Switches to the first existing precompressed sibling of a file (".gz", ".br")
+         * @param path The file path, replaced by the sibling's path when one is found
+         * @param encodings Acceptable codings, best first
+         * @return Content-Encoding of the sibling, empty if the file itself is served
+         * @note Updates the stat() result used for the validators to the sibling's
+         */
+        std::string selectPrecompressed(std::string &path, const std::vector<std::string> &encodings);
+
+        /**
+         * @brief Creates a response served from the reactor's file cache
+         * @param file Cached file, kept alive by the response until it is sent
+         * @return None
+         * @note Content-Length and Content-Type come pre-serialized with the file
+         */
+        void makeCachedResponse(std::shared_ptr<const CachedFile> file);
+
+        /**
+         * @brief Answers from a cached file, or from its cached compressed variant
+         * @param key Cache key the file was found or stored under
+         * @param file Cached file
+         * @param compression Coding to compress the file with, empty to send it as is
+         * @return None
+         * @note A variant is compressed once, on first use, and stored next to its source
+         */
+        void serveCachedFile(const std::string &key, std::shared_ptr<const CachedFile> file, const std::string &compression);
+
+        /**
+         * @brief Creates a chunked response compressed while it is streamed from the file
+         * @param path The file path to stream
+         * @param contentType Content-Type of the file
+         * @param encoding Content coding to produce
+         * @return None
+         * @note The ETag is made weak, the bytes on the wire are not the file's
+         */
+        void makeCompressedResponse(const std::string &path, const std::string &contentType, const std::string &encoding);
+
+        /**
+         * @brief Decides whether a body is compressed on the fly, following the gzip* directives
+         * @param contentType Content-Type of the body
+         * @param length Body length in bytes
+         * @return "gzip" or "deflate", empty to send the body as is
+         * @note Adds Vary: Accept-Encoding whenever the answer depends on the client's codings
+         */
+        std::string negotiateCompression(const std::string &contentType, off_t length);
+
+        /**
+         * @brief Compresses the in-memory body (directory listing, error page) when negotiated
+         * @param contentType Content-Type of the body
+         * @return None
+         */
+        void compressBody(const std::string &contentType);
+
+        /**
+         * @brief Keeps the header fields of a CGI script that the server does not decide itself
+         * @param block Fields as the script sent them, each ending in CRLF
+         * @param fields The fields but Content-Length and Transfer-Encoding are appended to it
+         * @param contentType Set to the Content-Type value
+         * @return false if the script encoded the body itself (Content-Encoding)
+         */
+        static bool filterCgiFields(const std::string &block, std::string &fields, std::string &contentType);
+
+        /**
+         * @brief Compresses the body of a complete CGI response when negotiated
          * @return None
-         * @note Adds body content if present, or just CRLF if no body
+         * @note Rewrites the script's header fields with the new Content-Length; output the script encoded itself is left as is
          */
-        void createBody();
+        void compressCgiResponse();
 
         /**
-         * @brief Creates a regular response by reading the entire file into memory
-         * @param path The file path to read
+         * @brief Creates a 304 response: no body and no file read
+         * @param etag Entity tag the client already has
+         * @param lastModified Last-Modified value of the file
          * @return None
-         * @note Sets status code to 404 if file cannot be opened
          */
-        void makeRegularResponse(const std::string &path);
+        void makeNotModifiedResponse(const std::string &etag, const std::string &lastModified);
 
         /**
-         * @brief Creates a chunked response for large files
-         * @param path The file path to read
+         * @brief Turns the open file response into a 206 or 416 if the request asks for ranges
+         * @param etag Entity tag of the file, checked against If-Range
+         * @param lastModified Modification time of the file, checked against If-Range
+         * @param contentType Content-Type of the file
          * @return None
-         * @note Sets status code to 404 if file cannot be read
+         * @note Leaves the 200 response untouched when there is no usable Range field
+         */
+        void applyRangeRequest(const std::string &etag, time_t lastModified, const std::string &contentType);
+
+        /**
+         * @brief Picks the byte ranges to send
+         * @param etag Entity tag of the file
+         * @param lastModified Modification time of the file
+         * @param size File size
+         * @param ranges Filled with the satisfiable ranges, sorted and coalesced
+         * @return 206 to send ranges, 416 if none is satisfiable, 200 to ignore the Range field
+         */
+        int selectRanges(const std::string &etag, time_t lastModified, off_t size, std::vector<FileRange> &ranges) const;
+
+        /**
+         * @brief Parses a Range field value of the bytes unit
+         * @param value Field value (e.g., "bytes=0-499,-500")
+         * @param size File size
+         * @param ranges Filled with the satisfiable ranges, in request order
+         * @return false if the value is not a valid byte range set
+         */
+        bool parseByteRanges(std::string_view value, off_t size, std::vector<FileRange> &ranges) const;
+
+        /**
+         * @brief Checks If-Range with strong comparison
+         * @param ifRange Entity tag or HTTP-date sent by the client
+         * @param etag Current entity tag of the file
+         * @param lastModified Modification time of the file
+         * @return true if the ranges may be served
          */
-        void makeChunkedResponse(const std::string &path);
+        bool ifRangeMatches(std::string_view ifRange, const std::string &etag, time_t lastModified) const;
 
         // Status line methods
         /**
@@ -192,17 +338,10 @@ class Response {
         void setStatusCode(int statusCode);
 
         /**
-         * @brief Gets the status message for the current status code
-         * @return const reference to the status message string
+         * @brief Gets the reason phrase of the current status code
+         * @return View of the static reason phrase, empty for an unknown code
          */
-        const std::string& getStatusMessage() const;
-
-        /**
-         * @brief Sets the status message for the response
-         * @param statusMessage The status message to set
-         * @return None
-         */
-        void setStatusMessage(const std::string& reasonPhrase);
+        std::string_view getStatusMessage() const;
 
         // Header methods
         /**
@@ -234,10 +373,17 @@ class Response {
         const std::string &getBody() const;
 
         /**
-         * @brief Gets the raw HTTP response string
-         * @return const reference to the raw response string
+         * @brief Lays out the generated response as segments, without copying any of it
+         * @return Queue of status line, header fields, cached header block and body
+         * @note A cached 200 body is sent from the cache entry itself, so the file body is released
+         */
+        SegmentQueue& buildOutput();
+
+        /**
+         * @brief Gets the segments built by buildOutput(), as far as they are sent
+         * @return Reference to the output queue
          */
-        const std::string& getRawResponse() const;
+        SegmentQueue& getOutput() { return _output; }
 
         // Utility methods
         /**
@@ -282,6 +428,30 @@ class Response {
          */
         int getClientFd() const { return _clientFd; }
 
+        /**
+         * @brief Checks if the connection stays open after this response
+         * @return true if the connection is persistent, false if it must be closed
+         */
+        bool getKeepAlive() const { return _keepAlive; }
+
+        /**
+         * @brief Gets the virtual server matched for this response
+         * @return Pointer to the server configuration, or nullptr if none matched
+         */
+        const vServer* getServerConfig() const { return _serverConfig; }
+
+        /**
+         * @brief Gets the file that follows the serialized headers, if any
+         * @return Reference to the file body (not open when the body is an output segment)
+         */
+        FileBody& getFileBody() { return _fileBody; }
+
+        /**
+         * @brief Gets the body produced while it is sent (CGI output)
+         * @return Reference to the stream body (not open unless the response is streamed)
+         */
+        StreamBody& getStreamBody() { return _streamBody; }
+
     private:
         // Configuration and matching methods
         /**
@@ -303,7 +473,15 @@ class Response {
          * @param method The HTTP method to check
          * @return true if method is allowed, false otherwise
          */
-        bool isMethodAllowed(const std::string &method) const;
+        bool isMethodAllowed(std::string_view method) const;
+
+        /**
+         * @brief Decides whether the connection can be reused after this response
+         * @param requestsServed Number of responses already sent on this connection
+         * @return true if the connection should be kept alive, false otherwise
+         * @note Honours the request's Connection header and the keepalive_timeout/keepalive_requests directives
+         */
+        bool decideKeepAlive(size_t requestsServed) const;
 
         /**
          * @brief Checks if the request is a CGI request based on file extension or index files
@@ -317,10 +495,25 @@ class Response {
          * @brief Checks if a file exists at the given path
          * @param path The file path to check
          * @return true if file exists and is a regular file, false otherwise
-         * @note Sets _validPath to true if file exists
+         * @note Sets _validPath to true if file exists and keeps its stat() result in _fileStat
          */
         bool fileExists(const std::string &path);
 
+        /**
+         * @brief Evaluates If-None-Match, or If-Modified-Since when it is absent
+         * @param etag Current entity tag of the file
+         * @param lastModified Modification time of the file
+         * @return true if the client's copy is current and 304 should be sent
+         */
+        bool isNotModified(const std::string &etag, time_t lastModified) const;
+
+        /**
+         * @brief Adds the ETag and Last-Modified fields of a file
+         * @param fileStat stat() result of the file being served
+         * @return None
+         */
+        void addValidatorHeaders(const struct stat &fileStat);
+
         /**
          * @brief Checks if a file is considered large based on size threshold
          * @param path The file path to check
@@ -367,7 +560,7 @@ class Response {
         ServerManager *_serverManager; // Server manager to access server configurations
         const vServer *_serverConfig; // Virtual server configuration for the response
         const Location *_locationConfig; // Location configuration for the response
-        int _serverFd; // Server file descriptor for the response
+        std::shared_ptr<const Server> _listener; // Listening socket of the connection; keeps _serverConfig and _locationConfig alive
         int _clientFd; // Client file descriptor for the response
 
         // CGI handling attributes
@@ -377,14 +570,21 @@ class Response {
 
         // Response attributes
         int _statusCode; // HTTP status code (e.g., 200, 404, 500)
-        std::string _statusMessage; // HTTP status message (e.g., "OK", "Not Found")
-        std::string _rawResponse; // Complete HTTP response string
-        std::string _body; // Body of the response
+        std::string_view _statusLine; // Start line including its CRLF, from the static StatusLine table
+        std::string _headerBlock; // Header fields, each ending in CRLF; inserting at 0 puts a field right after the start line
+        std::string _body; // Body of the response, sent as its own segment
         std::unordered_map<std::string, std::string> _headers; // HTTP headers for the response
+        FileBody _fileBody; // Static file sent after the output segments
+        StreamBody _streamBody; // CGI output sent while the script runs
+        std::string _cgiOutput; // Script output on its way into _streamBody, kept for its allocation
+        std::shared_ptr<const CachedFile> _cachedFile; // File cache entry being served, if any
+        SegmentQueue _output; // What goes on the wire before the file body, pointing into the strings above
+
+        bool _keepAlive; // Flag to indicate if the connection is kept open after the response
 
         // Path and file attributes
         bool _validPath; // Flag to indicate if the path is valid
-        std::unordered_map<int, std::string> _statusMessages; // Map of status codes to messages
+        struct stat _fileStat; // stat() of the last path fileExists() found
 };
 
 #endif
\ No newline at end of file
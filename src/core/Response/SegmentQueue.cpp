@@ -0,0 +1,70 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   SegmentQueue.cpp                                   :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/26 10:14:03 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/26 10:14:03 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "SegmentQueue.hpp"
+#include <cerrno>
+#include <stdexcept>
+#include <sys/socket.h>
+
+SegmentQueue::SegmentQueue() : _segments(), _count(0), _current(0) {}
+
+void SegmentQueue::clear() {
+    _count = 0;
+    _current = 0;
+}
+
+void SegmentQueue::push(const void *data, size_t size) {
+    if (size == 0)
+        return;
+    if (_count == SEGMENT_QUEUE_MAX)
+        throw std::length_error("SegmentQueue: too many segments");
+    _segments[_count].iov_base = const_cast<void *>(data);
+    _segments[_count].iov_len = size;
+    _count++;
+}
+
+void SegmentQueue::push(std::string_view data) {
+    push(data.data(), data.size());
+}
+
+ssize_t SegmentQueue::sendTo(int fd, int flags) {
+    struct msghdr message = {};
+    ssize_t bytesSent;
+    size_t left;
+
+    if (isDone())
+        return 0;
+    message.msg_iov = &_segments[_current];
+    message.msg_iovlen = _count - _current;
+    bytesSent = sendmsg(fd, &message, flags | MSG_NOSIGNAL);
+    if (bytesSent == -1)
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+    // Drop the segments that are fully out and trim the one the write stopped in.
+    left = static_cast<size_t>(bytesSent);
+    while (_current < _count && left >= _segments[_current].iov_len) {
+        left -= _segments[_current].iov_len;
+        _current++;
+    }
+    if (left > 0) {
+        _segments[_current].iov_base = static_cast<char *>(_segments[_current].iov_base) + left;
+        _segments[_current].iov_len -= left;
+    }
+    return bytesSent;
+}
+
+size_t SegmentQueue::getRemaining() const {
+    size_t remaining = 0;
+
+    for (size_t i = _current; i < _count; i++)
+        remaining += _segments[i].iov_len;
+    return remaining;
+}
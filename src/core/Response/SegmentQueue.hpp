@@ -0,0 +1,81 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   SegmentQueue.hpp                                   :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/26 10:14:03 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/26 10:14:03 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef SEGMENTQUEUE_HPP
+#define SEGMENTQUEUE_HPP
+
+#define SEGMENT_QUEUE_MAX 8 // Status line, header fields, cached header block, blank line, body, with room to spare
+
+#include <string_view>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+/**
+ * @brief Pieces of a response sent with one sendmsg() per EPOLLOUT
+ * @details Each segment points at bytes owned by someone else (the Response, the
+ *          file cache, a static string), so status line, header block and body go
+ *          out together without ever being concatenated. A partial write advances
+ *          into the first unsent segment; the next call resumes from there.
+ */
+class SegmentQueue {
+    public:
+        SegmentQueue();
+
+        /**
+         * @brief Forgets every segment
+         * @return None
+         */
+        void clear();
+
+        /**
+         * @brief Appends bytes to send after the queued ones
+         * @param data First byte, must stay valid until the queue is sent or cleared
+         * @param size Number of bytes; empty segments are skipped
+         * @return None
+         * @throws std::length_error if the queue already holds SEGMENT_QUEUE_MAX segments
+         */
+        void push(const void *data, size_t size);
+
+        /**
+         * @brief Appends a string to send after the queued ones
+         * @param data Bytes to send, not copied: the storage must outlive the send
+         * @return None
+         */
+        void push(std::string_view data);
+
+        /**
+         * @brief Sends as much of the remaining segments as the socket takes
+         * @param fd Socket to write to
+         * @param flags sendmsg() flags, e.g. MSG_MORE when a file body follows
+         * @return Bytes sent, 0 if the socket is full, -1 on error
+         */
+        ssize_t sendTo(int fd, int flags);
+
+        /**
+         * @brief Tells if every segment is out
+         * @return true when nothing is left to send
+         */
+        bool isDone() const { return _current == _count; }
+
+        /**
+         * @brief Gets the bytes still to send
+         * @return Sum of the remaining segment sizes
+         */
+        size_t getRemaining() const;
+
+    private:
+        struct iovec _segments[SEGMENT_QUEUE_MAX];
+        size_t _count; // Segments queued
+        size_t _current; // First segment not fully sent
+};
+
+#endif
@@ -0,0 +1,117 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   StatusLine.cpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/26 10:14:03 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/26 10:14:03 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "StatusLine.hpp"
+#include <cstdint>
+
+/// Prefix every line starts with; reason() skips it and the three digits after it.
+#define STATUS_LINE_VERSION "HTTP/1.1 "
+#define STATUS_LINE_REASON_OFFSET (sizeof(STATUS_LINE_VERSION) - 1 + 4)
+
+#define STATUS_LINE(code, reason) {code, STATUS_LINE_VERSION #code " " reason "\r\n", sizeof(STATUS_LINE_VERSION #code " " reason "\r\n") - 1}
+
+struct StatusLineEntry {
+    int code;
+    const char *line;
+    size_t length; // Bytes of line, CRLF included
+};
+
+/// RFC 9110 section 15, plus 418 and the RFC 6585 codes the server emits.
+static constexpr StatusLineEntry STATUS_LINES[] = {
+    STATUS_LINE(100, "Continue"),
+    STATUS_LINE(101, "Switching Protocols"),
+    STATUS_LINE(200, "OK"),
+    STATUS_LINE(201, "Created"),
+    STATUS_LINE(202, "Accepted"),
+    STATUS_LINE(203, "Non-Authoritative Information"),
+    STATUS_LINE(204, "No Content"),
+    STATUS_LINE(205, "Reset Content"),
+    STATUS_LINE(206, "Partial Content"),
+    STATUS_LINE(300, "Multiple Choices"),
+    STATUS_LINE(301, "Moved Permanently"),
+    STATUS_LINE(302, "Found"),
+    STATUS_LINE(303, "See Other"),
+    STATUS_LINE(304, "Not Modified"),
+    STATUS_LINE(305, "Use Proxy"),
+    STATUS_LINE(307, "Temporary Redirect"),
+    STATUS_LINE(308, "Permanent Redirect"),
+    STATUS_LINE(400, "Bad Request"),
+    STATUS_LINE(401, "Unauthorized"),
+    STATUS_LINE(402, "Payment Required"),
+    STATUS_LINE(403, "Forbidden"),
+    STATUS_LINE(404, "Not Found"),
+    STATUS_LINE(405, "Method Not Allowed"),
+    STATUS_LINE(406, "Not Acceptable"),
+    STATUS_LINE(407, "Proxy Authentication Required"),
+    STATUS_LINE(408, "Request Timeout"),
+    STATUS_LINE(409, "Conflict"),
+    STATUS_LINE(410, "Gone"),
+    STATUS_LINE(411, "Length Required"),
+    STATUS_LINE(412, "Precondition Failed"),
+    STATUS_LINE(413, "Payload Too Large"),
+    STATUS_LINE(414, "URI Too Long"),
+    STATUS_LINE(415, "Unsupported Media Type"),
+    STATUS_LINE(416, "Range Not Satisfiable"),
+    STATUS_LINE(417, "Expectation Failed"),
+    STATUS_LINE(418, "I'm a teapot"),
+    STATUS_LINE(421, "Misdirected Request"),
+    STATUS_LINE(422, "Unprocessable Content"),
+    STATUS_LINE(426, "Upgrade Required"),
+    STATUS_LINE(428, "Precondition Required"),
+    STATUS_LINE(429, "Too Many Requests"),
+    STATUS_LINE(431, "Request Header Fields Too Large"),
+    STATUS_LINE(500, "Internal Server Error"),
+    STATUS_LINE(501, "Not Implemented"),
+    STATUS_LINE(502, "Bad Gateway"),
+    STATUS_LINE(503, "Service Unavailable"),
+    STATUS_LINE(504, "Gateway Timeout"),
+    STATUS_LINE(505, "HTTP Version Not Supported")
+};
+
+#define STATUS_LINE_COUNT (sizeof(STATUS_LINES) / sizeof(STATUS_LINES[0]))
+
+/**
+ * @brief Position of every code in STATUS_LINES, offset by one so 0 means unknown.
+ */
+struct StatusLineIndex {
+    uint8_t slots[STATUS_CODE_MAX - STATUS_CODE_MIN + 1];
+};
+
+static constexpr StatusLineIndex makeIndex() {
+    StatusLineIndex index = {};
+
+    for (size_t i = 0; i < STATUS_LINE_COUNT; i++)
+        index.slots[STATUS_LINES[i].code - STATUS_CODE_MIN] = static_cast<uint8_t>(i + 1);
+    return index;
+}
+
+static constexpr StatusLineIndex STATUS_LINE_INDEX = makeIndex();
+
+static_assert(STATUS_LINE_COUNT < 256, "StatusLineIndex slots are one byte wide");
+
+std::string_view StatusLine::get(int code) {
+    if (code < STATUS_CODE_MIN || code > STATUS_CODE_MAX)
+        return std::string_view();
+    uint8_t slot = STATUS_LINE_INDEX.slots[code - STATUS_CODE_MIN];
+
+    if (slot == 0)
+        return std::string_view();
+    return std::string_view(STATUS_LINES[slot - 1].line, STATUS_LINES[slot - 1].length);
+}
+
+std::string_view StatusLine::reason(int code) {
+    std::string_view line = get(code);
+
+    if (line.empty())
+        return line;
+    return line.substr(STATUS_LINE_REASON_OFFSET, line.size() - STATUS_LINE_REASON_OFFSET - 2);
+}
@@ -0,0 +1,52 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   StatusLine.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/26 10:14:03 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/26 10:14:03 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef STATUSLINE_HPP
+#define STATUSLINE_HPP
+
+#define STATUS_CODE_MIN 100
+#define STATUS_CODE_MAX 599
+
+#include <string_view>
+
+/**
+ * @brief Pre-rendered HTTP/1.1 status lines of every standard status code
+ * @details The table is built at compile time, so emitting a start line is a
+ *          lookup in a direct-indexed array and the bytes are sent from static
+ *          storage: no formatting, no allocation. Responses always announce
+ *          HTTP/1.1, the highest version this server conforms to (RFC 9112 2.3).
+ */
+class StatusLine {
+    public:
+        /**
+         * @brief Gets the complete status line of a code
+         * @param code HTTP status code
+         * @return "HTTP/1.1 <code> <reason>\r\n", empty for a code without a standard reason phrase
+         */
+        static std::string_view get(int code);
+
+        /**
+         * @brief Gets the reason phrase of a code
+         * @param code HTTP status code
+         * @return Reason phrase (e.g. "Not Found"), empty for an unknown code
+         */
+        static std::string_view reason(int code);
+
+        /**
+         * @brief Tells if a code has a standard reason phrase
+         * @param code HTTP status code
+         * @return true if get() returns a status line for it
+         */
+        static bool isKnown(int code) { return !get(code).empty(); }
+};
+
+#endif
@@ -0,0 +1,144 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   StreamBody.cpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/29 10:14:06 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/29 10:14:06 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "StreamBody.hpp"
+#include "FileBody.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <sys/socket.h>
+
+StreamBody::StreamBody() : _open(false), _chunked(false), _finished(false), _buffer(), _sent(0), _compressor(), _compressed() {}
+
+StreamBody::StreamBody(const StreamBody &src) :
+    _open(src._open),
+    _chunked(src._chunked),
+    _finished(src._finished),
+    _buffer(src._buffer),
+    _sent(src._sent),
+    _compressor(src._compressor ? std::make_unique<Compressor>(*src._compressor) : nullptr),
+    _compressed()
+{
+}
+
+StreamBody &StreamBody::operator=(const StreamBody &src) {
+    if (this != &src) {
+        _open = src._open;
+        _chunked = src._chunked;
+        _finished = src._finished;
+        _buffer = src._buffer;
+        _sent = src._sent;
+        _compressor = src._compressor ? std::make_unique<Compressor>(*src._compressor) : nullptr;
+        _compressed.clear();
+    }
+    return *this;
+}
+
+StreamBody::~StreamBody() {}
+
+void StreamBody::open(bool chunked) {
+    reset();
+    _open = true;
+    _chunked = chunked;
+}
+
+bool StreamBody::compress(const std::string &encoding, int level) {
+    std::unique_ptr<Compressor> compressor = std::make_unique<Compressor>();
+
+    if (!_open || _finished || !compressor->begin(encoding, level))
+        return false;
+    _compressor = std::move(compressor);
+    return true;
+}
+
+bool StreamBody::append(std::string_view data) {
+    if (data.empty() || _finished)
+        return true;
+    if (!_compressor) {
+        frame(data);
+        return true;
+    }
+    _compressed.clear();
+    // Sync flush: zlib would otherwise sit on a slow script's output until it has a full block.
+    if (!_compressor->update(data.data(), data.size(), _compressed) || !_compressor->flush(_compressed))
+        return false;
+    frame(_compressed);
+    return true;
+}
+
+bool StreamBody::finish() {
+    if (_finished)
+        return true;
+    if (_compressor) {
+        _compressed.clear();
+        if (!_compressor->finish(_compressed))
+            return false;
+        frame(_compressed);
+    }
+    if (_chunked)
+        _buffer += "0\r\n\r\n";
+    _finished = true;
+    return true;
+}
+
+void StreamBody::abort() {
+    _compressor.reset();
+    _finished = true;
+}
+
+void StreamBody::frame(std::string_view data) {
+    if (data.empty())
+        return;
+    // Whatever was sent is dead weight in front of the new bytes.
+    if (_sent > 0) {
+        _buffer.erase(0, _sent);
+        _sent = 0;
+    }
+    if (_chunked) {
+        char    chunkHeader[FILE_BODY_CHUNK_HEADER_MAX + 1];
+        int     headerLength = snprintf(chunkHeader, sizeof(chunkHeader), "%zx\r\n", data.size());
+
+        _buffer.append(chunkHeader, headerLength);
+    }
+    _buffer.append(data.data(), data.size());
+    if (_chunked)
+        _buffer += "\r\n";
+}
+
+ssize_t StreamBody::sendTo(int socketFd) {
+    ssize_t total = 0;
+
+    while (_sent < _buffer.size()) {
+        ssize_t sent = send(socketFd, _buffer.data() + _sent, _buffer.size() - _sent, MSG_NOSIGNAL);
+        if (sent == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            return -1;
+        }
+        _sent += sent;
+        total += sent;
+    }
+    if (_sent == _buffer.size()) {
+        _buffer.clear();
+        _sent = 0;
+    }
+    return total;
+}
+
+void StreamBody::reset() {
+    _open = false;
+    _chunked = false;
+    _finished = false;
+    _buffer.clear();
+    _sent = 0;
+    _compressor.reset();
+    _compressed.clear();
+}
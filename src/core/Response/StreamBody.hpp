@@ -0,0 +1,116 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   StreamBody.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/29 10:14:06 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/29 10:14:06 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef STREAMBODY_HPP
+#define STREAMBODY_HPP
+
+#define STREAM_BODY_HIGH_WATER 65536 // Pending bytes above which the producer stops feeding
+
+#include "Compressor.hpp"
+#include <memory>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+
+/**
+ * @brief Response payload produced while it is being sent, e.g. a CGI script's output
+ * @details Holds the wire bytes not yet accepted by the socket. Each piece handed to
+ *          append() becomes one chunk of Transfer-Encoding: chunked, or is passed as is
+ *          when the connection end delimits the body (HTTP/1.0). The producer checks
+ *          getPending() and stops feeding while the client lags behind, so memory per
+ *          connection stays bounded by what it feeds in one go.
+ */
+class StreamBody {
+    public:
+        StreamBody();
+
+        /**
+         * @brief Copy constructor
+         * @param src The StreamBody to copy from
+         * @note Duplicates the zlib state, both copies continue the same payload independently
+         */
+        StreamBody(const StreamBody &src);
+        StreamBody &operator=(const StreamBody &src);
+        ~StreamBody();
+
+        /**
+         * @brief Starts an empty payload
+         * @param chunked Frame every piece as a chunk and end with the last-chunk
+         * @return None
+         */
+        void open(bool chunked);
+
+        /**
+         * @brief Compresses the payload while it is streamed
+         * @param encoding Content coding to produce: "gzip" or "deflate"
+         * @param level zlib level
+         * @return false, leaving the payload as is, if the coding cannot be produced
+         * @note Call right after open(). Every piece is flushed, so the client sees it at once
+         */
+        bool compress(const std::string &encoding, int level);
+
+        /**
+         * @brief Adds the next piece of the payload
+         * @param data Payload bytes; an empty piece adds nothing
+         * @return false on a zlib error
+         */
+        bool append(std::string_view data);
+
+        /**
+         * @brief Ends the payload: compressor trailer and last-chunk
+         * @return false on a zlib error
+         */
+        bool finish();
+
+        /**
+         * @brief Ends the payload without its terminator, so the client can tell it is truncated
+         * @return None
+         * @note The connection has to be closed once the pending bytes are out
+         */
+        void abort();
+
+        /**
+         * @brief Sends as much of the pending bytes as the socket accepts
+         * @param socketFd Non-blocking socket to write to
+         * @return Number of bytes sent (0 if the socket is full), -1 on error
+         */
+        ssize_t sendTo(int socketFd);
+
+        /**
+         * @brief Drops the payload and the compressor
+         * @return None
+         */
+        void reset();
+
+        bool isOpen() const { return _open; }
+        bool isFinished() const { return _finished; }
+        bool isDone() const { return _finished && _sent == _buffer.size(); }
+        size_t getPending() const { return _buffer.size() - _sent; }
+
+    private:
+        /**
+         * @brief Appends bytes to the wire buffer, as one chunk when chunked
+         * @param data Bytes as they go on the wire, compressed or not
+         * @return None
+         */
+        void frame(std::string_view data);
+
+        bool _open; // open() was called since the last reset()
+        bool _chunked; // Each piece is a chunk, the payload ends with the last-chunk
+        bool _finished; // Nothing is appended anymore
+        std::string _buffer; // Wire bytes, the first _sent of them already written to the socket
+        size_t _sent; // Bytes of _buffer already written
+        std::unique_ptr<Compressor> _compressor; // Set when the payload is compressed on the way out
+        std::string _compressed; // Output of the compressor for the current piece
+};
+
+#endif
@@ -12,10 +12,13 @@
 
 #include "Server.hpp"
 
-Server::Server(int socketFd, std::vector<const vServer*>& vServers) : _servConfigs(vServers){
+Server::Server(int socketFd, const std::vector<const vServer*>& vServers, std::shared_ptr<const ConfigSnapshot> config) :
+	_servConfigs(vServers), _config(std::move(config)) {
 	this->_socketFd = socketFd;
 	std::cout << _servConfigs.at(0)->getServerRoot()<< "\n";
-
+	for (const vServer* config : _servConfigs) {
+		_virtualHosts.add(config);
+	}
 }
 
 
@@ -37,3 +40,27 @@ int	Server::getSocketFd(void) const {
 const std::vector<const vServer*>& Server::getServConfigs( void ) const {
 	return(_servConfigs);
 }
+
+
+
+
+
+const VirtualHostIndex& Server::getVirtualHosts( void ) const {
+	return(_virtualHosts);
+}
+
+
+
+
+
+const std::shared_ptr<const ConfigSnapshot>& Server::getConfig( void ) const {
+	return(_config);
+}
+
+
+
+
+
+const std::string& Server::getListenAddress( void ) const {
+	return(_servConfigs.at(0)->getServerIpPort());
+}
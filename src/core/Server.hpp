@@ -37,27 +37,36 @@
 #include <cerrno>
 #include <bits/stdc++.h>
 #include "parsingConfFile/ParseConfig.hpp"
+#include "VirtualHost/VirtualHostIndex.hpp"
 
 
 
 
+class ConfigSnapshot;
+
 /**
  * @class Server
  * @brief Represents a server socket and its associated virtual server configurations.
+ * @details Immutable: a configuration reload builds a new Server for every socket,
+ *          reusing the fd of those that kept their address. Connections hold the
+ *          Server they were accepted by, and with it the configuration they serve.
  */
 class Server
 {
 	private:
 		int _socketFd;   ///< File descriptor of the server socket
 		std::vector<const vServer*> _servConfigs; ///< Configurations for the virtual servers hosted on this socket
+		VirtualHostIndex _virtualHosts; ///< server_name lookup over _servConfigs
+		std::shared_ptr<const ConfigSnapshot> _config; ///< Owner of the vServers, kept alive as long as this Server
 
 	public:
 		/**
 		 * @brief Construct a new Server object
 		 * @param socketFd File descriptor of the server socket
 		 * @param vServers Vector of virtual server configurations
+		 * @param config Configuration the virtual servers belong to
 		 */
-		Server(int socketFd, std::vector<const vServer*>& vServers);
+		Server(int socketFd, const std::vector<const vServer*>& vServers, std::shared_ptr<const ConfigSnapshot> config);
 
 		/**
 		 * @brief Destroy the Server object, closing resources if necessary
@@ -75,6 +84,24 @@ class Server
 		 * @return const std::vector<const vServer*>& Reference to server configuration vector
 		 */
 		const std::vector<const vServer*>& getServConfigs(void) const;
+
+		/**
+		 * @brief Get the server_name index of the virtual servers on this socket
+		 * @return const VirtualHostIndex& Index built at construction
+		 */
+		const VirtualHostIndex& getVirtualHosts(void) const;
+
+		/**
+		 * @brief Get the configuration this socket serves
+		 * @return const std::shared_ptr<const ConfigSnapshot>& Snapshot the virtual servers belong to
+		 */
+		const std::shared_ptr<const ConfigSnapshot>& getConfig(void) const;
+
+		/**
+		 * @brief Get the address this socket listens on
+		 * @return const std::string& "ip:port" shared by all its virtual servers
+		 */
+		const std::string& getListenAddress(void) const;
 };
 
 #endif
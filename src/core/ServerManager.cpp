@@ -14,12 +14,17 @@
 
 
 #include "ServerManager.hpp"
+#include "parsingConfFile/ConfigSnapshot.hpp"
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
 
 
 
 
 
-ServerManager::ServerManager(char* fileName, int epollSize) {
+ServerManager::ServerManager(char* fileName, int epollSize) : _workerId(MASTER_WORKER_ID), _workerThreads(1),
+	_fileCacheSize(FILE_CACHE_DEFAULT_SIZE), _fileCacheMaxFileSize(FILE_CACHE_DEFAULT_MAX_FILE), _signalFd(-1), _reloadFd(-1),
+	_fastCgiUpstreams(*this) {
 	std::string	fileNameStr;
 
 
@@ -35,6 +40,7 @@ ServerManager::ServerManager(char* fileName, int epollSize) {
 	if (std::filesystem::path(fileNameStr).extension() != ".conf")
 		throw ServerManagerException("Invalid file name: use .conf extention");
 
+	_configPath = fileNameStr;
 	_configFileFd.open(fileNameStr);
 	if (!_configFileFd) {
 		throw ServerManagerException("Failed to open config file: " + fileNameStr);
@@ -51,6 +57,38 @@ ServerManager::ServerManager(char* fileName, int epollSize) {
 
 
 
+ServerManager::ServerManager(const ServerManager& master, size_t workerId) : _workerId(workerId),
+	_workerThreads(master._workerThreads), _fileCacheSize(master._fileCacheSize),
+	_fileCacheMaxFileSize(master._fileCacheMaxFileSize), _config(master._config), _signalFd(-1), _reloadFd(-1),
+	_fastCgiUpstreams(*this) {
+
+	_epollFd = epoll_create(EPOLL_CAPACITY);
+	if (_epollFd == -1) {
+		throw ServerManagerException("Failed to create an epoll instance.");
+	}
+	// Created before the thread starts, so the master can post a configuration at any time.
+	_reloadFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (_reloadFd == -1) {
+		close(_epollFd);
+		throw ServerManagerException("Failed to create a reload eventfd.");
+	}
+}
+
+
+
+
+EventSlot::EventSlot(int slotFd) : type(SLOT_FREE), fd(slotFd), server(nullptr), client(nullptr), owner(nullptr), backend(nullptr), generation(0) {
+}
+
+
+
+
+EventSlot::~EventSlot() {
+}
+
+
+
+
 ServerManager::ServerManagerException::ServerManagerException(const std::string& msg) : _message(msg) {
 
 }
@@ -63,6 +101,17 @@ ServerManager::~ServerManager() {
 	if (_configFileFd.is_open()) {
 		_configFileFd.close();
 	}
+	for (int fd : {_signalFd, _reloadFd}) {
+		if (fd != -1) {
+			close(fd);
+		}
+	}
+	// Clients first: a request still on a FastCGI connection aborts it while the connection exists.
+	for (std::unique_ptr<EventSlot>& slot : _eventSlots) {
+		if (slot) {
+			slot->client.reset();
+		}
+	}
 	close(_epollFd);
 }
 
@@ -80,26 +129,35 @@ int	ServerManager::getEpollFd( void ) const {
 }
 
 
-std::vector<vServer>&		ServerManager::getVirtualServers( void ) {
-	return (_vServers);
+const ConfigSnapshot&	ServerManager::getConfig( void ) const {
+	return (*_config);
 }
 
 
-std::vector<Server>&	ServerManager::getServers(void) {
+const std::vector<std::shared_ptr<const Server>>&	ServerManager::getServers(void) const {
 	return (_servers);
 }
 
 
+bool	ServerManager::isRetired(const Server& listener) const {
+	return (listener.getConfig() != _config);
+}
+
+
+size_t	ServerManager::getWorkerThreads(void) const {
+	return (_workerThreads);
+}
 
 
-void	ServerManager::parsConfigFile(std::vector<vServer>& _vServers) {
-	ParseConfig									parser;
-	std::map<size_t, std::vector<std::string>>	roughData;
 
+
+void	ServerManager::parsConfigFile(void) {
 	try{
-		roughData = parser.collectLexemesByLine(getConfigFileFd());
-		parser.lexemesToTokens(roughData);
-		parser.parseServerBlocks(_vServers);
+		_config = ConfigSnapshot::load(getConfigFileFd());
+		_workerThreads = _config->getWorkerThreads();
+		_fileCacheSize = _config->getFileCacheSize();
+		_fileCacheMaxFileSize = _config->getFileCacheMaxFileSize();
+		std::cout << "Grouped servers by host and port." << "\n";
 
 	}catch(ParseConfig::ConfException& ex){
 		std::cerr << "ConfigParser::Error: " << ex.what()<< "\n";
@@ -116,27 +174,42 @@ const char*	ServerManager::ServerManagerException::what() const noexcept {
 
 
 
-void	ServerManager::groupServers(const std::vector<vServer>& _vServers) {
-	for (const vServer& vServer : _vServers) {
-		const std::string& hostPort = vServer.getServerIpPort();
-		_hostVserverMap[hostPort].push_back(&vServer);
-	}
-	std::cout << "Grouped servers by host and port." << "\n";
+void	ServerManager::setServers() {
+	_servers = buildServers(_config);
 }
 
 
 
 
-void	ServerManager::setServers() {
-	std::map<std::string, std::vector<const vServer*>>::iterator	it = _hostVserverMap.begin();
+std::vector<std::shared_ptr<const Server>>	ServerManager::buildServers(const std::shared_ptr<const ConfigSnapshot>& config) {
+	std::vector<std::shared_ptr<const Server>>	servers;
+	std::vector<int>							opened;
 
-	for (;it != _hostVserverMap.end(); it++) {
+	try {
+		for (const auto& listener : config->getListeners()) {
+			int	socketFd = -1;
 
-		const std::string& host = it->second.at(0)->getServerIp();
-		const std::string& port = it->second.at(0)->getServerPort();
-		int	socketFd = getSocketFd(host, port);
-		_servers.emplace_back(socketFd, it->second);
+			for (const std::shared_ptr<const Server>& current : _servers) {
+				if (current->getListenAddress() == listener.first) {
+					socketFd = current->getSocketFd();
+				}
+			}
+			if (socketFd == -1) {
+				const std::string& host = listener.second.at(0)->getServerIp();
+				const std::string& port = listener.second.at(0)->getServerPort();
+				socketFd = getSocketFd(host, port);
+				opened.push_back(socketFd);
+			}
+			servers.push_back(std::make_shared<const Server>(socketFd, listener.second, config));
+		}
+	}
+	catch (ServerManager::ServerManagerException&) {
+		for (int fd : opened) {
+			close(fd);
+		}
+		throw;
 	}
+	return (servers);
 }
 
 
@@ -179,13 +252,6 @@ addrinfo* ServerManager::getAddrList(const std::string& currHost, const std::str
 
 
 
-std::map<int, Client>&	ServerManager::getFdClientMap(void) {
-	return (_fdClientMap);
-}
-
-
-
-
 int	ServerManager::bindSocket(addrinfo* addrList) {
 
 	addrinfo*	cpList;
@@ -202,6 +268,11 @@ int	ServerManager::bindSocket(addrinfo* addrList) {
 			int err = errno;
 			throw ServerManagerException("setsockopt(): " + std::string(strerror(err)));
 		}
+		// Every reactor binds its own copy of the listener; the kernel balances accepts between them.
+		if (_workerThreads > 1 && setsockopt(socketFd, SOL_SOCKET, SO_REUSEPORT, &_switch, sizeof(_switch)) == -1){
+			int err = errno;
+			throw ServerManagerException("setsockopt(SO_REUSEPORT): " + std::string(strerror(err)));
+		}
 		if (bind(socketFd, cpList->ai_addr, cpList->ai_addrlen) == 0) {
 			std::cout<< "Successfully binded" << "\n";
 			break;
@@ -238,10 +309,45 @@ void	ServerManager::setNonBlocking(int fd) {
 
 
 
+EventSlot&	ServerManager::getEventSlot(int fd) {
+	if (static_cast<size_t>(fd) >= _eventSlots.size()) {
+		_eventSlots.resize(fd + 1);
+	}
+	if (!_eventSlots[fd]) {
+		_eventSlots[fd] = std::make_unique<EventSlot>(fd);
+	}
+	return (*_eventSlots[fd]);
+}
+
+
+
+
+void	ServerManager::releaseEventSlot(int fd) {
+	if (fd < 0 || static_cast<size_t>(fd) >= _eventSlots.size() || !_eventSlots[fd]) {
+		return;
+	}
+	EventSlot&	slot = *_eventSlots[fd];
+
+	slot.type = SLOT_FREE;
+	slot.server = nullptr;
+	slot.owner = nullptr;
+	slot.backend = nullptr;
+	slot.client.reset();
+}
+
+
+
+
 void	ServerManager::setEpollCtl( int targetFd, int eventFlag, int operation){
 	struct epoll_event	targetEvent;
 
-	targetEvent.data.fd = targetFd;
+	EventSlot&			slot = getEventSlot(targetFd);
+
+	// A new registration is a new use of the fd number: events still queued for the last one go stale.
+	if (operation == EPOLL_CTL_ADD) {
+		slot.generation++;
+	}
+	targetEvent.data.u64 = (static_cast<uint64_t>(slot.generation) << 32) | static_cast<uint32_t>(targetFd);
 	targetEvent.events = eventFlag;
 	if (epoll_ctl(_epollFd, operation, targetFd, &targetEvent) == -1) {
 		close(targetFd);
@@ -254,76 +360,430 @@ void	ServerManager::setEpollCtl( int targetFd, int eventFlag, int operation){
 void	ServerManager::setSocketsToEpollIn(void) {
 	for (size_t i = 0; i < _servers.size(); i++)
 	{
-		setEpollCtl(_servers[i].getSocketFd(), EPOLLIN, EPOLL_CTL_ADD);
-		std::cout << "Set listening socket fd: " << _servers[i].getSocketFd() << " to EPOLLIN event." << "\n";
+		EventSlot&	slot = getEventSlot(_servers[i]->getSocketFd());
+
+		slot.type = SLOT_LISTENER;
+		slot.server = _servers[i];
+		setEpollCtl(_servers[i]->getSocketFd(), EPOLLIN, EPOLL_CTL_ADD);
+		std::cout << "Set listening socket fd: " << _servers[i]->getSocketFd() << " to EPOLLIN event." << "\n";
+	}
+}
+
+
+
+
+void	ServerManager::setFileCacheToEpollIn(void) {
+	if (!_fileCache.enable(_fileCacheSize, _fileCacheMaxFileSize)) {
+		std::cerr << "inotify_init1(): " << strerror(errno) << ", file cache disabled." << "\n";
+		return;
+	}
+	if (!_fileCache.isEnabled()) {
+		return;
+	}
+	getEventSlot(_fileCache.getInotifyFd()).type = SLOT_FILE_CACHE;
+	setEpollCtl(_fileCache.getInotifyFd(), EPOLLIN, EPOLL_CTL_ADD);
+}
+
+
+
+
+void	ServerManager::setReloadSignalToEpollIn(void) {
+	sigset_t	mask;
+
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGHUP);
+	if (pthread_sigmask(SIG_BLOCK, &mask, nullptr) != 0) {
+		std::cerr << "pthread_sigmask(): cannot block SIGHUP, configuration reload disabled." << "\n";
+		return;
+	}
+	_signalFd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (_signalFd == -1) {
+		std::cerr << "signalfd(): " << strerror(errno) << ", configuration reload disabled." << "\n";
+		return;
+	}
+	getEventSlot(_signalFd).type = SLOT_SIGNAL;
+	setEpollCtl(_signalFd, EPOLLIN, EPOLL_CTL_ADD);
+}
+
+
+
+
+void	ServerManager::handleSignalEvent(void) {
+	struct signalfd_siginfo	info;
+	bool					reload = false;
+
+	while (read(_signalFd, &info, sizeof(info)) == sizeof(info)) {
+		reload = reload || info.ssi_signo == SIGHUP;
+	}
+	// Signals arriving while the file is parsed coalesce into the next reload.
+	if (reload) {
+		reloadConfig();
+	}
+}
+
+
+
+
+void	ServerManager::reloadConfig(void) {
+	std::ifstream							file(_configPath);
+	std::shared_ptr<const ConfigSnapshot>	config;
+
+	std::cout << "SIGHUP received, reloading " << _configPath << "\n";
+	try {
+		if (!file) {
+			throw ServerManagerException("cannot open " + _configPath);
+		}
+		config = ConfigSnapshot::load(file);
+		applyConfig(config);
+	}
+	catch (ParseConfig::ConfException& ex) {
+		std::cerr << "ConfigParser::Error: " << ex.what() << ", keeping the current configuration." << "\n";
+		return;
+	}
+	catch (ServerManager::ServerManagerException& ex) {
+		std::cerr << "ServerManager::Error: " << ex.what() << ", keeping the current configuration." << "\n";
+		return;
+	}
+	catch (std::exception& ex) {
+		std::cerr << "ConfigParser::Error: " << ex.what() << ", keeping the current configuration." << "\n";
+		return;
+	}
+	if (config->getWorkerThreads() != _workerThreads || config->getFileCacheSize() != _fileCacheSize
+		|| config->getFileCacheMaxFileSize() != _fileCacheMaxFileSize) {
+		std::cerr << "worker_threads and file cache sizes only change on restart." << "\n";
+	}
+	for (std::unique_ptr<ServerManager>& worker : _workers) {
+		worker->postConfig(config);
+	}
+	std::cout << "Configuration reloaded." << "\n";
+}
+
+
+
+
+void	ServerManager::postConfig(const std::shared_ptr<const ConfigSnapshot>& config) {
+	uint64_t	one = 1;
+
+	{
+		std::lock_guard<std::mutex>	lock(_reloadMutex);
+
+		_pendingConfig = config;
+	}
+	if (write(_reloadFd, &one, sizeof(one)) == -1 && errno != EAGAIN) {
+		std::cerr << "Reload notification to event loop " << _workerId << " failed: " << strerror(errno) << "\n";
+	}
+}
+
+
+
+
+void	ServerManager::handleReloadEvent(void) {
+	std::shared_ptr<const ConfigSnapshot>	config;
+	uint64_t								count;
+
+	while (read(_reloadFd, &count, sizeof(count)) == sizeof(count)) {
+	}
+	{
+		std::lock_guard<std::mutex>	lock(_reloadMutex);
+
+		config.swap(_pendingConfig);
+	}
+	if (!config || config == _config) {
+		return;
+	}
+	try {
+		applyConfig(config);
+	}
+	catch (ServerManager::ServerManagerException& ex) {
+		std::cerr << "ServerManager::Error (worker " << _workerId << "): " << ex.what() << ", keeping the current configuration." << "\n";
+	}
+}
+
+
+
+
+void	ServerManager::applyConfig(const std::shared_ptr<const ConfigSnapshot>& config) {
+	std::vector<std::shared_ptr<const Server>>	servers = buildServers(config);
+
+	for (const std::shared_ptr<const Server>& current : _servers) {
+		bool	kept = false;
+
+		for (const std::shared_ptr<const Server>& server : servers) {
+			kept = kept || server->getSocketFd() == current->getSocketFd();
+		}
+		if (!kept) {
+			drainListener(current);
+		}
+	}
+	_config = config;
+	_servers.swap(servers);
+	for (const std::shared_ptr<const Server>& server : _servers) {
+		EventSlot&	slot = getEventSlot(server->getSocketFd());
+
+		if (slot.type != SLOT_LISTENER) {
+			slot.type = SLOT_LISTENER;
+			setEpollCtl(server->getSocketFd(), EPOLLIN, EPOLL_CTL_ADD);
+		}
+		slot.server = server;
+	}
+	configureCgiPools();
+}
+
+
+
+
+void	ServerManager::configureCgiPools(void) {
+	std::unordered_map<std::string, CgiPoolConfig>	limits;
+
+	for (const vServer& server : _config->getVirtualServers()) {
+		for (const auto& location : server.getServerLocations()) {
+			const CgiPoolConfig&	pool = location.second.getLocationCgiPool();
+
+			if (!pool.enabled) {
+				continue;
+			}
+			for (const auto& cgi : location.second.getLocationAllowedCgi()) {
+				std::string	interpreter = CGIHandler::interpreterFor(cgi.first);
+
+				if (!interpreter.empty()) {
+					CgiPoolSet::merge(limits[interpreter], pool);
+				}
+			}
+		}
 	}
+	_cgiPools.configure(limits);
+}
+
+
+
+
+void	ServerManager::drainListener(const std::shared_ptr<const Server>& listener) {
+	int	listenFd = listener->getSocketFd();
+
+	epoll_ctl(_epollFd, EPOLL_CTL_DEL, listenFd, nullptr);
+	while (true) {
+		int	clientFd = accept(listenFd, nullptr, nullptr);
+
+		if (clientFd == -1) {
+			if (errno == EINTR || errno == ECONNABORTED) {
+				continue;
+			}
+			break;
+		}
+		addClientSlot(clientFd, listener);
+	}
+	close(listenFd);
+	releaseEventSlot(listenFd);
+	std::cout << "Closed listening socket " << listener->getListenAddress() << " (fd " << listenFd << ")." << "\n";
 }
 
 
 
 
 void	ServerManager::closeClientFd(int clientFd){
+	EventSlot&	slot = getEventSlot(clientFd);
 
+	if (slot.client) {
+		closeCgiPipes(slot.client.get());
+	}
 	epoll_ctl(_epollFd, EPOLL_CTL_DEL, clientFd, nullptr);
 	close(clientFd);
-	_fdClientMap.erase(clientFd);
+	releaseEventSlot(clientFd);
+}
+
+
+
+
+void	ServerManager::closeCgiPipes(Client* client) {
+	CGIHandler*	cgiHandler = client->getCgiHandler();
+
+	if (!cgiHandler) {
+		return;
+	}
+	for (int pipeFd : {cgiHandler->getStdinFd(), cgiHandler->getStdoutFd(), cgiHandler->getStderrFd(), cgiHandler->getPidFd()}) {
+		if (pipeFd < 0) {
+			continue;
+		}
+		EventSlot&	pipeSlot = getEventSlot(pipeFd);
+		if (pipeSlot.type == SLOT_CGI_PIPE && pipeSlot.owner == client) {
+			closeCgiFd(pipeFd);
+			cgiHandler->releaseFd(pipeFd);
+		}
+	}
 }
 
 
 
 
-bool	ServerManager::isListeningSocket(int fd) {
-	for(const Server& server : _servers) {
-		if (server.getSocketFd() == fd) {
-			return (true);
+void	ServerManager::pauseCgiOutput(Client* client, bool paused) {
+	CGIHandler*	cgiHandler = client->getCgiHandler();
+	int			pipeFd = cgiHandler ? cgiHandler->getStdoutFd() : -1;
+
+	if (pipeFd < 0) {
+		FastCgiConnection*	backend = cgiHandler ? cgiHandler->getBackend() : nullptr;
+
+		// Other requests on a multiplexed connection would stall with it.
+		if (backend && (!paused || backend->getLoad() == 1)) {
+			backend->pause(paused);
 		}
+		return;
+	}
+	EventSlot&	pipeSlot = getEventSlot(pipeFd);
+	if (pipeSlot.type == SLOT_CGI_PIPE && pipeSlot.owner == client) {
+		setEpollCtl(pipeFd, paused ? 0u : static_cast<uint32_t>(EPOLLIN), EPOLL_CTL_MOD);
 	}
-	return (false);
 }
 
 
 
 
-bool	ServerManager::isClientSocket(int fd) {
-	std::map<int, Client>::iterator it = _fdClientMap.begin();
+void	ServerManager::closeCgiFd(int cgiFd) {
+	epoll_ctl(_epollFd, EPOLL_CTL_DEL, cgiFd, nullptr);
+	close(cgiFd);
+	releaseEventSlot(cgiFd);
+}
+
+
+
+
+std::vector<std::thread>	ServerManager::startWorkers(void) {
+	std::vector<std::thread>	threads;
+
+	for (size_t id = 1; id < _workerThreads; id++) {
+		_workers.push_back(std::unique_ptr<ServerManager>(new ServerManager(*this, id)));
+		_workers.back()->setServers();
+	}
+	for (std::unique_ptr<ServerManager>& worker : _workers) {
+		threads.emplace_back(&ServerManager::runWorker, worker.get());
+	}
+	std::cout << "Started " << _workerThreads << " event loops." << "\n";
+	return (threads);
+}
+
+
 
-	for (;it != _fdClientMap.end(); it++) {
 
-		if (it->first == fd)
-			return (true);
+void	ServerManager::runWorker(void) {
+	try {
+		eventLoop();
 	}
-	return (false);
+	catch (ServerManager::ServerManagerException& ex) {
+		std::cerr << "ServerManager::Error (worker " << _workerId << "): " << ex.what() << "\n";
+	}
+	closeAllSockets();
 }
 
 
 
 
 void	ServerManager::runServers(void) {
+	std::vector<std::thread>	threads;
+
+	setReloadSignalToEpollIn();
+	if (_workerThreads > 1) {
+		threads = startWorkers();
+	}
+	try {
+		eventLoop();
+	}
+	catch (ServerManager::ServerManagerException& ex) {
+		running = 0;
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+		throw;
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+}
+
+
+
+
+void	ServerManager::eventLoop(void) {
 	struct epoll_event	epollEvents[EPOLL_CAPACITY];
 
 	std::cout << "Running servers..." << "\n";
 	setSocketsToEpollIn();
+	setFileCacheToEpollIn();
+	configureCgiPools();
+	if (_reloadFd != -1) {
+		getEventSlot(_reloadFd).type = SLOT_RELOAD;
+		setEpollCtl(_reloadFd, EPOLLIN, EPOLL_CTL_ADD);
+	}
 	while (running) {
-		int timeout = 1000;
+		int timeout = _timerWheel.nextTimeoutMs(EPOLL_MAX_WAIT_MS);
 		int readyFds = epoll_wait(_epollFd, epollEvents, EPOLL_CAPACITY, timeout);
 		if (readyFds == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
 			int err = errno;
 			throw ServerManagerException("epoll_wait(): " + std::string(strerror(err)));
 		}
+		_dateCache.refresh(std::time(nullptr));
 		for (int i = 0; i < readyFds; i++) {
 			manageEpollEvent(epollEvents[i]);
 		}
+		expireTimers();
+	}
+	if (_fileCache.isEnabled()) {
+		const FileCacheStats&	stats = _fileCache.getStats();
+
+		std::cout << "File cache (event loop " << _workerId << "): " << stats.hits << " hits, " << stats.misses
+			<< " misses, " << stats.evictions << " evictions, " << stats.invalidations << " invalidations, "
+			<< stats.entries << " entries, " << stats.bytes << " bytes." << "\n";
+	}
+}
+
+
+
+
+void	ServerManager::expireTimers(void) {
+	_timerWheel.advance();
+	while (TimerNode* timer = _timerWheel.popExpired()) {
+		handleTimerExpiry(*timer);
 	}
 }
 
 
 
 
-void	ServerManager::manageListenSocketEvent(const struct epoll_event& currEvent) {
+void	ServerManager::handleTimerExpiry(TimerNode& timer) {
+	EventSlot&	slot = getEventSlot(timer.fd);
+
+	if (slot.type != SLOT_CLIENT) {
+		return;
+	}
+	switch (timer.type) {
+		case TIMER_CGI:
+			slot.client->handleCgiTimeout(slot.fd);
+		break;
+
+		case TIMER_CGI_EXIT:
+			slot.client->pollCgiExit(slot.fd);
+		break;
+
+		case TIMER_KEEPALIVE:
+			closeClientFd(slot.fd);
+		break;
+
+		default:
+			std::cerr << "Client fd " << slot.fd << " timed out, closing connection." << std::endl;
+			closeClientFd(slot.fd);
+		break;
+	}
+}
+
+
+
+
+void	ServerManager::manageListenSocketEvent(const EventSlot& slot) {
 	struct sockaddr_storage	clientAddr;
 	socklen_t				clientAddrLen = sizeof(clientAddr);
 
-	int acceptedSocket = accept(currEvent.data.fd, (struct sockaddr *)&clientAddr, &clientAddrLen);
+	int acceptedSocket = accept(slot.fd, (struct sockaddr *)&clientAddr, &clientAddrLen);
 	if (acceptedSocket == -1) {
 
 		if (errno == EAGAIN || errno == EWOULDBLOCK) {
@@ -332,121 +792,205 @@ void	ServerManager::manageListenSocketEvent(const struct epoll_event& currEvent)
 		}
 		throw ServerManagerException("Failed to accept the client socket");
 	}
-	addClientToMap(acceptedSocket, currEvent.data.fd);
+	addClientSlot(acceptedSocket, slot.server);
 }
 
 
 
 
-void ServerManager::addClientToMap(int clientFd, int serverFd) {
+void ServerManager::addClientSlot(int clientFd, const std::shared_ptr<const Server>& listener) {
+	EventSlot&	slot = getEventSlot(clientFd);
+
 	setNonBlocking(clientFd);
+	slot.type = SLOT_CLIENT;
+	slot.client = std::make_unique<Client>(listener, this);
+	slot.client->armTimer(TIMER_HEADER, clientFd);
 	setEpollCtl(clientFd, EPOLLIN, EPOLL_CTL_ADD);
-	_fdClientMap.emplace(clientFd, Client(serverFd, this));
 }
 
 
 
 
-void ServerManager::addCgiFdToMap(int cgiFd, int clientFd) {
-	auto it = _fdClientMap.find(clientFd);
+void ServerManager::addCgiFdSlot(int cgiFd, int clientFd, int events) {
+	EventSlot&	clientSlot = getEventSlot(clientFd);
 
-	if (it == _fdClientMap.end()) {
-		std::cerr << "Error: Client fd not found in map." << std::endl;
+	if (clientSlot.type != SLOT_CLIENT) {
+		std::cerr << "Error: Client fd not found in connection table." << std::endl;
 		return;
 	}
-	Client* clientPtr = &it->second; 
+	EventSlot&	slot = getEventSlot(cgiFd);
+
 	setNonBlocking(cgiFd);
-	setEpollCtl(cgiFd, EPOLLIN, EPOLL_CTL_ADD);
-	_cgiFdClientPtrMap.emplace(cgiFd, clientPtr);
+	slot.type = SLOT_CGI_PIPE;
+	slot.owner = clientSlot.client.get();
+	setEpollCtl(cgiFd, events, EPOLL_CTL_ADD);
+}
+
+
+
+
+void ServerManager::addFastCgiSlot(int fd, FastCgiConnection* connection) {
+	EventSlot&	slot = getEventSlot(fd);
+
+	slot.type = SLOT_FASTCGI;
+	slot.backend = connection;
+	setEpollCtl(fd, EPOLLIN | EPOLLOUT, EPOLL_CTL_ADD);
+}
+
+
+
+
+void ServerManager::watchFastCgiFd(int fd, bool readable, bool writable) {
+	setEpollCtl(fd, (readable ? static_cast<int>(EPOLLIN) : 0) | (writable ? static_cast<int>(EPOLLOUT) : 0), EPOLL_CTL_MOD);
+}
+
+
+
+
+void ServerManager::closeFastCgiFd(int fd) {
+	epoll_ctl(_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+	close(fd);
+	releaseEventSlot(fd);
 }
 
 
 
 
 void	ServerManager::manageEpollEvent(const struct epoll_event& currEvent) {
-	int	fd = currEvent.data.fd;
-
-	if (isListeningSocket(fd)) {
-		manageListenSocketEvent(currEvent);
-	}
-	else if ((currEvent.events & EPOLLIN) && isClientSocket(fd)) {
-		_fdClientMap.at(fd).handleRequest(fd);
-	}
-	else if ((currEvent.events & EPOLLOUT) && isClientSocket(fd)) {
-		_fdClientMap.at(fd).handleResponse(fd);
-	}
-	else if (_cgiFdClientPtrMap.find(fd) != _cgiFdClientPtrMap.end()) {
-		Client* clientPtr = _cgiFdClientPtrMap[fd];
-		CGIHandler* cgiHandler = clientPtr->getResponse().getCgiHandler();
-		int stderr_fd = cgiHandler->getStderrFd();
-		int stdout_fd = cgiHandler->getStdoutFd();
-		if (fd == stdout_fd || fd == stderr_fd) {
-			cgiHandler->handleEvent(fd);
-
-			// If both stdout and stderr are done, and the process is done, clean up
-			if (cgiHandler->isDone()) {
-				clientPtr->getResponse().generateCGIResponse();
-				std::string cgiResponse = clientPtr->getResponse().getRawResponse();
-				int clientFd = clientPtr->getResponse().getClientFd();
-				setEpollCtl(clientFd, EPOLLOUT, EPOLL_CTL_MOD);
-				clientPtr->sendResponse(cgiResponse, clientFd);
-				// Remove from epoll and tracking map before closing
-				setEpollCtl(stdout_fd, EPOLLIN, EPOLL_CTL_DEL);
-				setEpollCtl(stderr_fd, EPOLLIN, EPOLL_CTL_DEL);
-				_cgiFdClientPtrMap.erase(stderr_fd);
-				_cgiFdClientPtrMap.erase(stdout_fd);
-
-				// Only close if not already closed
-				if (stdout_fd >= 0) close(stdout_fd);
-				if (stderr_fd >= 0) close(stderr_fd);
-			}
-		} else {
-			std::cerr << "Error: CGI handler is null." << std::endl;
-			setEpollCtl(fd, EPOLLIN, EPOLL_CTL_DEL);
-			_cgiFdClientPtrMap.erase(stderr_fd);
-			_cgiFdClientPtrMap.erase(stdout_fd);
-			close(fd);
-		}
+	size_t		fd = static_cast<uint32_t>(currEvent.data.u64);
+	uint32_t	generation = static_cast<uint32_t>(currEvent.data.u64 >> 32);
+
+	// Closed earlier in this batch, and maybe already reused by an accept() or a pipe.
+	if (fd >= _eventSlots.size() || !_eventSlots[fd] || _eventSlots[fd]->generation != generation) {
+		return;
 	}
-}
+	EventSlot&	slot = *_eventSlots[fd];
 
+	switch (slot.type) {
+		case SLOT_LISTENER:
+			manageListenSocketEvent(slot);
+		break;
 
+		case SLOT_CLIENT:
+			manageClientEvent(slot, currEvent.events);
+		break;
 
+		case SLOT_CGI_PIPE:
+			manageCgiPipeEvent(slot);
+		break;
 
+		case SLOT_FASTCGI:
+			manageFastCgiEvent(slot, currEvent.events);
+		break;
 
-const std::vector<const vServer*> ServerManager::findServerConfigsByFd(int fd) const{
+		case SLOT_FILE_CACHE:
+			_fileCache.handleEvents();
+		break;
 
-	for( const Server& server : _servers) {
+		case SLOT_SIGNAL:
+			handleSignalEvent();
+		break;
 
-		if (server.getSocketFd() == fd) 
-		{
-			return (server.getServConfigs());
-		}
+		case SLOT_RELOAD:
+			handleReloadEvent();
+		break;
+
+		default: // fd was closed earlier in this batch
+		break;
 	}
-	std::cout << "No config found for fd: " << fd << "\n";
-	return (std::vector<const vServer*>());
 }
 
 
 
 
-const vServer* ServerManager::findServerConfigByName(const std::vector<const vServer*>& subConfigs, std::string serverName) const
-{
-	if (subConfigs.empty()) {
-		return nullptr;
+void	ServerManager::manageClientEvent(EventSlot& slot, uint32_t events) {
+	if (events & EPOLLIN) {
+		slot.client->handleRequest(slot.fd);
+	}
+	else if (events & EPOLLOUT) {
+		slot.client->handleResponse(slot.fd);
+	}
+	else if (events & (EPOLLERR | EPOLLHUP)) {
+		closeClientFd(slot.fd);
 	}
-	const vServer* defaultServConfig = subConfigs[0];
-	for (const vServer* config : subConfigs) {
+}
 
-		for(const std::string& name : config->getServerNames()) {
 
-			if (name == serverName) {
-				std::cout << "Found server config for name: " << serverName << "\n";
-				return(config);
-			}
+
+
+void	ServerManager::manageCgiPipeEvent(EventSlot& slot) {
+	Client*		client = slot.owner;
+	int			pipeFd = slot.fd;
+	CGIHandler*	cgiHandler = client->getCgiHandler();
+
+	cgiHandler->handleEvent(pipeFd);
+	if (cgiHandler->isPipeDone(pipeFd)) {
+		closeCgiFd(pipeFd);
+		cgiHandler->releaseFd(pipeFd);
+	}
+	client->handleCgiOutput(client->getResponse().getClientFd());
+}
+
+
+
+
+void	ServerManager::manageFastCgiEvent(EventSlot& slot, uint32_t events) {
+	FastCgiConnection*				connection = slot.backend;
+	std::vector<FastCgiProgress>	progress = connection->handleEvent(events);
+
+	connection->getUpstream().settle(*connection);
+	for (const FastCgiProgress& request : progress) {
+		EventSlot&	clientSlot = getEventSlot(request.clientFd);
+
+		// The fd may have been reused since; only the client that started the request is answered.
+		if (clientSlot.type == SLOT_CLIENT && clientSlot.client->getCgiHandler() == request.handler) {
+			clientSlot.client->handleCgiOutput(request.clientFd);
 		}
 	}
-	return(defaultServConfig); 
+}
+
+
+
+
+
+TimerWheel&	ServerManager::getTimerWheel(void) {
+	return (_timerWheel);
+}
+
+
+
+
+FileCache&	ServerManager::getFileCache(void) {
+	return (_fileCache);
+}
+
+
+
+
+CgiPoolSet&	ServerManager::getCgiPools(void) {
+	return (_cgiPools);
+}
+
+
+
+
+FastCgiUpstreamSet&	ServerManager::getFastCgiUpstreams(void) {
+	return (_fastCgiUpstreams);
+}
+
+
+
+
+const std::string&	ServerManager::getDateHeaders(void) const {
+	return (_dateCache.getHeaders());
+}
+
+
+
+
+const vServer* ServerManager::findServerConfigByName(const Server& listener, std::string_view host) const
+{
+	return(listener.getVirtualHosts().resolve(host));
 }
 
 
@@ -461,19 +1005,10 @@ const Location*	ServerManager::findDefaultLocationBlock(const std::map<std::stri
 
 
 
-const Location*	ServerManager::findLocationBlockByUri(const vServer& serverConfig, const std::string& uri) const {
-	const std::map<std::string, Location>& locations = serverConfig.getServerLocations();
-	size_t									longestMatchLen = 0;
-	const Location* 						bestMatchLocation 	= nullptr;
-
-	for (std::map<std::string, Location>::const_iterator it = locations.begin(); it != locations.end(); ++it) {
-		const std::string& locationPath = it->first;
+const Location*	ServerManager::findLocationBlockByUri(const vServer& serverConfig, std::string_view uri) const {
+	const std::map<std::string, Location>&	locations = serverConfig.getServerLocations();
+	const Location*							bestMatchLocation = serverConfig.findLocation(uri);
 
-		if (uri.find(locationPath) == 0 && locationPath.length() > longestMatchLen) {
-			bestMatchLocation = &(it->second);
-			longestMatchLen = locationPath.length();
-		}
-	}
 	if (bestMatchLocation) {
 		return (bestMatchLocation);
 	}
@@ -490,7 +1025,7 @@ const Location*	ServerManager::findLocationBlockByUri(const vServer& serverConfi
 
 void ServerManager::closeAllSockets() {
 
-	for (const Server& server : _servers) {
-		close(server.getSocketFd());
+	for (const std::shared_ptr<const Server>& server : _servers) {
+		close(server->getSocketFd());
 	}
 }
\ No newline at end of file
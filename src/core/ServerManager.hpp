@@ -21,20 +21,30 @@
 #define ENABLE                    1
 #define DISABLE                   0
 #define NONE                      0
+#define MASTER_WORKER_ID          0
+#define EPOLL_MAX_WAIT_MS         1000  // upper bound so workers notice shutdown without a signal
 
 
 
 
+#include <mutex>
+#include <thread>
 #include "parsingConfFile/ParseConfig.hpp"
 #include "parsingConfFile/vServer.hpp"
 #include "Request/Request.hpp"
 #include "CGIHandler/CGIHandler.hpp"
+#include "TimerWheel/TimerWheel.hpp"
+#include "DateCache/DateCache.hpp"
+#include "FileCache/FileCache.hpp"
+#include "CgiPool/CgiPool.hpp"
+#include "FastCgi/FastCgiUpstream.hpp"
 
 
 
 
 class Client;
 class Server;
+class ConfigSnapshot;
 struct addrinfo;
 struct epoll_event;
 
@@ -43,18 +53,67 @@ struct epoll_event;
  */
 extern volatile sig_atomic_t running;
 
+/**
+ * @brief Kind of file descriptor registered in a reactor's epoll instance.
+ */
+enum EventSlotType {
+    SLOT_FREE,      ///< Unused entry
+    SLOT_LISTENER,  ///< Listening socket of a Server
+    SLOT_CLIENT,    ///< Accepted client connection
+    SLOT_CGI_PIPE,  ///< stdout/stderr pipe of a running CGI script
+    SLOT_FASTCGI,   ///< Connection to a FastCGI application (fastcgi_pass)
+    SLOT_FILE_CACHE,///< inotify instance of the reactor's file cache
+    SLOT_SIGNAL,    ///< signalfd receiving SIGHUP (master reactor only)
+    SLOT_RELOAD     ///< eventfd the master rings when a new configuration is posted (workers only)
+};
+
+/**
+ * @brief Entry of the fd-indexed connection table.
+ * @details The fd and the slot's generation are stored in epoll_event.data.u64, so
+ *          dispatching an event is a single table lookup. Slots are allocated once per
+ *          fd number and reused, their address never changes while the reactor is alive.
+ *          Each registration bumps the generation: an event queued for an fd that was
+ *          closed and reused earlier in the same epoll_wait() batch no longer matches
+ *          and is dropped instead of reaching the new owner.
+ */
+struct EventSlot {
+    EventSlotType           type;    ///< What the fd currently is
+    int                     fd;      ///< File descriptor this slot is indexed by
+    std::shared_ptr<const Server> server; ///< Listening socket (SLOT_LISTENER)
+    std::unique_ptr<Client> client;  ///< Owned connection (SLOT_CLIENT)
+    Client*                 owner;   ///< Client waiting for this pipe (SLOT_CGI_PIPE)
+    FastCgiConnection*      backend; ///< Connection owned by its upstream (SLOT_FASTCGI)
+    uint32_t                generation; ///< Registrations of this fd number so far
+
+    EventSlot(int slotFd);
+    ~EventSlot();
+};
+
 /**
  * @brief Manages configuration, servers, epoll loop, and client lifecycle.
  */
 class ServerManager {
   private:
     std::ifstream                                       _configFileFd;
+    std::string                                         _configPath;  ///< Re-read on SIGHUP
     int                                                 _epollFd;
-    std::vector<vServer>                                _vServers;
-    std::map<std::string, std::vector<const vServer*>>  _hostVserverMap;
-    std::vector<Server>                                 _servers;
-    std::map<int, Client>                               _fdClientMap;
-    std::unordered_map<int, Client*>                    _cgiFdClientPtrMap;
+    size_t                                              _workerId;
+    size_t                                              _workerThreads;
+    size_t                                              _fileCacheSize;
+    size_t                                              _fileCacheMaxFileSize;
+    std::vector<std::unique_ptr<ServerManager>>         _workers;
+    std::shared_ptr<const ConfigSnapshot>               _config;      ///< Shared read-only by every event loop
+    std::vector<std::shared_ptr<const Server>>          _servers;
+    int                                                 _signalFd;    ///< SIGHUP signalfd, -1 in workers
+    int                                                 _reloadFd;    ///< eventfd rung by postConfig(), -1 in the master
+    std::mutex                                          _reloadMutex;
+    std::shared_ptr<const ConfigSnapshot>               _pendingConfig; ///< Posted by the master, guarded by _reloadMutex
+    TimerWheel                                          _timerWheel;
+    FileCache                                           _fileCache;
+    DateCache                                           _dateCache;
+    CgiPoolSet                                          _cgiPools;    ///< Started CGI interpreters of this reactor
+    std::vector<std::unique_ptr<EventSlot>>             _eventSlots;
+    FastCgiUpstreamSet                                  _fastCgiUpstreams; ///< Destroyed before the slots its connections free
 
     /**
      * @brief Get config file stream.
@@ -90,6 +149,11 @@ class ServerManager {
      */
 	void setSocketsToEpollIn(void);
 
+    /**
+     * @brief Enable the file cache and add its inotify fd to epoll.
+     */
+    void setFileCacheToEpollIn(void);
+
     /**
 	 * @brief Control epoll operations.
 	 * @param targetFd File descriptor.
@@ -107,9 +171,9 @@ class ServerManager {
 
     /**
      * @brief Handle event on listening socket.
-     * @param epollEvents Epoll event struct.
+     * @param slot Slot of the listening socket.
      */
-    void manageListenSocketEvent(const struct epoll_event& epollEvents);
+    void manageListenSocketEvent(const EventSlot& slot);
 
     /**
      * @brief Handle generic epoll event.
@@ -118,25 +182,50 @@ class ServerManager {
     void manageEpollEvent(const struct epoll_event& epollEvents);
 
     /**
-     * @brief Add client to map.
-     * @param clientFd Client fd.
-     * @param serverFd Server fd.
+     * @brief Handle event on a client connection.
+     * @param slot Slot of the client.
+     * @param events Epoll events reported for it.
      */
-    void addClientToMap(int clientFd, int serverFd);
+    void manageClientEvent(EventSlot& slot, uint32_t events);
 
     /**
-     * @brief Check if fd is listening socket.
+     * @brief Handle event on a CGI stdout/stderr pipe.
+     * @param slot Slot of the pipe.
+     */
+    void manageCgiPipeEvent(EventSlot& slot);
+
+    /**
+     * @brief Handle event on a FastCGI connection and answer the clients whose requests ended.
+     * @param slot Slot of the connection.
+     * @param events Epoll events reported for it.
+     */
+    void manageFastCgiEvent(EventSlot& slot, uint32_t events);
+
+    /**
+     * @brief Get (allocating if needed) the table entry for a fd.
      * @param fd File descriptor.
-     * @return True if listening socket.
+     * @return Slot indexed by fd.
      */
-    bool isListeningSocket(int fd);
+    EventSlot& getEventSlot(int fd);
 
     /**
-     * @brief Check if fd is client socket.
+     * @brief Mark a slot unused and drop what it owns.
      * @param fd File descriptor.
-     * @return True if client socket.
      */
-    bool isClientSocket(int fd);
+    void releaseEventSlot(int fd);
+
+    /**
+     * @brief Register an accepted client in the connection table.
+     * @param clientFd Client fd.
+     * @param listener Listening socket that accepted it.
+     */
+    void addClientSlot(int clientFd, const std::shared_ptr<const Server>& listener);
+
+    /**
+     * @brief Remove a CGI pipe from epoll, close it and free its slot.
+     * @param cgiFd Pipe fd.
+     */
+    void closeCgiFd(int cgiFd);
 
     /**
      * @brief Close client connection.
@@ -144,6 +233,118 @@ class ServerManager {
      */
     void closeClientFd(int clientFd);
 
+    /**
+     * @brief Close the CGI pipes, and the pidfd, still registered for a client.
+     * @param client Client whose CGI script is being abandoned.
+     */
+    void closeCgiPipes(Client* client);
+
+    /**
+     * @brief Stop or resume reading a client's CGI stdout.
+     * @param client Client the output goes to.
+     * @param paused true while the client has more pending than it should.
+     * @note A script blocked on a full pipe or socket simply waits. A fastcgi_pass connection
+     *       multiplexing other requests is not paused; that output is bounded by MAX_OUTPUT_SIZE.
+     */
+    void pauseCgiOutput(Client* client, bool paused);
+
+    /**
+     * @brief Construct an additional reactor sharing the master's parsed config.
+     * @details The worker owns its own epoll instance, its own SO_REUSEPORT copy
+     *          of every listening socket and its own client table.
+     * @param master Reactor that parsed the configuration file.
+     * @param workerId Index of this reactor (1..worker_threads-1).
+     */
+    ServerManager(const ServerManager& master, size_t workerId);
+
+    /**
+     * @brief Spawn worker_threads-1 extra reactors, each on its own thread.
+     * @return Threads running the workers' event loops.
+     */
+    std::vector<std::thread> startWorkers(void);
+
+    /**
+     * @brief Thread entry point of a worker reactor.
+     */
+    void runWorker(void);
+
+    /**
+     * @brief Wait for and dispatch epoll events until shutdown.
+     */
+    void eventLoop(void);
+
+    /**
+     * @brief Advance the timer wheel and handle every deadline that passed.
+     */
+    void expireTimers(void);
+
+    /**
+     * @brief Act on one expired connection deadline.
+     * @param timer Expired timer, already unlinked from the wheel.
+     */
+    void handleTimerExpiry(TimerNode& timer);
+
+    /**
+     * @brief Build the listening sockets of a configuration.
+     * @details Sockets whose address is already open in this reactor are reused,
+     *          the others are created. Nothing is registered in epoll yet.
+     * @param config Configuration to listen for.
+     * @return One Server per address, bound to config.
+     * @throws ServerManagerException if a new address cannot be bound; sockets opened so far are closed.
+     */
+    std::vector<std::shared_ptr<const Server>> buildServers(const std::shared_ptr<const ConfigSnapshot>& config);
+
+    /**
+     * @brief Switch this reactor to a new configuration.
+     * @details New sockets join epoll, removed ones are drained (connections already
+     *          queued are accepted) and closed. Open connections keep the Server, and
+     *          so the configuration, they were accepted by: their next response says
+     *          Connection: close, and the client reconnects to the new configuration.
+     * @param config Validated configuration.
+     * @throws ServerManagerException if a new address cannot be bound; the old configuration stays.
+     */
+    void applyConfig(const std::shared_ptr<const ConfigSnapshot>& config);
+
+    /**
+     * @brief Start or stop CGI workers to match the cgi_pool directives of the configuration.
+     * @details Locations pooling the same interpreter share its pool; their limits are merged.
+     */
+    void configureCgiPools(void);
+
+    /**
+     * @brief Accept what a listening socket still has queued, then close it.
+     * @param listener Socket of an address the new configuration dropped.
+     */
+    void drainListener(const std::shared_ptr<const Server>& listener);
+
+    /**
+     * @brief Block SIGHUP in every thread and receive it through a signalfd in this reactor.
+     * @note Called by the master before the workers start, so they inherit the mask.
+     */
+    void setReloadSignalToEpollIn(void);
+
+    /**
+     * @brief Read the pending signals and reload the configuration on SIGHUP.
+     */
+    void handleSignalEvent(void);
+
+    /**
+     * @brief Parse the configuration file again, apply it and post it to the workers.
+     * @note Nothing changes if the file is invalid or a new address cannot be bound.
+     */
+    void reloadConfig(void);
+
+    /**
+     * @brief Hand a configuration to this worker; it applies it from its own event loop.
+     * @param config Configuration the master already applied.
+     */
+    void postConfig(const std::shared_ptr<const ConfigSnapshot>& config);
+
+    /**
+     * @brief Apply the configuration the master posted.
+     */
+    void handleReloadEvent(void);
+
 	public:
     /**
      * @brief Construct manager from config file.
@@ -161,39 +362,33 @@ class ServerManager {
     void setServers();
 
     /**
-     * @brief Start main server loop.
+     * @brief Start main server loop (and the worker reactors, if configured).
      */
     void runServers(void);
 
-    /**
-     * @brief Get client map.
-     * @return Map of fd to Client.
-     */
-    std::map<int, Client>& getFdClientMap(void);
-
     /**
      * @brief Get all servers.
      * @return Vector of servers.
      */
-    std::vector<Server>& getServers(void);
+    const std::vector<std::shared_ptr<const Server>>& getServers(void) const;
 
     /**
-     * @brief Get virtual servers (parsed config).
-     * @return Reference to vector of virtual servers.
+     * @brief Tell whether a listening socket belongs to a configuration a reload replaced.
+     * @param listener Server a connection was accepted by.
+     * @return True if its connections should close after their current response.
      */
-    std::vector<vServer>& getVirtualServers(void);
+    bool isRetired(const Server& listener) const;
 
     /**
-     * @brief Parse configuration file.
-     * @param _vServers Vector to store parsed servers.
+     * @brief Get the configuration every event loop serves from.
+     * @return Compiled configuration snapshot.
      */
-    void parsConfigFile(std::vector<vServer>& _vServers);
+    const ConfigSnapshot& getConfig(void) const;
 
     /**
-     * @brief Group servers by host.
-     * @param _vServers Vector of virtual servers.
+     * @brief Parse and compile the configuration file; exits on a configuration error.
      */
-    void groupServers(const std::vector<vServer>& _vServers);
+    void parsConfigFile(void);
 
     /**
      * @brief Close all sockets.
@@ -201,34 +396,85 @@ class ServerManager {
     void closeAllSockets();
 
     /**
-     * @brief Map CGI fd to client.
+     * @brief Get the number of event-loop threads from the config.
+     * @return Number of reactors.
+     */
+    size_t getWorkerThreads(void) const;
+
+    /**
+     * @brief Register a CGI pipe in the connection table.
      * @param cgiFd CGI process fd.
      * @param clientFd Client fd.
+     * @param events EPOLLIN for an output pipe, EPOLLOUT for the stdin one.
+     */
+    void addCgiFdSlot(int cgiFd, int clientFd, int events);
+
+    /**
+     * @brief Register a FastCGI connection, watched for input and output.
+     * @param fd Non-blocking socket.
+     * @param connection Connection the events go to.
+     */
+    void addFastCgiSlot(int fd, FastCgiConnection* connection);
+
+    /**
+     * @brief Set the events a FastCGI connection is watched for.
+     * @param fd Socket of the connection.
+     * @param readable Add EPOLLIN; left out while the connection is paused.
+     * @param writable Add EPOLLOUT.
+     */
+    void watchFastCgiFd(int fd, bool readable, bool writable);
+
+    /**
+     * @brief Remove a FastCGI connection from epoll, close it and free its slot.
+     * @param fd Socket of the connection.
+     */
+    void closeFastCgiFd(int fd);
+
+    /**
+     * @brief Get the timer wheel of this reactor.
+     * @return Reference to the wheel holding every connection deadline.
+     */
+    TimerWheel& getTimerWheel(void);
+
+    /**
+     * @brief Get the static file cache of this reactor.
+     * @return Reference to the cache (disabled if file_cache_size is off).
+     */
+    FileCache& getFileCache(void);
+
+    /**
+     * @brief Get the CGI worker pools of this reactor.
+     * @return Reference to the pools, one per pooled interpreter.
+     */
+    CgiPoolSet& getCgiPools(void);
+
+    /**
+     * @brief Get the FastCGI applications this reactor is connected to.
+     * @return Reference to the upstreams, one per fastcgi_pass address.
      */
-    void addCgiFdToMap(int cgiFd, int clientFd);
+    FastCgiUpstreamSet& getFastCgiUpstreams(void);
 
     /**
-     * @brief Find server configs by fd.
-     * @param serverFd Server fd.
-     * @return Vector of vServers for that fd.
+     * @brief Get the Date and Server header fields of this reactor.
+     * @return Fragment refreshed once per second by the event loop.
      */
-    const std::vector<const vServer*> findServerConfigsByFd(int serverFd) const;
+    const std::string& getDateHeaders(void) const;
 
     /**
-     * @brief Find server config by name.
-     * @param subConfigs Sub server configs.
-     * @param serverName Server name.
-     * @return Matching vServer or nullptr.
+     * @brief Find the virtual server a Host header addresses on a listening socket.
+     * @param listener Listening socket the request arrived on.
+     * @param host Host header value, port and case as sent.
+     * @return Matching vServer, the socket's first one if no name matches.
      */
-    const vServer* findServerConfigByName(const std::vector<const vServer*>& subConfigs, std::string serverName) const;
+    const vServer* findServerConfigByName(const Server& listener, std::string_view host) const;
 
     /**
-     * @brief Find location block by URI.
+     * @brief Find location block by URI: longest location path that prefixes it, "/" as fallback.
      * @param serverConfig Server configuration.
      * @param url Request URI.
      * @return Matching Location or nullptr.
      */
-    const Location* findLocationBlockByUri(const vServer& serverConfig, const std::string& url) const;
+    const Location* findLocationBlockByUri(const vServer& serverConfig, std::string_view url) const;
 
     /**
      * @brief Find default location block.
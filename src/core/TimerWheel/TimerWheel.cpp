@@ -0,0 +1,270 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   TimerWheel.cpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/20 14:02:11 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/20 14:02:11 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "TimerWheel.hpp"
+#include <time.h>
+
+
+
+
+TimerNode::TimerNode() : prev(nullptr), next(nullptr), expiry(0), type(TIMER_NONE), fd(-1) {
+}
+
+
+
+
+TimerNode::TimerNode(const TimerNode& other) : prev(nullptr), next(nullptr), expiry(0), type(TIMER_NONE), fd(other.fd) {
+}
+
+
+
+
+TimerNode&	TimerNode::operator=(const TimerNode& other) {
+	if (this != &other) {
+		unlink();
+		fd = other.fd;
+	}
+	return (*this);
+}
+
+
+
+
+TimerNode::~TimerNode() {
+	unlink();
+}
+
+
+
+
+void	TimerNode::unlink(void) {
+	if (!next) {
+		return;
+	}
+	prev->next = next;
+	next->prev = prev;
+	prev = nullptr;
+	next = nullptr;
+}
+
+
+
+
+static void	initSentinel(TimerNode& head) {
+	head.prev = &head;
+	head.next = &head;
+}
+
+
+
+
+static bool	isEmpty(const TimerNode& head) {
+	return (head.next == &head);
+}
+
+
+
+
+static void	pushBack(TimerNode& head, TimerNode& node) {
+	node.prev = head.prev;
+	node.next = &head;
+	head.prev->next = &node;
+	head.prev = &node;
+}
+
+
+
+
+TimerWheel::TimerWheel() : _currentTick(0), _startMs(monotonicMs()) {
+	for (size_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+		for (size_t index = 0; index < TIMER_WHEEL_SLOTS; index++) {
+			initSentinel(_slots[level][index]);
+		}
+		_occupied[level] = 0;
+	}
+	initSentinel(_expired);
+}
+
+
+
+
+TimerWheel::~TimerWheel() {
+	// Owners may outlive the wheel; leave their nodes unlinked instead of dangling.
+	for (size_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+		for (size_t index = 0; index < TIMER_WHEEL_SLOTS; index++) {
+			while (!isEmpty(_slots[level][index])) {
+				_slots[level][index].next->unlink();
+			}
+		}
+	}
+	while (popExpired()) {
+	}
+}
+
+
+
+
+uint64_t	TimerWheel::monotonicMs(void) {
+	struct timespec	now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (static_cast<uint64_t>(now.tv_sec) * 1000 + now.tv_nsec / 1000000);
+}
+
+
+
+
+void	TimerWheel::insert(TimerNode& node) {
+	uint64_t	delta = node.expiry > _currentTick ? node.expiry - _currentTick : 0;
+	size_t		level = 0;
+
+	while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (uint64_t(1) << (TIMER_WHEEL_SLOT_BITS * (level + 1)))) {
+		level++;
+	}
+	if (delta >= (uint64_t(1) << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS))) {
+		node.expiry = _currentTick + (uint64_t(1) << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS)) - 1;
+	}
+	size_t	index = (node.expiry >> (TIMER_WHEEL_SLOT_BITS * level)) & TIMER_WHEEL_SLOT_MASK;
+
+	pushBack(_slots[level][index], node);
+	_occupied[level] |= uint64_t(1) << index;
+}
+
+
+
+
+void	TimerWheel::cascade(size_t level, size_t index) {
+	TimerNode&	head = _slots[level][index];
+
+	_occupied[level] &= ~(uint64_t(1) << index);
+	while (!isEmpty(head)) {
+		TimerNode*	node = head.next;
+
+		node->unlink();
+		insert(*node);
+	}
+}
+
+
+
+
+void	TimerWheel::spliceExpired(TimerNode& head) {
+	if (isEmpty(head)) {
+		return;
+	}
+	TimerNode*	first = head.next;
+	TimerNode*	last = head.prev;
+
+	first->prev = _expired.prev;
+	_expired.prev->next = first;
+	last->next = &_expired;
+	_expired.prev = last;
+	initSentinel(head);
+}
+
+
+
+
+void	TimerWheel::arm(TimerNode& node, TimerType type, int fd, uint64_t timeoutMs) {
+	uint64_t	deadlineMs = monotonicMs() - _startMs + timeoutMs;
+	uint64_t	expiry = (deadlineMs + TIMER_WHEEL_TICK_MS - 1) / TIMER_WHEEL_TICK_MS;
+
+	node.unlink();
+	node.type = type;
+	node.fd = fd;
+	node.expiry = expiry > _currentTick ? expiry : _currentTick + 1;
+	insert(node);
+}
+
+
+
+
+void	TimerWheel::cancel(TimerNode& node) {
+	node.unlink();
+	node.type = TIMER_NONE;
+}
+
+
+
+
+void	TimerWheel::advance(void) {
+	uint64_t	nowTick = (monotonicMs() - _startMs) / TIMER_WHEEL_TICK_MS;
+	bool		anyArmed = false;
+
+	for (size_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+		anyArmed = anyArmed || _occupied[level] != 0;
+	}
+	if (!anyArmed && nowTick > _currentTick) {
+		_currentTick = nowTick;
+		return;
+	}
+	while (_currentTick < nowTick) {
+		_currentTick++;
+		// Coarser levels first, so nodes can fall through several levels on the same tick.
+		for (size_t level = TIMER_WHEEL_LEVELS - 1; level > 0; level--) {
+			uint64_t	periodMask = (uint64_t(1) << (TIMER_WHEEL_SLOT_BITS * level)) - 1;
+
+			if ((_currentTick & periodMask) == 0) {
+				cascade(level, (_currentTick >> (TIMER_WHEEL_SLOT_BITS * level)) & TIMER_WHEEL_SLOT_MASK);
+			}
+		}
+		size_t	index = _currentTick & TIMER_WHEEL_SLOT_MASK;
+
+		spliceExpired(_slots[0][index]);
+		_occupied[0] &= ~(uint64_t(1) << index);
+	}
+}
+
+
+
+
+TimerNode*	TimerWheel::popExpired(void) {
+	if (isEmpty(_expired)) {
+		return (nullptr);
+	}
+	TimerNode*	node = _expired.next;
+
+	node->unlink();
+	return (node);
+}
+
+
+
+
+int	TimerWheel::nextTimeoutMs(int maxMs) const {
+	if (!isEmpty(_expired)) {
+		return (0);
+	}
+	size_t		index = _currentTick & TIMER_WHEEL_SLOT_MASK;
+	size_t		shift = (index + 1) & TIMER_WHEEL_SLOT_MASK;
+	uint64_t	ahead = shift ? (_occupied[0] >> shift) | (_occupied[0] << (TIMER_WHEEL_SLOTS - shift)) : _occupied[0];
+	uint64_t	ticks = 0;
+
+	if (ahead) {
+		ticks = __builtin_ctzll(ahead) + 1;
+	}
+	for (size_t level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+		if (_occupied[level] && (ticks == 0 || ticks > TIMER_WHEEL_SLOTS - index)) {
+			ticks = TIMER_WHEEL_SLOTS - index; // next cascade of level 1
+		}
+	}
+	if (ticks == 0) {
+		return (maxMs);
+	}
+	uint64_t	deadlineMs = _startMs + (_currentTick + ticks) * TIMER_WHEEL_TICK_MS;
+	uint64_t	nowMs = monotonicMs();
+
+	if (deadlineMs <= nowMs) {
+		return (0);
+	}
+	return (deadlineMs - nowMs < static_cast<uint64_t>(maxMs) ? static_cast<int>(deadlineMs - nowMs) : maxMs);
+}
@@ -0,0 +1,153 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   TimerWheel.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/20 14:02:11 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/20 14:02:11 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef TIMERWHEEL_HPP
+#define TIMERWHEEL_HPP
+
+
+
+
+#define TIMER_WHEEL_TICK_MS       100   ///< Resolution of the wheel
+#define TIMER_WHEEL_LEVELS        4     ///< 64^4 ticks of 100ms cover ~19 days
+#define TIMER_WHEEL_SLOT_BITS     6
+#define TIMER_WHEEL_SLOTS         (1 << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_SLOT_MASK     (TIMER_WHEEL_SLOTS - 1)
+
+
+
+
+#include <cstdint>
+#include <cstddef>
+
+
+
+
+/**
+ * @brief Deadline a connection is currently waiting on.
+ * @details A connection is only ever in one phase at a time, so a single
+ *          TimerNode per client is re-armed with a new type on each transition.
+ *          TIMER_CGI_EXIT runs on a node of its own, next to the phase deadline.
+ */
+enum TimerType {
+    TIMER_NONE,
+    TIMER_HEADER,     ///< Whole request line + headers must arrive in client_header_timeout
+    TIMER_BODY,       ///< Gap between two body reads must stay below client_body_timeout
+    TIMER_KEEPALIVE,  ///< Idle persistent connection, keepalive_timeout
+    TIMER_SEND,       ///< Gap between two successful writes must stay below send_timeout
+    TIMER_CGI,        ///< CGI script must finish within the request timeout
+    TIMER_CGI_EXIT    ///< Poll a CGI script that closed its pipes for its exit, when no pidfd reports it
+};
+
+/**
+ * @brief Intrusive list node stored inside the object that owns the deadline.
+ * @details Lists are circular around a sentinel, so a node can unlink itself
+ *          without knowing which wheel or slot it sits in. Destroying an armed
+ *          node cancels it.
+ */
+struct TimerNode {
+    TimerNode*  prev;
+    TimerNode*  next;
+    uint64_t    expiry;  ///< Absolute tick at which the timer fires
+    TimerType   type;
+    int         fd;      ///< Connection the deadline belongs to
+
+    TimerNode();
+    TimerNode(const TimerNode&);
+    TimerNode& operator=(const TimerNode&);
+    ~TimerNode();
+
+    bool isArmed(void) const { return (next != nullptr); }
+    void unlink(void);
+};
+
+/**
+ * @brief Hierarchical timing wheel (Varghese & Lauck) driving all reactor deadlines.
+ * @details Arm and cancel are O(1) list operations. Every tick only the current
+ *          level-0 slot is expired; coarser levels are cascaded down once every
+ *          64 ticks of the level below. Expiring thousands of connections costs
+ *          one list splice, the client table is never scanned.
+ */
+class TimerWheel {
+  private:
+    TimerNode   _slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];  ///< Sentinels
+    uint64_t    _occupied[TIMER_WHEEL_LEVELS];                  ///< Bit per possibly non-empty slot
+    TimerNode   _expired;                                       ///< Fired, not yet handled
+    uint64_t    _currentTick;
+    uint64_t    _startMs;
+
+    /**
+     * @brief Milliseconds on the monotonic clock.
+     */
+    static uint64_t monotonicMs(void);
+
+    /**
+     * @brief Link an unlinked node into the slot matching its expiry.
+     * @param node Node with expiry set.
+     */
+    void insert(TimerNode& node);
+
+    /**
+     * @brief Re-insert every node of a coarse slot relative to the current tick.
+     * @param level Wheel level (>= 1).
+     * @param index Slot index inside the level.
+     */
+    void cascade(size_t level, size_t index);
+
+    /**
+     * @brief Append all nodes of a list to the expired list.
+     * @param head Sentinel of the list to move.
+     */
+    void spliceExpired(TimerNode& head);
+
+  public:
+    TimerWheel();
+    ~TimerWheel();
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    /**
+     * @brief (Re)arm a timer.
+     * @param node Node embedded in the owner; unlinked first if already armed.
+     * @param type Deadline kind reported back on expiry.
+     * @param fd Connection the deadline belongs to.
+     * @param timeoutMs Delay before expiry, rounded up to whole ticks.
+     */
+    void arm(TimerNode& node, TimerType type, int fd, uint64_t timeoutMs);
+
+    /**
+     * @brief Cancel a timer; no-op if it is not armed.
+     * @param node Node to cancel.
+     */
+    static void cancel(TimerNode& node);
+
+    /**
+     * @brief Move the wheel to the current time, collecting every due timer.
+     */
+    void advance(void);
+
+    /**
+     * @brief Pop the next expired timer collected by advance().
+     * @return Unlinked node, or nullptr when none is left.
+     * @note Handlers may cancel or destroy other pending expired nodes safely.
+     */
+    TimerNode* popExpired(void);
+
+    /**
+     * @brief Milliseconds epoll_wait may block before a timer needs attention.
+     * @param maxMs Upper bound returned when nothing is due sooner.
+     * @return Timeout for epoll_wait.
+     */
+    int nextTimeoutMs(int maxMs) const;
+};
+
+#endif
@@ -0,0 +1,164 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   VirtualHostIndex.cpp                               :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/26 10:14:03 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/26 10:14:03 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "VirtualHostIndex.hpp"
+#include "../parsingConfFile/vServer.hpp"
+#include <algorithm>
+#include <iostream>
+
+
+
+
+VirtualHostIndex::VirtualHostIndex() : _default(nullptr) {
+}
+
+
+
+
+void	VirtualHostIndex::insert(std::unordered_map<std::string_view, const vServer*>& table, std::string_view key, const vServer* server) {
+	if (!table.emplace(key, server).second && table[key] != server) {
+		std::cerr << "Warning: conflicting server name \"" << key << "\" on " << server->getServerIpPort() << ", ignored" << "\n";
+	}
+}
+
+
+
+
+void	VirtualHostIndex::add(const vServer* server) {
+	if (!_default) {
+		_default = server;
+	}
+	for (const std::string& name : server->getServerNames()) {
+		switch (classify(name)) {
+			case VHOST_NAME_EXACT:
+				insert(_exact, name, server);
+			break;
+
+			case VHOST_NAME_LEADING:
+				insert(_leading, std::string_view(name).substr(1), server);
+			break;
+
+			case VHOST_NAME_TRAILING:
+				insert(_trailing, std::string_view(name).substr(0, name.size() - 1), server);
+			break;
+
+			case VHOST_NAME_REGEX:
+				_regexes.push_back(RegexName{compile(name), server});
+			break;
+
+			default:
+			break;
+		}
+	}
+}
+
+
+
+
+const vServer*	VirtualHostIndex::resolve(std::string_view host) const {
+	std::string			buffer;
+	std::string_view	name = normalizeHost(host, buffer);
+	auto				exact = _exact.find(name);
+
+	if (exact != _exact.end()) {
+		return (exact->second);
+	}
+	// Leftmost dot first: the longest suffix is the most specific wildcard.
+	if (!_leading.empty()) {
+		for (size_t dot = name.find('.'); dot != std::string_view::npos; dot = name.find('.', dot + 1)) {
+			auto	it = _leading.find(name.substr(dot));
+
+			if (it != _leading.end()) {
+				return (it->second);
+			}
+		}
+	}
+	if (!_trailing.empty()) {
+		for (size_t dot = name.rfind('.'); dot != std::string_view::npos && dot > 0; dot = name.rfind('.', dot - 1)) {
+			auto	it = _trailing.find(name.substr(0, dot + 1));
+
+			if (it != _trailing.end()) {
+				return (it->second);
+			}
+		}
+	}
+	for (const RegexName& regex : _regexes) {
+		if (std::regex_search(name.begin(), name.end(), regex.pattern)) {
+			return (regex.server);
+		}
+	}
+	return (_default);
+}
+
+
+
+
+VirtualHostNameType	VirtualHostIndex::classify(const std::string& name) {
+	if (name.empty()) {
+		return (VHOST_NAME_INVALID);
+	}
+	if (name[0] == VHOST_REGEX_PREFIX) {
+		return (name.size() > 1 ? VHOST_NAME_REGEX : VHOST_NAME_INVALID);
+	}
+	size_t	wildcards = std::count(name.begin(), name.end(), VHOST_WILDCARD);
+
+	if (wildcards == 0) {
+		return (VHOST_NAME_EXACT);
+	}
+	if (wildcards > 1 || name.size() < 3) {
+		return (VHOST_NAME_INVALID);
+	}
+	if (name[0] == VHOST_WILDCARD && name[1] == '.') {
+		return (VHOST_NAME_LEADING);
+	}
+	if (name[name.size() - 1] == VHOST_WILDCARD && name[name.size() - 2] == '.') {
+		return (VHOST_NAME_TRAILING);
+	}
+	return (VHOST_NAME_INVALID);
+}
+
+
+
+
+std::regex	VirtualHostIndex::compile(const std::string& name) {
+	return (std::regex(name.substr(1), std::regex::ECMAScript | std::regex::icase | std::regex::optimize));
+}
+
+
+
+
+std::string_view	VirtualHostIndex::normalizeHost(std::string_view host, std::string& buffer) {
+	size_t	end = host.size();
+
+	if (!host.empty() && host[0] == '[') {
+		// IPv6 literal: the port, if any, follows the closing bracket.
+		size_t	bracket = host.find(']');
+
+		end = bracket == std::string_view::npos ? host.size() : bracket + 1;
+	} else {
+		size_t	colon = host.rfind(':');
+
+		if (colon != std::string_view::npos) {
+			end = colon;
+		}
+	}
+	if (end > 0 && host[end - 1] == '.') {
+		end--;
+	}
+	host = host.substr(0, end);
+	if (std::none_of(host.begin(), host.end(), [](char c) { return (c >= 'A' && c <= 'Z'); })) {
+		return (host);
+	}
+	buffer.assign(host);
+	std::transform(buffer.begin(), buffer.end(), buffer.begin(), ::tolower);
+	return (buffer);
+}
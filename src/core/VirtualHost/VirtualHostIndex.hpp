@@ -0,0 +1,118 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   VirtualHostIndex.hpp                               :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/26 10:14:03 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/26 10:14:03 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef VIRTUALHOSTINDEX_HPP
+#define VIRTUALHOSTINDEX_HPP
+
+
+
+
+#define VHOST_REGEX_PREFIX  '~'   ///< server_name ~pattern is a regular expression, as in nginx
+#define VHOST_WILDCARD      '*'
+
+
+
+
+#include <regex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+
+
+class vServer;
+
+/**
+ * @brief Kinds of server_name.
+ */
+enum VirtualHostNameType {
+	VHOST_NAME_INVALID,
+	VHOST_NAME_EXACT,     ///< example.com
+	VHOST_NAME_LEADING,   ///< *.example.com: any name below example.com
+	VHOST_NAME_TRAILING,  ///< www.example.*: any name starting with www.example.
+	VHOST_NAME_REGEX      ///< ~^(www|api)\.example\.com$
+};
+
+/**
+ * @brief Host header to virtual server resolution of one listening socket.
+ * @details Built once at startup from the vServers sharing the socket. Names
+ *          are looked up in nginx order: exact name, longest leading wildcard,
+ *          longest trailing wildcard, then the first regular expression that
+ *          matches, in configuration order. Exact names are one hash lookup;
+ *          wildcards cost one lookup per label of the host. The keys view the
+ *          names stored in the vServers, which outlive every listener. A host
+ *          nothing matches goes to the first vServer of the socket.
+ */
+class VirtualHostIndex {
+  private:
+	struct RegexName {
+		std::regex		pattern;
+		const vServer*	server;
+	};
+
+	std::unordered_map<std::string_view, const vServer*>	_exact;
+	std::unordered_map<std::string_view, const vServer*>	_leading;   ///< "*.example.com" under ".example.com"
+	std::unordered_map<std::string_view, const vServer*>	_trailing;  ///< "www.example.*" under "www.example."
+	std::vector<RegexName>									_regexes;   ///< Configuration order
+	const vServer*											_default;
+
+	/**
+	 * @brief Index one name, keeping the first vServer that declared it.
+	 * @param table Table of the name's kind.
+	 * @param key Name as looked up.
+	 * @param server vServer declaring it.
+	 */
+	static void insert(std::unordered_map<std::string_view, const vServer*>& table, std::string_view key, const vServer* server);
+
+  public:
+	VirtualHostIndex();
+
+	/**
+	 * @brief Index every name of a vServer; the first vServer added is the default.
+	 * @param server vServer listening on this socket, must outlive the index.
+	 */
+	void add(const vServer* server);
+
+	/**
+	 * @brief Find the vServer a Host header addresses.
+	 * @param host Host header value, with or without port.
+	 * @return Matching vServer, the default one if none matches.
+	 */
+	const vServer* resolve(std::string_view host) const;
+
+	/**
+	 * @brief Tell how a server_name is matched.
+	 * @param name Name as written in the configuration.
+	 * @return Its kind; VHOST_NAME_INVALID for an asterisk anywhere but a whole first or last label.
+	 */
+	static VirtualHostNameType classify(const std::string& name);
+
+	/**
+	 * @brief Compile the pattern of a regex server_name.
+	 * @param name Name starting with VHOST_REGEX_PREFIX.
+	 * @return Case-insensitive pattern.
+	 * @throws std::regex_error if the pattern is malformed.
+	 */
+	static std::regex compile(const std::string& name);
+
+	/**
+	 * @brief Reduce a Host header to the name it carries.
+	 * @param host Header value.
+	 * @param buffer Storage used when the name has to be lowercased.
+	 * @return Name without port and trailing dot, lowercase.
+	 */
+	static std::string_view normalizeHost(std::string_view host, std::string& buffer);
+};
+
+#endif
@@ -0,0 +1,41 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   CgiPoolConfig.hpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/27 11:05:48 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/27 11:05:48 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef CGIPOOLCONFIG_HPP
+#define CGIPOOLCONFIG_HPP
+
+
+
+
+#define DEFAULT_CGI_POOL_MAX_REQUESTS	500  // requests a worker serves before it is replaced
+#define MAX_CGI_POOL_WORKERS			64   // per interpreter and reactor
+
+
+
+
+#include <cstddef>
+
+
+
+
+/**
+ * @brief Settings of the persistent CGI worker pools, set by the cgi_pool directive.
+ * @details Held by each Location; off unless the location enables it.
+ */
+struct CgiPoolConfig {
+	bool	enabled;		///< cgi_pool off | <min> <max> [max_requests]
+	size_t	minWorkers;		///< Workers kept started, even when idle
+	size_t	maxWorkers;		///< Busier moments fall back to a fork per request
+	size_t	maxRequests;	///< Requests served before a worker is replaced, 0 for no limit
+};
+
+#endif
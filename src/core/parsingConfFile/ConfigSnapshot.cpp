@@ -0,0 +1,46 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ConfigSnapshot.cpp                                 :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/26 10:14:03 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/26 10:14:03 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "ConfigSnapshot.hpp"
+#include "ParseConfig.hpp"
+
+
+
+
+ConfigSnapshot::ConfigSnapshot() : _workerThreads(1), _fileCacheSize(0), _fileCacheMaxFileSize(0) {
+}
+
+
+
+
+ConfigSnapshot::~ConfigSnapshot() {
+}
+
+
+
+
+std::shared_ptr<const ConfigSnapshot>	ConfigSnapshot::load(std::ifstream& file) {
+	std::shared_ptr<ConfigSnapshot>	snapshot(new ConfigSnapshot());
+	ParseConfig						parser;
+
+	parser.lexemesToTokens(parser.collectLexemesByLine(file));
+	parser.parseServerBlocks(snapshot->_vServers);
+	// The vector is final from here on: pointers into it stay valid for the snapshot's lifetime.
+	for (vServer& server : snapshot->_vServers) {
+		server.compileLocations();
+		snapshot->_listeners[server.getServerIpPort()].push_back(&server);
+	}
+	snapshot->_workerThreads = parser.getWorkerThreads();
+	snapshot->_fileCacheSize = parser.getFileCacheSize();
+	snapshot->_fileCacheMaxFileSize = parser.getFileCacheMaxFileSize();
+	return (snapshot);
+}
@@ -0,0 +1,68 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ConfigSnapshot.hpp                                 :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/26 10:14:03 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/26 10:14:03 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef CONFIGSNAPSHOT_HPP
+#define CONFIGSNAPSHOT_HPP
+
+
+
+
+#include <cstddef>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "vServer.hpp"
+
+
+
+
+/**
+ * @brief Parsed and compiled configuration, read-only once built.
+ * @details Owns every vServer with its locations and their compiled matchers,
+ *          grouped by the address they listen on. Nothing in it changes after
+ *          load(), so every event loop reads the same instance without locks,
+ *          and the pointers handed out stay valid as long as a shared_ptr to
+ *          the snapshot is held.
+ */
+class ConfigSnapshot {
+  private:
+	std::vector<vServer>								_vServers;
+	std::map<std::string, std::vector<const vServer*>>	_listeners;  ///< "ip:port" -> vServers on it, in file order
+	size_t												_workerThreads;
+	size_t												_fileCacheSize;
+	size_t												_fileCacheMaxFileSize;
+
+	ConfigSnapshot();
+
+  public:
+	ConfigSnapshot(const ConfigSnapshot&) = delete;
+	ConfigSnapshot& operator=(const ConfigSnapshot&) = delete;
+	~ConfigSnapshot();
+
+	/**
+	 * @brief Parse a configuration file and compile it.
+	 * @param file Open configuration file.
+	 * @return Immutable snapshot.
+	 * @throws ParseConfig::ConfException on any configuration error.
+	 */
+	static std::shared_ptr<const ConfigSnapshot> load(std::ifstream& file);
+
+	const std::vector<vServer>& getVirtualServers(void) const { return (_vServers); }
+	const std::map<std::string, std::vector<const vServer*>>& getListeners(void) const { return (_listeners); }
+	size_t getWorkerThreads(void) const { return (_workerThreads); }
+	size_t getFileCacheSize(void) const { return (_fileCacheSize); }
+	size_t getFileCacheMaxFileSize(void) const { return (_fileCacheMaxFileSize); }
+};
+
+#endif
@@ -0,0 +1,44 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   GzipConfig.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/26 10:14:03 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/26 10:14:03 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef GZIPCONFIG_HPP
+#define GZIPCONFIG_HPP
+
+
+
+
+#define DEFAULT_GZIP_MIN_LENGTH		20   // bytes; shorter bodies grow when compressed
+#define MIN_GZIP_COMP_LEVEL			1
+#define MAX_GZIP_COMP_LEVEL			9
+
+
+
+
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+
+
+
+
+/**
+ * @brief Settings of on-the-fly response compression, set by the gzip* directives.
+ * @details Held by vServer and copied into each Location, which may override it.
+ */
+struct GzipConfig {
+	bool							enabled;	///< gzip on|off
+	int								level;		///< gzip_comp_level
+	uint64_t						minLength;	///< gzip_min_length: shorter bodies are sent as is
+	std::unordered_set<std::string>	types;		///< gzip_types: compressed MIME types, "*" for all; text/html always is
+};
+
+#endif
@@ -11,6 +11,7 @@
 /* ************************************************************************** */
 
 #include "LocationConfig.hpp"
+#include <algorithm>
 
 Location::Location() {
 }
@@ -26,8 +27,11 @@ Location::Location(const vServer& serv) {
 	_locationRoot= serv.getServerRoot();
 	_locationIndex = serv.getServerIndex();
 	_locationAutoIndex = serv.getServerAutoIndex();
+	_locationSendfile = serv.getServerSendfile();
+	_locationGzip = serv.getServerGzip();
+	_locationCgiPool = {false, 0, 0, DEFAULT_CGI_POOL_MAX_REQUESTS};
 	_locationClientMaxSize = serv.getServerClientMaxSize();
-	_locationAllowedMethods = {"GET"};
+	_locationAllowedMethods = METHOD_GET;
 	_locationErrorPages = serv.getServerErrorPages();
 }
 
@@ -54,6 +58,11 @@ const Location&	Location::operator=(const Location& other) {
 		this->_locationRoot = other._locationRoot;
 		this->_locationIndex = other._locationIndex;
 		this->_locationAutoIndex = other._locationAutoIndex;
+		this->_locationSendfile = other._locationSendfile;
+		this->_locationPrecompressed = other._locationPrecompressed;
+		this->_locationGzip = other._locationGzip;
+		this->_locationCgiPool = other._locationCgiPool;
+		this->_locationFastCgiPass = other._locationFastCgiPass;
 		this->_locationClientMaxSize = other._locationClientMaxSize;
 		this->_locationAllowedMethods = other._locationAllowedMethods;
 		this->_locationReturnPages = other._locationReturnPages;
@@ -90,18 +99,60 @@ const int& Location::getLocationAutoIndex() const {
 	return _locationAutoIndex;
 }
 
+bool Location::getLocationSendfile() const {
+	return _locationSendfile;
+}
+
+
+const std::vector<std::string>& Location::getLocationPrecompressed() const {
+	return _locationPrecompressed;
+}
+
+
+const GzipConfig& Location::getLocationGzip() const {
+	return _locationGzip;
+}
+
+
+const CgiPoolConfig& Location::getLocationCgiPool() const {
+	return _locationCgiPool;
+}
+
+
+
+
+const std::string& Location::getLocationFastCgiPass() const {
+	return _locationFastCgiPass;
+}
+
 
 const unsigned& Location::getLocationClientMaxSize() const {
 	return _locationClientMaxSize;
 }
 
 
-const std::unordered_set<std::string>& Location::getLocationAllowedMethods() const {
+unsigned Location::getLocationAllowedMethods() const {
 	return _locationAllowedMethods;
 }
 
 
-const std::map<std::string, std::string>& Location::getLocationAllowedCgi() const {
+bool Location::isMethodAllowed(std::string_view method) const {
+	return (_locationAllowedMethods & methodBit(method)) != 0;
+}
+
+
+unsigned Location::methodBit(std::string_view method) {
+	if (method == "GET")
+		return METHOD_GET;
+	if (method == "POST")
+		return METHOD_POST;
+	if (method == "DELETE")
+		return METHOD_DELETE;
+	return 0;
+}
+
+
+const std::map<std::string, std::string, std::less<>>& Location::getLocationAllowedCgi() const {
 	return _locationAllowedCgi;
 }
 
@@ -142,13 +193,22 @@ void Location::setLocationAutoIndex(const int autoIndex) {
 	_locationAutoIndex = autoIndex;
 }
 
+void Location::setLocationSendfile(const bool sendfile) {
+	_locationSendfile = sendfile;
+}
+
+
+void Location::setLocationGzip(const GzipConfig& gzip) {
+	_locationGzip = gzip;
+}
+
 
 void Location::setLocationClientMaxSize(const unsigned maxSize) {
 	_locationClientMaxSize = maxSize;
 }
 
 
-void Location::setLocationAllowedMethods(const std::unordered_set<std::string>& methods) {
+void Location::setLocationAllowedMethods(unsigned methods) {
 	_locationAllowedMethods = methods;
 }
 
@@ -208,14 +268,14 @@ std::pair<int, std::string> Location::setLocationReturnPages(std::vector<std::st
 
 
 void	Location::validateAllowedMethodsDirective(const std::vector<std::string>& methodsVector) {
-	_locationAllowedMethods.clear();
-	const std::set<std::string>	allowedMethodsSet = {"POST", "GET", "DELETE"};
+	_locationAllowedMethods = 0;
 
 	for (const std::string& method : methodsVector) {
+		unsigned	bit = methodBit(method);
 
-		if (allowedMethodsSet.count(method)) {
-			if (!_locationAllowedMethods.count(method))
-				_locationAllowedMethods.insert(method);
+		if (bit) {
+			if (!(_locationAllowedMethods & bit))
+				_locationAllowedMethods |= bit;
 			else
 				throw ParseConfig::ConfException("Duplicated method: " + method);
 		}
@@ -241,4 +301,70 @@ void Location::validateAllowedCgiDirective(const std::vector<std::string>& cgiVe
 	}
 	else
 		throw ParseConfig::ConfException("Duplicated " + ext + " extension.");
-}
\ No newline at end of file
+}
+
+
+
+void Location::validatePrecompressedDirective(const std::vector<std::string>& encodingsVector) {
+	const std::set<std::string>	knownEncodings = {"gzip", "br"};
+
+	_locationPrecompressed.clear();
+	if (encodingsVector.empty())
+		throw ParseConfig::ConfException("Invalid precompressed directive: Invalid amount of arguments.");
+	if (encodingsVector.size() == 1 && encodingsVector[0] == "off")
+		return;
+	// Listing order breaks ties between codings the client accepts equally.
+	for (const std::string& encoding : encodingsVector) {
+
+		if (!knownEncodings.count(encoding))
+			throw ParseConfig::ConfException("Invalid precompressed encoding: " + encoding);
+		if (std::find(_locationPrecompressed.begin(), _locationPrecompressed.end(), encoding) != _locationPrecompressed.end())
+			throw ParseConfig::ConfException("Duplicated precompressed encoding: " + encoding);
+		_locationPrecompressed.push_back(encoding);
+	}
+}
+
+
+
+void Location::validateCgiPoolDirective(const std::vector<std::string>& poolVector) {
+	if (poolVector.size() == 1 && poolVector[0] == "off") {
+		_locationCgiPool.enabled = false;
+		return;
+	}
+	if (poolVector.size() != 2 && poolVector.size() != 3)
+		throw ParseConfig::ConfException("Invalid cgi_pool directive: expected 'off' or <min> <max> [max_requests].");
+	_locationCgiPool.enabled = true;
+	_locationCgiPool.minWorkers = vServer::validateCounterDirective({poolVector[0]}, "cgi_pool");
+	_locationCgiPool.maxWorkers = vServer::validateCounterDirective({poolVector[1]}, "cgi_pool");
+	if (poolVector.size() == 3)
+		_locationCgiPool.maxRequests = vServer::validateCounterDirective({poolVector[2]}, "cgi_pool");
+	if (_locationCgiPool.maxWorkers == 0 || _locationCgiPool.maxWorkers > MAX_CGI_POOL_WORKERS)
+		throw ParseConfig::ConfException("Invalid cgi_pool directive: max workers must be between 1 and " + std::to_string(MAX_CGI_POOL_WORKERS));
+	if (_locationCgiPool.minWorkers > _locationCgiPool.maxWorkers)
+		throw ParseConfig::ConfException("Invalid cgi_pool directive: min workers exceed max workers.");
+}
+
+
+
+void Location::validateFastCgiPassDirective(const std::vector<std::string>& passVector) {
+	if (passVector.size() != 1)
+		throw ParseConfig::ConfException("Invalid fastcgi_pass directive: Invalid amount of arguments.");
+	const std::string& address = passVector[0];
+
+	if (address.compare(0, 5, "unix:") == 0) {
+		// sun_path holds 108 bytes, the terminating NUL included.
+		if (address.size() == 5 || address.size() - 5 >= 108)
+			throw ParseConfig::ConfException("Invalid fastcgi_pass socket path: " + address);
+		_locationFastCgiPass = address;
+		return;
+	}
+	size_t colon = address.find_last_of(':');
+
+	if (colon == std::string::npos || colon == 0)
+		throw ParseConfig::ConfException("Invalid fastcgi_pass address, expected unix:<path> or <host>:<port>: " + address);
+	size_t port = vServer::validateCounterDirective({address.substr(colon + 1)}, "fastcgi_pass");
+
+	if (port == 0 || port > 65535)
+		throw ParseConfig::ConfException("Invalid fastcgi_pass port: " + address);
+	_locationFastCgiPass = address;
+}
@@ -19,6 +19,15 @@
 
 
 
+#define METHOD_GET		0x01
+#define METHOD_POST		0x02
+#define METHOD_DELETE	0x04
+
+
+
+
+#include "CgiPoolConfig.hpp"
+#include "GzipConfig.hpp"
 #include "vServer.hpp"
 
 
@@ -39,9 +48,14 @@ class Location {
 		std::string _locationRoot;
 		std::vector<std::string> _locationIndex;
 		int _locationAutoIndex;
+		bool _locationSendfile;
+		std::vector<std::string> _locationPrecompressed;
+		GzipConfig _locationGzip;
+		CgiPoolConfig _locationCgiPool;
+		std::string _locationFastCgiPass;   ///< "unix:<path>" or "<host>:<port>", empty when scripts run locally
 		unsigned _locationClientMaxSize;
-		std::unordered_set<std::string> _locationAllowedMethods;
-		std::map<std::string, std::string> _locationAllowedCgi;
+		unsigned _locationAllowedMethods;   ///< METHOD_* bits
+		std::map<std::string, std::string, std::less<>> _locationAllowedCgi;
 		std::pair<int, std::string> _locationReturnPages;
 		std::unordered_map<int, std::string> _locationErrorPages;
 
@@ -91,14 +105,35 @@ class Location {
 		/// @brief Get the autoindex setting for this Location.
 		const int& getLocationAutoIndex(void) const;
 
+		/// @brief Get whether static files are sent with sendfile() in this Location.
+		bool getLocationSendfile(void) const;
+
+		/// @brief Get the content codings whose precompressed siblings may be served, in order of preference.
+		const std::vector<std::string>& getLocationPrecompressed(void) const;
+
+		/// @brief Get the response compression settings of this Location.
+		const GzipConfig& getLocationGzip(void) const;
+
+		/// @brief Get the CGI worker pool settings of this Location.
+		const CgiPoolConfig& getLocationCgiPool(void) const;
+
+		/// @brief Get the FastCGI application requests of this Location are passed to, empty if none.
+		const std::string& getLocationFastCgiPass(void) const;
+
 		/// @brief Get the maximum client request size for this Location.
 		const unsigned& getLocationClientMaxSize(void) const;
 
-		/// @brief Get the allowed HTTP methods for this Location.
-		const std::unordered_set<std::string>& getLocationAllowedMethods(void) const;
+		/// @brief Get the allowed HTTP methods for this Location, as METHOD_* bits.
+		unsigned getLocationAllowedMethods(void) const;
+
+		/// @brief Tell whether a request method is allowed in this Location; no allocation, no hashing.
+		bool isMethodAllowed(std::string_view method) const;
+
+		/// @brief Get the METHOD_* bit of a method name, 0 for a method the server does not implement.
+		static unsigned methodBit(std::string_view method);
 
 		/// @brief Get the allowed CGI handlers for this Location.
-		const std::map<std::string, std::string>& getLocationAllowedCgi(void) const;
+		const std::map<std::string, std::string, std::less<>>& getLocationAllowedCgi(void) const;
 
 		/// @brief Get the return directive (status code and target).
 		const std::pair<int, std::string>& getLocationReturnPages(void) const;
@@ -122,11 +157,17 @@ class Location {
 		/// @brief Set the autoindex value for this Location.
 		void setLocationAutoIndex(const int autoIndex);
 
+		/// @brief Enable or disable sendfile() for this Location.
+		void setLocationSendfile(const bool sendfile);
+
+		/// @brief Set the response compression settings for this Location.
+		void setLocationGzip(const GzipConfig& gzip);
+
 		/// @brief Set the maximum client request size for this Location.
 		void setLocationClientMaxSize(const unsigned maxSize);
 
 		/// @brief Set the allowed HTTP methods for this Location.
-		void setLocationAllowedMethods(const std::unordered_set<std::string>& methods);
+		void setLocationAllowedMethods(unsigned methods);
 
 		/// @brief Set the return directive for this Location.
 		void setLocationReturnPages(const std::pair<int, std::string>& returnPages);
@@ -143,6 +184,15 @@ class Location {
 
 		/// @brief Validate the allowed CGI directive.
 		void validateAllowedCgiDirective(const std::vector<std::string>& allowedCgiVector);
+
+		/// @brief Validate the precompressed directive ("off", or codings among gzip and br).
+		void validatePrecompressedDirective(const std::vector<std::string>& encodingsVector);
+
+		/// @brief Validate the cgi_pool directive ("off", or min and max workers and optionally the requests per worker).
+		void validateCgiPoolDirective(const std::vector<std::string>& poolVector);
+
+		/// @brief Validate the fastcgi_pass directive ("unix:<path>" or "<host>:<port>").
+		void validateFastCgiPassDirective(const std::vector<std::string>& passVector);
 };
 
 #endif
@@ -0,0 +1,115 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   LocationMatcher.cpp                                :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/26 10:14:03 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/26 10:14:03 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "LocationMatcher.hpp"
+#include <algorithm>
+#include <cstring>
+
+
+
+
+LocationMatcher::LocationMatcher() : _nodes(1, LocationMatcherNode{0, 0, 0, 0, -1}), _firstBytes(1, '\0') {
+}
+
+
+
+
+void	LocationMatcher::compile(const std::vector<std::string>& prefixes) {
+	std::vector<std::pair<std::string_view, int>>	keys;
+
+	for (size_t i = 0; i < prefixes.size(); i++) {
+		if (!prefixes[i].empty()) {
+			keys.emplace_back(prefixes[i], static_cast<int>(i));
+		}
+	}
+	std::stable_sort(keys.begin(), keys.end(), [](const auto& a, const auto& b) { return (a.first < b.first); });
+	keys.erase(std::unique(keys.begin(), keys.end(), [](const auto& a, const auto& b) { return (a.first == b.first); }), keys.end());
+	_nodes.assign(1, LocationMatcherNode{0, 0, 0, 0, -1});
+	_labels.clear();
+	_firstBytes.assign(1, '\0');
+	if (!keys.empty()) {
+		buildChildren(0, keys, 0, keys.size(), 0);
+	}
+}
+
+
+
+
+void	LocationMatcher::buildChildren(uint32_t node, const std::vector<std::pair<std::string_view, int>>& keys, size_t lo, size_t hi, size_t depth) {
+	std::vector<std::pair<size_t, size_t>>	groups;
+
+	// Sorted keys sharing the byte at depth are contiguous: each run becomes one child.
+	for (size_t i = lo; i < hi;) {
+		size_t	j = i + 1;
+
+		while (j < hi && keys[j].first[depth] == keys[i].first[depth]) {
+			j++;
+		}
+		groups.emplace_back(i, j);
+		i = j;
+	}
+	uint32_t	first = static_cast<uint32_t>(_nodes.size());
+
+	_nodes[node].firstChild = first;
+	_nodes[node].childCount = static_cast<uint32_t>(groups.size());
+	_nodes.resize(first + groups.size());
+	_firstBytes.resize(_nodes.size());
+	for (size_t k = 0; k < groups.size(); k++) {
+		std::string_view	shortest = keys[groups[k].first].first;
+		std::string_view	longest = keys[groups[k].second - 1].first;
+		size_t				end = depth;
+		size_t				next = groups[k].first;
+
+		// The first and last key of a sorted run bound the prefix the whole run shares.
+		while (end < shortest.size() && end < longest.size() && shortest[end] == longest[end]) {
+			end++;
+		}
+		_nodes[first + k] = LocationMatcherNode{static_cast<uint32_t>(_labels.size()), static_cast<uint32_t>(end - depth), 0, 0, -1};
+		_labels.append(shortest.substr(depth, end - depth));
+		_firstBytes[first + k] = shortest[depth];
+		if (shortest.size() == end) {
+			_nodes[first + k].id = keys[next++].second;
+		}
+		if (next < groups[k].second) {
+			buildChildren(static_cast<uint32_t>(first + k), keys, next, groups[k].second, end);
+		}
+	}
+}
+
+
+
+
+int	LocationMatcher::match(std::string_view uri) const {
+	int			best = -1;
+	size_t		pos = 0;
+	uint32_t	node = 0;
+
+	while (pos < uri.size() && _nodes[node].childCount) {
+		const LocationMatcherNode&	parent = _nodes[node];
+		const void*					hit = memchr(_firstBytes.data() + parent.firstChild, uri[pos], parent.childCount);
+
+		if (!hit) {
+			break;
+		}
+		node = static_cast<uint32_t>(static_cast<const char*>(hit) - _firstBytes.data());
+		const LocationMatcherNode&	child = _nodes[node];
+
+		if (uri.size() - pos < child.labelLength || memcmp(uri.data() + pos, _labels.data() + child.labelOffset, child.labelLength) != 0) {
+			break;
+		}
+		pos += child.labelLength;
+		if (child.id != -1) {
+			best = child.id;
+		}
+	}
+	return (best);
+}
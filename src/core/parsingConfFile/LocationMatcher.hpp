@@ -0,0 +1,90 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   LocationMatcher.hpp                                :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/26 10:14:03 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/26 10:14:03 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef LOCATIONMATCHER_HPP
+#define LOCATIONMATCHER_HPP
+
+
+
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+
+
+/**
+ * @brief Node of the flattened trie.
+ * @details The children of a node are contiguous in the node table, so the
+ *          first bytes of their labels form one short run a single memchr()
+ *          searches.
+ */
+struct LocationMatcherNode {
+	uint32_t	labelOffset;   ///< Edge label from the parent, in the shared label string
+	uint32_t	labelLength;
+	uint32_t	firstChild;
+	uint32_t	childCount;
+	int32_t		id;            ///< Prefix ending at this node, -1 if none
+};
+
+/**
+ * @brief Longest-prefix matcher of location paths, compiled once at config load.
+ * @details A radix trie (one edge per shared run of bytes) flattened into three
+ *          arrays: nodes, edge labels and the first byte of every label. A
+ *          lookup walks the URI once, comparing whole labels with memcmp(),
+ *          and remembers the last node a prefix ends on. Matching is by plain
+ *          byte prefix, like the linear scan it replaces: "/api" matches
+ *          "/apiary". Empty prefixes never match.
+ */
+class LocationMatcher {
+  private:
+	std::vector<LocationMatcherNode>	_nodes;       ///< _nodes[0] is the root, its label is empty
+	std::string							_labels;
+	std::string							_firstBytes;  ///< First label byte of each node, same index as _nodes
+
+	/**
+	 * @brief Add the children of a node for a range of sorted keys.
+	 * @param node Node the keys continue from.
+	 * @param keys Prefixes sorted bytewise, with their ids.
+	 * @param lo First key of the range.
+	 * @param hi One past the last key of the range.
+	 * @param depth Bytes every key in the range shares with the node's path.
+	 */
+	void buildChildren(uint32_t node, const std::vector<std::pair<std::string_view, int>>& keys, size_t lo, size_t hi, size_t depth);
+
+  public:
+	LocationMatcher();
+
+	/**
+	 * @brief Build the trie, replacing any previous one.
+	 * @param prefixes Location paths; the index of a path is the id match() returns.
+	 * @note A duplicated path keeps its first id.
+	 */
+	void compile(const std::vector<std::string>& prefixes);
+
+	/**
+	 * @brief Find the longest prefix of a URI.
+	 * @param uri Request target.
+	 * @return Id of the longest matching prefix, -1 if none matches.
+	 */
+	int match(std::string_view uri) const;
+
+	/**
+	 * @brief Get the number of nodes, for diagnostics.
+	 * @return Nodes of the trie, root included.
+	 */
+	size_t getNodeCount(void) const { return (_nodes.size()); }
+};
+
+#endif
@@ -18,7 +18,8 @@
 
 
 
-ParseConfig::ParseConfig() : depth(0), currToken(0) {
+ParseConfig::ParseConfig() : _workerThreads(1), _seenWorkerThreads(false), _fileCacheSize(FILE_CACHE_DEFAULT_SIZE),
+	_fileCacheMaxFileSize(FILE_CACHE_DEFAULT_MAX_FILE), depth(0), currToken(0) {
 	_keywords[";"] = SEMICOLON;
 	_keywords["#"] = COMMENT;
 	_keywords["{"] = OPENED_BRACE;
@@ -36,6 +37,22 @@ ParseConfig::ParseConfig() : depth(0), currToken(0) {
 	_keywords["error_page"] = ERROR_PAGE_DIR;
 	_keywords["allowed_methods"] = ALLOWED_METHODS;
 	_keywords["client_max_body_size"] = BODY_MAX_SIZE;
+	_keywords["worker_threads"] = WORKER_THREADS_DIR;
+	_keywords["file_cache_size"] = FILE_CACHE_SIZE_DIR;
+	_keywords["file_cache_max_file_size"] = FILE_CACHE_MAX_FILE_SIZE_DIR;
+	_keywords["keepalive_timeout"] = KEEPALIVE_TIMEOUT_DIR;
+	_keywords["keepalive_requests"] = KEEPALIVE_REQUESTS_DIR;
+	_keywords["client_header_timeout"] = CLIENT_HEADER_TIMEOUT_DIR;
+	_keywords["client_body_timeout"] = CLIENT_BODY_TIMEOUT_DIR;
+	_keywords["send_timeout"] = SEND_TIMEOUT_DIR;
+	_keywords["sendfile"] = SENDFILE_DIR;
+	_keywords["precompressed"] = PRECOMPRESSED_DIR;
+	_keywords["cgi_pool"] = CGI_POOL_DIR;
+	_keywords["fastcgi_pass"] = FASTCGI_PASS_DIR;
+	_keywords["gzip"] = GZIP_DIR;
+	_keywords["gzip_comp_level"] = GZIP_COMP_LEVEL_DIR;
+	_keywords["gzip_min_length"] = GZIP_MIN_LENGTH_DIR;
+	_keywords["gzip_types"] = GZIP_TYPES_DIR;
 }
 
 
@@ -75,7 +92,11 @@ bool	ParseConfig::isTokenDirective(TokenType type) const {
 			type == INDEX_DIR || type == SERVER_NAME_DIR || 
 			type == ERROR_PAGE_DIR || type == AUTO_INDEX_DIR ||
 			type == BODY_MAX_SIZE || type == ALLOWED_METHODS ||
-			type == RETURN_DIR || type == UPLOAD_PATH || type == ALLOWED_CGI);
+			type == RETURN_DIR || type == UPLOAD_PATH || type == ALLOWED_CGI ||
+			type == KEEPALIVE_TIMEOUT_DIR || type == KEEPALIVE_REQUESTS_DIR ||
+			type == CLIENT_HEADER_TIMEOUT_DIR || type == CLIENT_BODY_TIMEOUT_DIR || type == SEND_TIMEOUT_DIR ||
+			type == SENDFILE_DIR || type == GZIP_DIR || type == GZIP_COMP_LEVEL_DIR ||
+			type == GZIP_MIN_LENGTH_DIR || type == GZIP_TYPES_DIR);
 }
 
 
@@ -131,6 +152,8 @@ void ParseConfig::parseServerBlocks(std::vector<vServer>& outServers) {
             depth = LEVEL;
             currToken += 2;
             parsevServerBlock(vserv);
+            // It stops past the closing brace; step back so the loop lands on the next block.
+            currToken--;
 
             if (vserv.getServerLocations().find("/") ==
                 vserv.getServerLocations().end()) {
@@ -140,6 +163,12 @@ void ParseConfig::parseServerBlocks(std::vector<vServer>& outServers) {
             outServers.push_back(vserv);
             seenDirectives.clear();
         }
+        else if (tk.type == WORKER_THREADS_DIR) {
+            validateWorkerThreadsDirective();
+        }
+        else if (tk.type == FILE_CACHE_SIZE_DIR || tk.type == FILE_CACHE_MAX_FILE_SIZE_DIR) {
+            validateFileCacheDirective();
+        }
         else if (tk.type == COMMENT) {
             continue;
         }
@@ -157,6 +186,69 @@ void ParseConfig::parseServerBlocks(std::vector<vServer>& outServers) {
 
 
 
+size_t	ParseConfig::getWorkerThreads(void) const {
+	return (_workerThreads);
+}
+
+
+
+
+size_t	ParseConfig::getFileCacheSize(void) const {
+	return (_fileCacheSize);
+}
+
+
+
+
+size_t	ParseConfig::getFileCacheMaxFileSize(void) const {
+	return (_fileCacheMaxFileSize);
+}
+
+
+
+
+void	ParseConfig::validateFileCacheDirective(void) {
+	std::pair<Token, std::vector<std::string>>	pair = makeKeyValuePair();
+	const std::string&							value = vServer::onlyOneArgumentCheck(pair.second, pair.first.lexem);
+
+	if (!_seenGlobalDirectives.insert(pair.first.type).second)
+		throw ConfException("Duplicated " + pair.first.lexem + " directive");
+
+	if (pair.first.type == FILE_CACHE_SIZE_DIR) {
+		_fileCacheSize = (value == "off") ? 0 : vServer::validateSizeValue(value);
+		return;
+	}
+	_fileCacheMaxFileSize = vServer::validateSizeValue(value);
+}
+
+
+
+
+void	ParseConfig::validateWorkerThreadsDirective(void) {
+	std::pair<Token, std::vector<std::string>>	pair = makeKeyValuePair();
+	const std::string&							value = vServer::onlyOneArgumentCheck(pair.second, "worker_threads");
+
+	if (_seenWorkerThreads)
+		throw ConfException("Duplicated worker_threads directive");
+	_seenWorkerThreads = true;
+
+	if (value == "auto") {
+		long	cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		_workerThreads = (cpus > 0) ? static_cast<size_t>(cpus) : 1;
+		return;
+	}
+	if (value.empty() || !isNumber(value) || value.size() > 3)
+		throw ConfException("Invalid worker_threads directive: expected a number or 'auto'");
+
+	size_t	threads = std::stoul(value);
+	if (threads < 1 || threads > MAX_WORKER_THREADS)
+		throw ConfException("Invalid worker_threads directive: value must be between 1 and " + std::to_string(MAX_WORKER_THREADS));
+	_workerThreads = threads;
+}
+
+
+
+
 std::ostream& operator<<(std::ostream& os, const std::vector<vServer>& servers) {
 	for (size_t i = 0; i < servers.size(); ++i) {
 		os << "\n\n==================== Server Block " << i << " ====================\n";
@@ -182,6 +274,11 @@ std::ostream& operator<<(std::ostream& os, const vServer& server) {
 		os<< index << " ";
 	os<< "\n";
 	os << "AutoIndex:                    " << server.getServerAutoIndex() << "\n";
+	os << "Keepalive Timeout:            " << server.getServerKeepaliveTimeout() << "\n";
+	os << "Keepalive Requests:           " << server.getServerKeepaliveRequests() << "\n";
+	os << "Client Header Timeout:        " << server.getServerHeaderTimeout() << "\n";
+	os << "Client Body Timeout:          " << server.getServerBodyTimeout() << "\n";
+	os << "Send Timeout:                 " << server.getServerSendTimeout() << "\n";
 
 	os << "  Error Pages:\n";
 	const std::unordered_map<int, std::string>& errorPages = server.getServerErrorPages();
@@ -204,14 +301,30 @@ std::ostream& operator<<(std::ostream& os, const vServer& server) {
 			os<< index << " ";
 		os<< "\n";
 		os << "  AutoIndex:      " << loc.getLocationAutoIndex() << "\n";
+		os << "  Sendfile:       " << loc.getLocationSendfile() << "\n";
+		os << "  Gzip:           " << loc.getLocationGzip().enabled << " level " << loc.getLocationGzip().level
+			<< " min " << loc.getLocationGzip().minLength << "\n";
+		os << "  Precompressed:  ";
+		for (const std::string& encoding : loc.getLocationPrecompressed())
+			os<< encoding << " ";
+		os<< "\n";
+		os << "  CGI Pool:       ";
+		if (loc.getLocationCgiPool().enabled)
+			os << loc.getLocationCgiPool().minWorkers << "-" << loc.getLocationCgiPool().maxWorkers
+				<< " workers, " << loc.getLocationCgiPool().maxRequests << " requests each";
+		else
+			os << "off";
+		os << "\n";
+		os << "  FastCGI Pass:   " << loc.getLocationFastCgiPass() << "\n";
 		os << "  UploadPath:     " << loc.getLocationUploadPath() << "\n";
 		os << "  Max Body Size:  " << loc.getLocationClientMaxSize() << "\n";
 		os << "  Return:         ";
 		const std::pair<int, std::string>& returnPages = loc.getLocationReturnPages();
 		os<< returnPages.first << "   " << returnPages.second << "\n";
 		os << "  Allowed Methods:";
-		for (auto itSet = loc.getLocationAllowedMethods().begin(); itSet != loc.getLocationAllowedMethods().end(); ++itSet)
-			os << " " << *itSet;
+		for (const char* method : {"GET", "POST", "DELETE"})
+			if (loc.isMethodAllowed(method))
+				os << " " << method;
 		os << "\n";
 		os << "  Error Pages:";
 		const std::unordered_map<int, std::string>& errorPages = loc.getLocationErrorPages();
@@ -219,8 +332,8 @@ std::ostream& operator<<(std::ostream& os, const vServer& server) {
 			os << "    " << it->first << ": " << it->second << "\n";
 
 		os << "  Allowed CGI:\n";
-		const std::map<std::string, std::string>& allowedCgi = loc.getLocationAllowedCgi();
-		for (std::map<std::string, std::string>::const_iterator it = allowedCgi.begin(); it != allowedCgi.end(); ++it)
+		const std::map<std::string, std::string, std::less<>>& allowedCgi = loc.getLocationAllowedCgi();
+		for (auto it = allowedCgi.begin(); it != allowedCgi.end(); ++it)
 			os << "    " << it->first << ": " << it->second << "\n" << "\n";
 	}
 	os << "=======================================================\n";
@@ -245,7 +358,7 @@ void	ParseConfig::parsevServerBlock(vServer& serv) {
 			validateLocationBlockDirectives(serv);
 			depth -= LEVEL;
 		}
-		else if (currToken == COMMENT) {
+		else if (currTokenType == COMMENT) {
 			continue;
 		}
 		else{
@@ -273,7 +386,9 @@ std::string	ParseConfig::findLocationPath(void) {
 
 
 bool ParseConfig::noRepeatDirective(TokenType type) const {
-	return (type == LISTEN_DIR || type == SERVER_NAME_DIR);
+	return (type == LISTEN_DIR || type == SERVER_NAME_DIR ||
+			type == KEEPALIVE_TIMEOUT_DIR || type == KEEPALIVE_REQUESTS_DIR ||
+			type == CLIENT_HEADER_TIMEOUT_DIR || type == CLIENT_BODY_TIMEOUT_DIR || type == SEND_TIMEOUT_DIR);
 }
 
 void	ParseConfig::isSeenDirective(Token directive) {
@@ -319,6 +434,29 @@ for (; _tokens[currToken].type != CLOSED_BRACE; currToken++) {
 			loc.setLocationAutoIndex(vServer::validateAutoIndexDirective(pair.second));
 		break;
 
+		case SENDFILE_DIR:
+			loc.setLocationSendfile(vServer::validateOnOffDirective(pair.second, "sendfile"));
+		break;
+
+		case PRECOMPRESSED_DIR:
+			loc.validatePrecompressedDirective(pair.second);
+		break;
+
+		case CGI_POOL_DIR:
+			loc.validateCgiPoolDirective(pair.second);
+		break;
+
+		case FASTCGI_PASS_DIR:
+			loc.validateFastCgiPassDirective(pair.second);
+		break;
+
+		case GZIP_DIR:
+		case GZIP_COMP_LEVEL_DIR:
+		case GZIP_MIN_LENGTH_DIR:
+		case GZIP_TYPES_DIR:
+			loc.setLocationGzip(vServer::validateGzipDirective(pair.first.lexem, pair.second, loc.getLocationGzip()));
+		break;
+
 		case BODY_MAX_SIZE:
 			loc.setLocationClientMaxSize(vServer::validateClientMaxSizeDirective(pair.second));
 		break;
@@ -378,6 +516,17 @@ void	ParseConfig::validateServerBlockDirectives(vServer& serv) {
 			serv.setServerAutoIndex(vServer::validateAutoIndexDirective(pair.second));
 		break;
 
+		case SENDFILE_DIR:
+			serv.setServerSendfile(vServer::validateOnOffDirective(pair.second, "sendfile"));
+		break;
+
+		case GZIP_DIR:
+		case GZIP_COMP_LEVEL_DIR:
+		case GZIP_MIN_LENGTH_DIR:
+		case GZIP_TYPES_DIR:
+			serv.setServerGzip(vServer::validateGzipDirective(pair.first.lexem, pair.second, serv.getServerGzip()));
+		break;
+
 		case BODY_MAX_SIZE:
 			serv.setServerClientMaxSize(vServer::validateClientMaxSizeDirective(pair.second));
 		break;
@@ -386,6 +535,26 @@ void	ParseConfig::validateServerBlockDirectives(vServer& serv) {
 			serv.setServerErrorPages(vServer::validateErrorPagesDirective(pair.second));
 		break;
 
+		case KEEPALIVE_TIMEOUT_DIR:
+			serv.setServerKeepaliveTimeout(vServer::validateCounterDirective(pair.second, "keepalive_timeout"));
+		break;
+
+		case KEEPALIVE_REQUESTS_DIR:
+			serv.setServerKeepaliveRequests(vServer::validateCounterDirective(pair.second, "keepalive_requests"));
+		break;
+
+		case CLIENT_HEADER_TIMEOUT_DIR:
+			serv.setServerHeaderTimeout(vServer::validateCounterDirective(pair.second, "client_header_timeout"));
+		break;
+
+		case CLIENT_BODY_TIMEOUT_DIR:
+			serv.setServerBodyTimeout(vServer::validateCounterDirective(pair.second, "client_body_timeout"));
+		break;
+
+		case SEND_TIMEOUT_DIR:
+			serv.setServerSendTimeout(vServer::validateCounterDirective(pair.second, "send_timeout"));
+		break;
+
 		default:
 			throw ConfException("Invalid directive name: " + pair.first.lexem + " not found!");
 	}
@@ -34,6 +34,7 @@ class Location;
 
 
 #define LEVEL 1
+#define MAX_WORKER_THREADS 256
 
 
 
@@ -53,6 +54,22 @@ enum TokenType {
 	ALLOWED_METHODS,
 	ALLOWED_CGI,
 	RETURN_DIR,
+	KEEPALIVE_TIMEOUT_DIR,
+	KEEPALIVE_REQUESTS_DIR,
+	CLIENT_HEADER_TIMEOUT_DIR,
+	CLIENT_BODY_TIMEOUT_DIR,
+	SEND_TIMEOUT_DIR,
+	SENDFILE_DIR,
+	PRECOMPRESSED_DIR,
+	CGI_POOL_DIR,
+	FASTCGI_PASS_DIR,
+	GZIP_DIR,
+	GZIP_COMP_LEVEL_DIR,
+	GZIP_MIN_LENGTH_DIR,
+	GZIP_TYPES_DIR,
+	WORKER_THREADS_DIR,
+	FILE_CACHE_SIZE_DIR,
+	FILE_CACHE_MAX_FILE_SIZE_DIR,
 	SERVER_BLOCK,
 	LOCATION_BLOCK,
 	HASH,
@@ -83,6 +100,11 @@ class ParseConfig {
 	private:
 		std::vector<Token>							_tokens; //vector of tokens
 		std::unordered_map<std::string, TokenType>	_keywords; // map  ; = SEMICOLON;
+		size_t										_workerThreads; // number of event loops, 1 by default
+		bool										_seenWorkerThreads; // worker_threads may appear only once
+		size_t										_fileCacheSize; // memory budget of each reactor's file cache, 0 = off
+		size_t										_fileCacheMaxFileSize; // largest file the cache keeps
+		std::unordered_set<TokenType>				_seenGlobalDirectives; // other top-level directives, each allowed once
 
 
 
@@ -200,6 +222,36 @@ class ParseConfig {
 
 
 
+		/**
+		 * @brief Parses the top-level worker_threads directive.
+		 *
+		 * Accepts a positive number or 'auto', which resolves to the number of
+		 * online CPUs (falls back to 1 if it cannot be determined).
+		 *
+		 * @return void
+		 *
+		 * @throw ConfException If the directive is duplicated or its value is invalid.
+		 */
+		void											validateWorkerThreadsDirective(void);
+
+
+
+
+		/**
+		 * @brief Parses the top-level file_cache_size / file_cache_max_file_size directives.
+		 *
+		 * Accepts a size with an optional k/m/g suffix; file_cache_size also
+		 * accepts 'off' (same as 0), which disables the cache.
+		 *
+		 * @return void
+		 *
+		 * @throw ConfException If the directive is duplicated or its value is invalid.
+		 */
+		void											validateFileCacheDirective(void);
+
+
+
+
 		/**
 		* @brief	Checks if all braces are closed.
 		*/
@@ -278,6 +330,33 @@ class ParseConfig {
 
 
 
+		/**
+		 * @brief Returns the number of event-loop threads requested by worker_threads.
+		 * @return Worker thread count (1 if the directive is absent).
+		 */
+		size_t											getWorkerThreads(void) const;
+
+
+
+
+		/**
+		 * @brief Returns the memory budget of each reactor's file cache.
+		 * @return Bytes (FILE_CACHE_DEFAULT_SIZE if the directive is absent, 0 if off).
+		 */
+		size_t											getFileCacheSize(void) const;
+
+
+
+
+		/**
+		 * @brief Returns the size of the largest file kept in the file cache.
+		 * @return Bytes (FILE_CACHE_DEFAULT_MAX_FILE if the directive is absent).
+		 */
+		size_t											getFileCacheMaxFileSize(void) const;
+
+
+
+
 
 		/**
 		* @brief exception class
@@ -97,7 +97,11 @@ void	ParseConfig::lexemesToTokens(std::map<size_t, std::vector<std::string>> lin
 
 		for (const std::string& word : itMap->second) {
 
-			if (_keywords.find(word) != _keywords.end()) {
+			// A comment runs to the end of the line, directive names in it included.
+			if (prevTokenType == COMMENT || word[0] == '#') {
+				tokenType = COMMENT;
+			}
+			else if (_keywords.find(word) != _keywords.end()) {
 				tokenType = _keywords[word];
 			}
 			else {
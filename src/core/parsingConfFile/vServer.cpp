@@ -14,6 +14,7 @@
 
 
 #include "vServer.hpp"
+#include "../VirtualHost/VirtualHostIndex.hpp"
 
 
 
@@ -26,6 +27,8 @@ vServer::vServer() {
 	_vServerRoot = "website/";
 	_vServerIndex = {"index.html"};
 	_vServerAutoIndex = false;
+	_vServerSendfile = true;
+	_vServerGzip = {false, MIN_GZIP_COMP_LEVEL, DEFAULT_GZIP_MIN_LENGTH, {"text/html"}};
 	_vServerClientMaxSize = 1024 * 1024 * 1024;
 	_vServerErrorPages = {
 		{400, "/errors/400.html"},
@@ -37,6 +40,11 @@ vServer::vServer() {
 		{502, "/errors/502.html"},
 		{503, "/errors/503.html"},
 	};
+	_vServerKeepaliveTimeout = DEFAULT_KEEPALIVE_TIMEOUT;
+	_vServerKeepaliveRequests = DEFAULT_KEEPALIVE_REQUESTS;
+	_vServerHeaderTimeout = DEFAULT_CLIENT_TIMEOUT;
+	_vServerBodyTimeout = DEFAULT_CLIENT_TIMEOUT;
+	_vServerSendTimeout = DEFAULT_CLIENT_TIMEOUT;
 }
 
 
@@ -70,6 +78,15 @@ void	vServer::setServerAutoIndex(const int mode) {
 }
 
 
+void	vServer::setServerSendfile(const bool mode) {
+	_vServerSendfile = mode;
+}
+
+void	vServer::setServerGzip(const GzipConfig& gzip) {
+	_vServerGzip = gzip;
+}
+
+
 void	vServer::setServerClientMaxSize(const uint64_t size) {
 	_vServerClientMaxSize = size;
 }
@@ -80,6 +97,31 @@ void	vServer::setServerErrorPages(const std::unordered_map<int, std::string>& pa
 }
 
 
+void	vServer::setServerKeepaliveTimeout(const size_t seconds) {
+	_vServerKeepaliveTimeout = seconds;
+}
+
+
+void	vServer::setServerKeepaliveRequests(const size_t requests) {
+	_vServerKeepaliveRequests = requests;
+}
+
+
+void	vServer::setServerHeaderTimeout(const size_t seconds) {
+	_vServerHeaderTimeout = seconds;
+}
+
+
+void	vServer::setServerBodyTimeout(const size_t seconds) {
+	_vServerBodyTimeout = seconds;
+}
+
+
+void	vServer::setServerSendTimeout(const size_t seconds) {
+	_vServerSendTimeout = seconds;
+}
+
+
 
 
 //getters
@@ -88,27 +130,36 @@ bool									vServer::getServerAutoIndex(void) const {
 }
 
 
-std::string								vServer::getServerIp(void) const {
+bool									vServer::getServerSendfile(void) const {
+	return (_vServerSendfile);
+}
+
+const GzipConfig&						vServer::getServerGzip(void) const {
+	return (_vServerGzip);
+}
+
+
+const std::string&						vServer::getServerIp(void) const {
 	return (_vServerIp);
 }
 
 
-std::string								vServer::getServerPort(void) const {
+const std::string&						vServer::getServerPort(void) const {
 	return (_vServerPort);
 }
 
 
-std::string								vServer::getServerIpPort(void) const {
+const std::string&						vServer::getServerIpPort(void) const {
 	return (_vServerIpPort);
 }
 
 
-std::string								vServer::getServerRoot(void) const {
+const std::string&						vServer::getServerRoot(void) const {
 	return(_vServerRoot);
 }
 
 
-std::vector<std::string>				vServer::getServerIndex(void) const {
+const std::vector<std::string>&			vServer::getServerIndex(void) const {
 	return (_vServerIndex);
 }
 
@@ -123,12 +174,31 @@ const std::map<std::string, Location>&	vServer::getServerLocations(void) const {
 }
 
 
-std::unordered_map<int, std::string>	vServer::getServerErrorPages( void ) const {
+const Location*	vServer::findLocation(std::string_view uri) const {
+	int	id = _vServerLocationMatcher.match(uri);
+
+	return (id == -1 ? nullptr : _vServerLocationTable[id]);
+}
+
+
+void	vServer::compileLocations(void) {
+	std::vector<std::string>	paths;
+
+	_vServerLocationTable.clear();
+	for (const auto& location : _vServerLocations) {
+		paths.push_back(location.first);
+		_vServerLocationTable.push_back(&location.second);
+	}
+	_vServerLocationMatcher.compile(paths);
+}
+
+
+const std::unordered_map<int, std::string>&	vServer::getServerErrorPages( void ) const {
 	return(_vServerErrorPages);
 }
 
 
-std::unordered_set<std::string>			vServer::getServerNames( void ) const {
+const std::unordered_set<std::string>&	vServer::getServerNames( void ) const {
 	return (_vServerNames);
 }
 
@@ -138,6 +208,31 @@ uint64_t								vServer::getServerClientMaxSize( void ) const {
 }
 
 
+size_t									vServer::getServerKeepaliveTimeout( void ) const {
+	return(_vServerKeepaliveTimeout);
+}
+
+
+size_t									vServer::getServerKeepaliveRequests( void ) const {
+	return(_vServerKeepaliveRequests);
+}
+
+
+size_t									vServer::getServerHeaderTimeout( void ) const {
+	return(_vServerHeaderTimeout);
+}
+
+
+size_t									vServer::getServerBodyTimeout( void ) const {
+	return(_vServerBodyTimeout);
+}
+
+
+size_t									vServer::getServerSendTimeout( void ) const {
+	return(_vServerSendTimeout);
+}
+
+
 
 
 
@@ -219,9 +314,24 @@ void	vServer::validateServerNames(std::vector<std::string>& namesVector) {
 		throw ParseConfig::ConfException("Invalid server-name directive: max 2 names");
 	}
 
+	_vServerNames.clear();
 	for (std::string& name : namesVector) {
-			_vServerNames.clear();
-			_vServerNames.insert(name);
+		VirtualHostNameType	type = VirtualHostIndex::classify(name);
+
+		if (type == VHOST_NAME_INVALID) {
+			throw ParseConfig::ConfException("Invalid server-name directive: " + name);
+		}
+		if (type == VHOST_NAME_REGEX) {
+			try {
+				VirtualHostIndex::compile(name);
+			} catch (const std::regex_error& e) {
+				throw ParseConfig::ConfException("Invalid server-name directive: bad regular expression " + name);
+			}
+		} else {
+			// Host headers are lowercased before lookup.
+			std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+		}
+		_vServerNames.insert(name);
 	}
 }
 
@@ -239,6 +349,69 @@ const std::string&	vServer::onlyOneArgumentCheck(const std::vector<std::string>&
 
 
 
+bool	vServer::validateOnOffDirective(const std::vector<std::string>& flagVector, std::string directiveName) {
+	if (flagVector.size() != MAX_ARG) {
+		throw ParseConfig::ConfException("Invalid " + directiveName + " directive: expected single value 'on' or 'off'");
+	}
+	if (flagVector.at(0) == "on") {
+		return (true);
+	}
+	if (flagVector.at(0) == "off") {
+		return (false);
+	}
+	throw ParseConfig::ConfException("Incorrect option: '" + flagVector.at(0) + "' for " + directiveName + " field");
+}
+
+
+
+
+GzipConfig	vServer::validateGzipDirective(const std::string& directiveName, const std::vector<std::string>& argsVector, GzipConfig gzip) {
+	if (directiveName == "gzip") {
+		gzip.enabled = validateOnOffDirective(argsVector, "gzip");
+	}
+	else if (directiveName == "gzip_comp_level") {
+		const std::string&	value = onlyOneArgumentCheck(argsVector, "gzip_comp_level");
+
+		if (value.size() != 1 || !isdigit(value[0]) || value[0] - '0' < MIN_GZIP_COMP_LEVEL || value[0] - '0' > MAX_GZIP_COMP_LEVEL) {
+			throw ParseConfig::ConfException("Invalid gzip_comp_level directive: expected a level between "
+				+ std::to_string(MIN_GZIP_COMP_LEVEL) + " and " + std::to_string(MAX_GZIP_COMP_LEVEL));
+		}
+		gzip.level = value[0] - '0';
+	}
+	else if (directiveName == "gzip_min_length") {
+		gzip.minLength = validateSizeValue(onlyOneArgumentCheck(argsVector, "gzip_min_length"));
+	}
+	else {
+		gzip.types = {"text/html"};
+		for (const std::string& mimeType : argsVector) {
+			if (mimeType != "*" && mimeType.find('/') == std::string::npos) {
+				throw ParseConfig::ConfException("Invalid gzip_types directive: '" + mimeType + "' is not a MIME type");
+			}
+			gzip.types.insert(mimeType);
+		}
+	}
+	return (gzip);
+}
+
+
+
+
+size_t	vServer::validateCounterDirective(const std::vector<std::string>& valueVector, std::string directiveName) {
+	const std::string&	value = onlyOneArgumentCheck(valueVector, directiveName);
+
+	if (value.empty() || !isNumber(value) || value.size() > 7) {
+		throw ParseConfig::ConfException("Invalid " + directiveName + " directive: expected a non-negative number");
+	}
+	size_t	number = std::stoul(value);
+	if (number > MAX_COUNTER_VALUE) {
+		throw ParseConfig::ConfException("Invalid " + directiveName + " directive: value exceeds " + std::to_string(MAX_COUNTER_VALUE));
+	}
+	return (number);
+}
+
+
+
+
 bool	vServer::validateAutoIndexDirective(const std::vector<std::string>& flagVector) {
 	if (flagVector.size() != MAX_ARG) {
 
@@ -262,18 +435,14 @@ bool	vServer::validateAutoIndexDirective(const std::vector<std::string>& flagVec
 
 
 
-uint64_t	vServer::validateClientMaxSizeDirective(const std::vector<std::string>& sizeVector) {
-
-	if (sizeVector.size() != MAX_ARG) {
-		throw ParseConfig::ConfException("Invalid client_max_body_size directive: expected one argument.");
-	}
+uint64_t	vServer::validateSizeValue(const std::string& value) {
 	std::string suffix = "";
 
-	for (size_t i = 0; i < sizeVector[0].size(); ++i) {
-		if (!isdigit(sizeVector[0][i])) 
+	for (size_t i = 0; i < value.size(); ++i) {
+		if (!isdigit(value[i])) 
 		{
-			if ((sizeVector[0][i] == 'k' || sizeVector[0][i] == 'K' || sizeVector[0][i] == 'm' || sizeVector[0][i] == 'M' || sizeVector[0][i] == 'g' || sizeVector[0][i] == 'G') && suffix.empty()) {
-				suffix = sizeVector[0].substr(i);
+			if ((value[i] == 'k' || value[i] == 'K' || value[i] == 'm' || value[i] == 'M' || value[i] == 'g' || value[i] == 'G') && suffix.empty()) {
+				suffix = value.substr(i);
 				break;
 			}
 			else {
@@ -283,7 +452,7 @@ uint64_t	vServer::validateClientMaxSizeDirective(const std::vector<std::string>&
 	}
 	uint64_t number;
 	try {
-		number = std::stoull(sizeVector[0]);
+		number = std::stoull(value);
 	}
 	catch (const std::exception& e) {
 		throw ParseConfig::ConfException("Invalid number in size: " + std::string(e.what()));
@@ -300,13 +469,22 @@ uint64_t	vServer::validateClientMaxSizeDirective(const std::vector<std::string>&
 		throw ParseConfig::ConfException("Invalid size suffix: " + suffix);
 	}
 
-	const uint64_t limit = static_cast<uint64_t>(MAX_CLIENT_BODY_SIZE) * 1024 * 1024 * 1024;
-
 	if (number > UINT64_MAX / mult) {
 		throw ParseConfig::ConfException("Size value too large, would overflow.");
 	}
+	return number * mult;
+}
+
+
+
 
-	uint64_t final_size = number * mult;
+uint64_t	vServer::validateClientMaxSizeDirective(const std::vector<std::string>& sizeVector) {
+
+	if (sizeVector.size() != MAX_ARG) {
+		throw ParseConfig::ConfException("Invalid client_max_body_size directive: expected one argument.");
+	}
+	const uint64_t limit = static_cast<uint64_t>(MAX_CLIENT_BODY_SIZE) * 1024 * 1024 * 1024;
+	uint64_t final_size = validateSizeValue(sizeVector[0]);
 
 	if (final_size > limit) {
 		throw ParseConfig::ConfException("client_max_body_size directive: Exceeded the limit of " + std::to_string(MAX_CLIENT_BODY_SIZE) + "G");
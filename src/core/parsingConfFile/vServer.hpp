@@ -25,6 +25,10 @@
 #define MAX_CLIENT_BODY_SIZE 10
 #define MIN_CLIENT_BODY_SIZE 1
 #define MAX_ARG_ERROR_PAGE	2
+#define MAX_COUNTER_VALUE	1000000
+#define DEFAULT_KEEPALIVE_TIMEOUT	75   // seconds an idle persistent connection is kept open
+#define DEFAULT_KEEPALIVE_REQUESTS	1000 // requests served on one connection before it is closed
+#define DEFAULT_CLIENT_TIMEOUT		60   // seconds for client_header_timeout, client_body_timeout and send_timeout
 
 
 
@@ -36,6 +40,8 @@
 #include <regex>
 #include <set>
 #include <exception>
+#include "GzipConfig.hpp"
+#include "LocationMatcher.hpp"
 #include "ParseConfig.hpp"
 #include "LocationConfig.hpp"
 
@@ -49,11 +55,20 @@ class vServer {
 		std::string								_vServerIpPort;
 		std::unordered_set<std::string>			_vServerNames;
 		std::map<std::string, Location>			_vServerLocations;
+		LocationMatcher							_vServerLocationMatcher;  ///< Compiled from _vServerLocations by compileLocations()
+		std::vector<const Location*>			_vServerLocationTable;    ///< Location of each matcher id
 		std::string								_vServerRoot;
 		std::vector<std::string>				_vServerIndex;
 		bool									_vServerAutoIndex;
+		bool									_vServerSendfile;
+		GzipConfig								_vServerGzip;
 		uint64_t								_vServerClientMaxSize;
 		std::unordered_map<int, std::string>	_vServerErrorPages;
+		size_t									_vServerKeepaliveTimeout;
+		size_t									_vServerKeepaliveRequests;
+		size_t									_vServerHeaderTimeout;
+		size_t									_vServerBodyTimeout;
+		size_t									_vServerSendTimeout;
 
 	public:
 		vServer();
@@ -69,26 +84,32 @@ class vServer {
 		/// @brief Returns whether autoindexing is enabled for the server.
 		bool getServerAutoIndex(void) const;
 
+		/// @brief Returns whether static files are sent with sendfile().
+		bool getServerSendfile(void) const;
+
+		/// @brief Returns the response compression settings.
+		const GzipConfig& getServerGzip(void) const;
+
 		/// @brief Returns the server’s IP address as a string.
-		std::string getServerIp(void) const;
+		const std::string& getServerIp(void) const;
 
 		/// @brief Returns the server’s listening port as a string.
-		std::string getServerPort(void) const;
+		const std::string& getServerPort(void) const;
 
 		/// @brief Returns the combined "IP:Port" string of the server.
-		std::string getServerIpPort(void) const;
+		const std::string& getServerIpPort(void) const;
 
 		/// @brief Returns the maximum allowed client request body size (in bytes).
 		uint64_t getServerClientMaxSize(void) const;
 
 		/// @brief Returns the server’s root directory path.
-		std::string getServerRoot(void) const;
+		const std::string& getServerRoot(void) const;
 
-		/// @brief Returns the set of server names (hostnames) defined.
-		std::unordered_set<std::string> getServerNames(void) const;
+		/// @brief Returns the set of server names (hostnames) defined; the virtual host index views into it.
+		const std::unordered_set<std::string>& getServerNames(void) const;
 
 		/// @brief Returns the list of index files to look for in directories.
-		std::vector<std::string> getServerIndex(void) const;
+		const std::vector<std::string>& getServerIndex(void) const;
 
 		/// @brief Returns a modifiable reference to the server’s location blocks.
 		std::map<std::string, Location>& getServerLocations();
@@ -96,8 +117,26 @@ class vServer {
 		/// @brief Returns a read-only reference to the server’s location blocks.
 		const std::map<std::string, Location>& getServerLocations() const;
 
+		/// @brief Returns the location whose path is the longest prefix of uri, nullptr if none.
+		const Location* findLocation(std::string_view uri) const;
+
 		/// @brief Returns the mapping of error codes to error page paths.
-		std::unordered_map<int, std::string> getServerErrorPages(void) const;
+		const std::unordered_map<int, std::string>& getServerErrorPages(void) const;
+
+		/// @brief Returns how long (seconds) an idle persistent connection is kept; 0 disables keep-alive.
+		size_t getServerKeepaliveTimeout(void) const;
+
+		/// @brief Returns how many requests may be served over one persistent connection.
+		size_t getServerKeepaliveRequests(void) const;
+
+		/// @brief Returns how long (seconds) a client may take to send the request line and headers.
+		size_t getServerHeaderTimeout(void) const;
+
+		/// @brief Returns the maximum gap (seconds) between two reads of the request body.
+		size_t getServerBodyTimeout(void) const;
+
+		/// @brief Returns the maximum gap (seconds) between two writes of the response.
+		size_t getServerSendTimeout(void) const;
 
 		/** @} */
 
@@ -114,6 +153,13 @@ class vServer {
 	/// @brief Sets the server’s location blocks.
 	void setServerLocations(const std::map<std::string, Location>& loc);
 
+	/**
+	 * @brief Compiles the location blocks into the prefix matcher used by findLocation().
+	 * @note The matcher points into this vServer's locations: call it once the vServer
+	 *       and its locations are at their final address, and again after any change.
+	 */
+	void compileLocations(void);
+
 	/// @brief Sets the server’s root directory path.
 	void setServerRoot(const std::string& path);
 
@@ -123,12 +169,33 @@ class vServer {
 	/// @brief Enables or disables directory autoindexing.
 	void setServerAutoIndex(const int mode);
 
+	/// @brief Enables or disables sendfile() for static files.
+	void setServerSendfile(const bool mode);
+
+	/// @brief Sets the response compression settings.
+	void setServerGzip(const GzipConfig& gzip);
+
 	/// @brief Sets the maximum allowed client request body size (in bytes).
 	void setServerClientMaxSize(const uint64_t size);
 
 	/// @brief Sets the mapping of error codes to error page paths.
 	void setServerErrorPages(const std::unordered_map<int, std::string>& pages);
 
+	/// @brief Sets the idle timeout (seconds) of persistent connections.
+	void setServerKeepaliveTimeout(const size_t seconds);
+
+	/// @brief Sets the maximum number of requests per persistent connection.
+	void setServerKeepaliveRequests(const size_t requests);
+
+	/// @brief Sets the client_header_timeout (seconds).
+	void setServerHeaderTimeout(const size_t seconds);
+
+	/// @brief Sets the client_body_timeout (seconds).
+	void setServerBodyTimeout(const size_t seconds);
+
+	/// @brief Sets the send_timeout (seconds).
+	void setServerSendTimeout(const size_t seconds);
+
 	/** @} */
 
 
@@ -170,6 +237,11 @@ class vServer {
 	/// @return `true` if autoindex is enabled, `false` otherwise.
 	static bool validateAutoIndexDirective(const std::vector<std::string>& flagVector);
 
+	/// @brief Converts a size with an optional k/K, m/M or g/G suffix to bytes.
+	/// @param value Size argument of a directive.
+	/// @return Parsed size in bytes.
+	static uint64_t validateSizeValue(const std::string& value);
+
 	/// @brief Validates and converts the `client_max_body_size` directive.
 	/// @param sizeVector Vector containing the size argument (supports M/G suffix).
 	/// @return Parsed size in bytes.
@@ -180,6 +252,25 @@ class vServer {
 	/// @return Mapping of error codes to error page paths.
 	static std::unordered_map<int, std::string> validateErrorPagesDirective(const std::vector<std::string>& errorPagesVector);
 
+	/// @brief Validates a directive taking a single non-negative number.
+	/// @param valueVector Vector containing the directive arguments.
+	/// @param directiveName Name of the directive (for error reporting).
+	/// @return Parsed value.
+	static size_t validateCounterDirective(const std::vector<std::string>& valueVector, std::string directiveName);
+
+	/// @brief Validates a directive taking a single `on` / `off` flag.
+	/// @param flagVector Vector containing the directive arguments.
+	/// @param directiveName Name of the directive (for error reporting).
+	/// @return `true` for `on`, `false` for `off`.
+	static bool validateOnOffDirective(const std::vector<std::string>& flagVector, std::string directiveName);
+
+	/// @brief Validates one of the `gzip`, `gzip_comp_level`, `gzip_min_length` and `gzip_types` directives.
+	/// @param directiveName Which of them.
+	/// @param argsVector Vector containing the directive arguments.
+	/// @param gzip Settings in effect so far.
+	/// @return The settings with the directive applied.
+	static GzipConfig validateGzipDirective(const std::string& directiveName, const std::vector<std::string>& argsVector, GzipConfig gzip);
+
 	/// @brief Ensures that only one argument is provided for a directive.
 	/// @param pathVector Vector of directive arguments.
 	/// @param directiveName Name of the directive (for error reporting).
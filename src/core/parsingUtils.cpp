@@ -11,17 +11,132 @@
 /* ************************************************************************** */
 
 #include "parsingUtils.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <strings.h>
 
 std::string parsingUtils::currentDateString() {
-    std::time_t now = std::time(nullptr);
-    std::tm* gmt = std::gmtime(&now);
+    return httpDateString(std::time(nullptr));
+}
 
+std::string parsingUtils::httpDateString(std::time_t time) {
+    std::tm gmt;
     char buffer[100];
-    std::strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", gmt);
 
+    // gmtime() shares one buffer between all event loops.
+    gmtime_r(&time, &gmt);
+    std::strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &gmt);
     return std::string(buffer);
 }
 
+bool parsingUtils::parseHttpDate(std::string_view value, std::time_t& time) {
+    static const char* formats[] = {
+        "%a, %d %b %Y %H:%M:%S GMT",    // IMF-fixdate
+        "%A, %d-%b-%y %H:%M:%S GMT",    // RFC 850
+        "%a %b %e %H:%M:%S %Y"          // asctime()
+    };
+    std::string date(value);
+
+    for (const char* format : formats) {
+        std::tm gmt = std::tm();
+        const char* end = strptime(date.c_str(), format, &gmt);
+
+        if (end && *end == '\0') {
+            time = timegm(&gmt);
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string parsingUtils::entityTag(const struct stat& fileStat) {
+    unsigned long long mtimeNs = static_cast<unsigned long long>(fileStat.st_mtim.tv_sec) * 1000000000ULL + fileStat.st_mtim.tv_nsec;
+    char buffer[80];
+
+    snprintf(buffer, sizeof(buffer), "%s\"%llx-%llx-%llx\"", fileStat.st_mtime >= std::time(nullptr) ? "W/" : "",
+        static_cast<unsigned long long>(fileStat.st_ino), static_cast<unsigned long long>(fileStat.st_size), mtimeNs);
+    return std::string(buffer);
+}
+
+bool parsingUtils::entityTagMatches(std::string_view list, std::string_view tag) {
+    size_t pos = 0;
+
+    if (tag.compare(0, 2, "W/") == 0)
+        tag.remove_prefix(2);
+    while (pos < list.size()) {
+        pos = list.find_first_not_of(" \t,", pos);
+        if (pos == std::string_view::npos)
+            return false;
+        if (list[pos] == '*')
+            return true;
+        if (list.compare(pos, 2, "W/") == 0)
+            pos += 2;
+        if (pos >= list.size() || list[pos] != '"')
+            return false; // not an entity tag, the whole field is invalid
+        size_t end = list.find('"', pos + 1);
+        if (end == std::string_view::npos)
+            return false;
+        if (list.substr(pos, end - pos + 1) == tag)
+            return true;
+        pos = end + 1;
+    }
+    return false;
+}
+
+/**
+ * @brief Removes optional whitespace around a list element
+ */
+static std::string_view trimView(std::string_view value) {
+    size_t start = value.find_first_not_of(" \t");
+
+    if (start == std::string_view::npos)
+        return std::string_view();
+    return value.substr(start, value.find_last_not_of(" \t") - start + 1);
+}
+
+/**
+ * @brief Parses the parameters of a list element for its weight (RFC 9110 12.4.2)
+ * @return Weight in thousandths, 1000 without a q parameter, 0 if it is malformed
+ */
+static int parseQuality(std::string_view params) {
+    params = trimView(params);
+    if (params.size() < 3 || (params[0] != 'q' && params[0] != 'Q') || params[1] != '=')
+        return params.empty() ? 1000 : 0;
+    params.remove_prefix(2);
+    if (params[0] != '0' && params[0] != '1')
+        return 0;
+    int quality = (params[0] - '0') * 1000;
+    if (params.size() > 1 && (params[1] != '.' || params.size() > 5))
+        return 0;
+    for (size_t i = 2, scale = 100; i < params.size(); i++, scale /= 10) {
+        if (params[i] < '0' || params[i] > '9')
+            return 0;
+        quality += (params[i] - '0') * scale;
+    }
+    return quality > 1000 ? 0 : quality;
+}
+
+int parsingUtils::codingQuality(std::string_view list, std::string_view coding) {
+    int wildcard = 0;
+    size_t pos = 0;
+
+    while (pos < list.size()) {
+        size_t end = std::min(list.find(',', pos), list.size());
+        std::string_view element = list.substr(pos, end - pos);
+        size_t semicolon = element.find(';');
+        std::string_view name = trimView(element.substr(0, semicolon));
+        int quality = semicolon == std::string_view::npos ? 1000 : parseQuality(element.substr(semicolon + 1));
+
+        pos = end + 1;
+        if ((name.size() == coding.size() && strncasecmp(name.data(), coding.data(), name.size()) == 0)
+            || (coding == "gzip" && name.size() == 6 && strncasecmp(name.data(), "x-gzip", 6) == 0))
+            return quality;
+        if (name == "*")
+            wildcard = quality;
+    }
+    return wildcard;
+}
+
 std::string parsingUtils::serverNameString() {
     return "webserv/1.0";
 }
@@ -17,7 +17,9 @@
 
 
 #include <string>
+#include <string_view>
 #include <ctime>
+#include <sys/stat.h>
 #include <sstream>
 #include <vector>
 
@@ -41,6 +43,50 @@ class parsingUtils {
          */
         static std::string currentDateString();
 
+        /**
+         * @brief Formats a timestamp as an HTTP-date
+         * @param time Seconds since the epoch
+         * @return IMF-fixdate string (e.g., "Mon, 25 Aug 2025 14:30:00 GMT")
+         */
+        static std::string httpDateString(std::time_t time);
+
+        /**
+         * @brief Parses an HTTP-date in any of the three formats RFC 9110 requires recipients to accept
+         * @param value IMF-fixdate, RFC 850 or asctime() date
+         * @param time Set to seconds since the epoch on success
+         * @return false if the value is not a valid date
+         */
+        static bool parseHttpDate(std::string_view value, std::time_t& time);
+
+        // Validator utilities
+        /**
+         * @brief Builds the entity tag of a file from its inode, size and modification time
+         * @param fileStat Result of stat() on the file
+         * @return Quoted strong tag, or a weak one (W/"...") if the file changed within the current second
+         * @note A file modified this second may still be being written, so its bytes are not
+         *       guaranteed to match the tag yet
+         */
+        static std::string entityTag(const struct stat& fileStat);
+
+        /**
+         * @brief Checks whether an If-None-Match field lists an entity tag
+         * @param list Field value: "*" or a comma-separated list of entity tags
+         * @param tag Current entity tag of the representation
+         * @return true on a weak match (W/ prefixes ignored) or "*"
+         */
+        static bool entityTagMatches(std::string_view list, std::string_view tag);
+
+        // Content negotiation utilities
+        /**
+         * @brief Looks up how much an Accept-Encoding field wants a content coding
+         * @param list Field value: comma-separated codings with optional ";q=" weights
+         * @param coding Content coding to look up (x-gzip counts as gzip)
+         * @return Weight in thousandths, 1000 if listed without one, the "*" weight if only
+         *         the wildcard matches, 0 if the coding is not acceptable
+         * @note A malformed weight makes its coding unacceptable, which never breaks a client
+         */
+        static int codingQuality(std::string_view list, std::string_view coding);
+
         /**
          * @brief Returns the server identification string
          * @return String containing the server name and version
@@ -34,9 +34,7 @@ int main(int argc, char *argv[]) {
 		ServerManager serverManager(argv[1], EPOLL_CAPACITY);
 		signal(SIGINT, signalHandler);
 		signal(SIGPIPE, SIG_IGN);
-		std::vector<vServer>& virtualServers = serverManager.getVirtualServers();
-		serverManager.parsConfigFile(virtualServers);
-		serverManager.groupServers(virtualServers);
+		serverManager.parsConfigFile();
 		serverManager.setServers();
 		serverManager.runServers();
 		serverManager.closeAllSockets();
@@ -0,0 +1,142 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   location_match_bench.cpp                           :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/26 10:14:03 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/26 10:14:03 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+/*
+ * Location lookup cost with a few hundred location blocks: the linear scan
+ * findLocationBlockByUri used to do against the compiled LocationMatcher.
+ * Before timing anything, both are run on every generated URI and must pick
+ * the same location; any difference exits with status 1.
+ *
+ *   make bench && ./location_match_bench [iterations]
+ */
+
+#include "../../src/core/parsingConfFile/LocationMatcher.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+
+
+
+
+/**
+ * @brief The previous matcher: every path tested with find() == 0, longest wins.
+ * @return Index of the matching path, -1 if none.
+ */
+static int	linearMatch(const std::vector<std::string>& paths, const std::string& uri) {
+	size_t	longestMatchLen = 0;
+	int		best = -1;
+
+	for (size_t i = 0; i < paths.size(); i++) {
+		if (uri.find(paths[i]) == 0 && paths[i].length() > longestMatchLen) {
+			best = static_cast<int>(i);
+			longestMatchLen = paths[i].length();
+		}
+	}
+	return (best);
+}
+
+/**
+ * @brief 240+ location paths in the order a std::map key walk yields them.
+ */
+static std::vector<std::string>	makePaths(void) {
+	static const char*	sections[] = {"api", "static", "assets", "admin", "user", "blog", "shop", "media",
+		"docs", "cgi-bin", "upload", "download", "img", "css", "js", "v1", "v2", "internal", "public", "files"};
+	std::map<std::string, int>	sorted;
+
+	sorted["/"] = 0;
+	for (const char* section : sections) {
+		std::string	base = std::string("/") + section;
+
+		sorted[base] = 0;
+		sorted[base + "/"] = 0;
+		for (int j = 0; j < 10; j++) {
+			std::string	sub = base + "/" + (j % 2 ? "item" : "v") + std::to_string(j);
+
+			sorted[sub] = 0;
+			if (j < 2) {
+				sorted[sub + "/deep/path"] = 0;
+			}
+		}
+	}
+	std::vector<std::string>	paths;
+
+	for (const auto& path : sorted) {
+		paths.push_back(path.first);
+	}
+	return (paths);
+}
+
+/**
+ * @brief URIs hitting every path, its extensions and near misses.
+ */
+static std::vector<std::string>	makeUris(const std::vector<std::string>& paths) {
+	std::vector<std::string>	uris = {"", "/", "*", "a", "//", "/apiary", "/x/api/v1", "http://host/api"};
+
+	for (const std::string& path : paths) {
+		uris.push_back(path);
+		uris.push_back(path + "/index.html");
+		uris.push_back(path + "x");
+		uris.push_back(path + "?q=1");
+		uris.push_back("/zz" + path);
+		if (path.size() > 1) {
+			uris.push_back(path.substr(0, path.size() - 1));
+			uris.push_back(path.substr(0, path.size() / 2));
+		}
+	}
+	return (uris);
+}
+
+
+
+
+int	main(int argc, char** argv) {
+	size_t						iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200;
+	std::vector<std::string>	paths = makePaths();
+	std::vector<std::string>	uris = makeUris(paths);
+	LocationMatcher				matcher;
+	size_t						checksum[2] = {0, 0};
+
+	matcher.compile(paths);
+	for (const std::string& uri : uris) {
+		if (matcher.match(uri) != linearMatch(paths, uri)) {
+			std::cerr << "mismatch for \"" << uri << "\": trie " << matcher.match(uri)
+				<< ", linear " << linearMatch(paths, uri) << std::endl;
+			return (1);
+		}
+	}
+	std::cout << paths.size() << " locations (" << matcher.getNodeCount() << " trie nodes), "
+		<< uris.size() << " URIs, " << iterations << " iterations: results identical" << std::endl;
+
+	auto	start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < iterations; i++) {
+		for (const std::string& uri : uris) {
+			checksum[0] += linearMatch(paths, uri) + 1;
+		}
+	}
+	auto	middle = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < iterations; i++) {
+		for (const std::string& uri : uris) {
+			checksum[1] += matcher.match(uri) + 1;
+		}
+	}
+	auto	end = std::chrono::steady_clock::now();
+	double	lookups = static_cast<double>(iterations * uris.size());
+
+	if (checksum[0] != checksum[1]) {
+		std::cerr << "unexpected match result" << std::endl;
+		return (1);
+	}
+	std::cout << "  linear scan: " << std::chrono::duration<double, std::nano>(middle - start).count() / lookups << " ns/lookup" << std::endl;
+	std::cout << "  radix trie:  " << std::chrono::duration<double, std::nano>(end - middle).count() / lookups << " ns/lookup" << std::endl;
+	return (0);
+}
@@ -0,0 +1,111 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   request_parse_bench.cpp                            :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: amysiv <amysiv@student.42.fr>              +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/09/23 15:12:40 by amysiv            #+#    #+#             */
+/*   Updated: 2025/09/23 15:12:40 by amysiv           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+/*
+ * Parse cost of one request head, as the Client drives it: bytes are appended
+ * to the connection buffer recv() by recv(), the parser is fed after each
+ * append, and the Request is bound once the head is complete. Each
+ * DelimiterScan kernel the CPU supports is measured in turn.
+ *
+ *   make bench && ./request_parse_bench [iterations]
+ */
+
+#include "../../src/core/Request/Request.hpp"
+#include "../../src/core/Request/DelimiterScan.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+
+
+
+/// Chrome-like navigation request: 15 header fields, ~700 bytes.
+static const char	BROWSER_REQUEST[] =
+	"GET /static/css/main.4f1c2b.css?v=20250923 HTTP/1.1\r\n"
+	"Host: www.example.com\r\n"
+	"Connection: keep-alive\r\n"
+	"sec-ch-ua: \"Chromium\";v=\"128\", \"Not;A=Brand\";v=\"24\"\r\n"
+	"sec-ch-ua-mobile: ?0\r\n"
+	"sec-ch-ua-platform: \"Linux\"\r\n"
+	"Upgrade-Insecure-Requests: 1\r\n"
+	"User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/128.0.0.0 Safari/537.36\r\n"
+	"Accept: text/css,*/*;q=0.1\r\n"
+	"Sec-Fetch-Site: same-origin\r\n"
+	"Sec-Fetch-Mode: no-cors\r\n"
+	"Sec-Fetch-Dest: style\r\n"
+	"Referer: https://www.example.com/products/index.html\r\n"
+	"Accept-Encoding: gzip, deflate, br, zstd\r\n"
+	"Accept-Language: en-US,en;q=0.9,fr;q=0.8\r\n"
+	"Cookie: session=8f2d0c4be1a94c6e9d3f; theme=dark; _ga=GA1.2.1234567890.1700000000\r\n"
+	"\r\n";
+
+
+
+
+/**
+ * @brief Parse BROWSER_REQUEST `iterations` times, delivered in pieces of `segment` bytes.
+ * @return Average nanoseconds per request.
+ */
+static double	run(size_t iterations, size_t segment) {
+	const size_t	length = sizeof(BROWSER_REQUEST) - 1;
+	RequestParser	parser;
+	Request			request;
+	std::string		buffer;
+	size_t			checksum = 0;
+
+	auto	start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < iterations; i++) {
+		buffer.clear();
+		parser.reset();
+		request.reset();
+		for (size_t offset = 0; offset < length; offset += segment) {
+			buffer.append(BROWSER_REQUEST + offset, std::min(segment, length - offset));
+			if (parser.parse(buffer.data(), buffer.size()) >= PARSE_DONE) {
+				break;
+			}
+		}
+		request.parseRequest(parser, buffer);
+		checksum += request.getHeaderCount() + request.getStatusCode();
+	}
+	auto	elapsed = std::chrono::steady_clock::now() - start;
+
+	if (checksum != iterations * (15 + 200)) {
+		std::cerr << "unexpected parse result" << std::endl;
+		std::exit(1);
+	}
+	return (std::chrono::duration<double, std::nano>(elapsed).count() / iterations);
+}
+
+
+
+
+int	main(int argc, char** argv) {
+	size_t	iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+	size_t	segments[] = {sizeof(BROWSER_REQUEST), 128, 16};
+
+	std::cout << "request head: " << sizeof(BROWSER_REQUEST) - 1 << " bytes, 15 fields, "
+		<< iterations << " iterations" << std::endl;
+	for (int kernel = SCAN_KERNEL_SCALAR; kernel < SCAN_KERNEL_COUNT; kernel++) {
+		if (!DelimiterScan::setKernel(static_cast<ScanKernel>(kernel))) {
+			std::cout << DelimiterScan::kernelName(static_cast<ScanKernel>(kernel)) << ": not supported" << std::endl;
+			continue;
+		}
+		std::cout << DelimiterScan::kernelName(static_cast<ScanKernel>(kernel)) << std::endl;
+		for (size_t segment : segments) {
+			double	nsPerRequest = run(iterations, segment);
+
+			std::cout << "  recv size " << (segment >= sizeof(BROWSER_REQUEST) ? std::string("whole") : std::to_string(segment))
+				<< ": " << nsPerRequest << " ns/request" << std::endl;
+		}
+	}
+	return (0);
+}
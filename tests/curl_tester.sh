@@ -12,6 +12,8 @@ curl -H "Host: lol.com" http://localhost:8071/ # update the port if needed
 echo "Success 200 even if server name is not correct"
 curl -H "Host: testServer.com" http://localhost:8071/ # update the port if needed
 echo "Error code should be 200 OK"
+curl -H "Host: TESTSERVER.COM:8071" http://localhost:8071/ # update the port if needed
+echo "Error code should be 200 OK (server names match regardless of case and port)"
 curl http://localhost:8071/invalid1/ # update the port if needed
 echo "Error code should be 404 Not Found"
 curl http://localhost:8080/ # update the port if needed
@@ -21,7 +23,14 @@ curl -X POST --data "somedatahere" http://localhost:8071/simple/ # update the po
 echo "Error code should be 200 OK"
 curl -X DELETE http://localhost:8071/simple/blackhole.png # update the port if needed
 echo "Error code should be 200 OK"
+curl -sv -o /dev/null -o /dev/null http://localhost:8071/ http://localhost:8071/styles.css 2>&1 | grep -i "re-using" # update the port if needed
+echo "Second request should re-use the existing connection (keep-alive)"
 
 
 
 
+etag=$(curl -s -D - -o /dev/null http://localhost:8071/styles.css | grep -i "^etag:" | cut -d' ' -f2 | tr -d '\r') # update the port if needed
+curl -s -o /dev/null -w "%{http_code}\n" -H "If-None-Match: $etag" http://localhost:8071/styles.css # update the port if needed
+echo "Status should be 304 Not Modified (conditional GET with the current ETag)"
+curl -s -o /dev/null -w "%{http_code} %{size_download}\n" -H "Range: bytes=0-99" http://localhost:8071/styles.css # update the port if needed
+echo "Status should be 206 Partial Content with 100 bytes"